@@ -0,0 +1,297 @@
+#define _POSIX_C_SOURCE 200112L
+#include "arena.h"
+#include "profile.h"
+#include <pthread.h>
+#include <string.h>
+
+/********************************************* STATIC FUNCTION DECLARATIONS
+ * (ARENA)
+ * **************************************************************/
+/* Allocates a new block of <size> bytes at least, and links it right after
+ * the block that's allocated from. Returns NULL in case of an allocation
+ * failure. */
+static arena_block_t *arena_new_block(arena_t *arena, size_t size);
+
+/* Accounts <bytes> more bytes in use (or less, if !<more>) to the arena and
+ * to the stage of the index <stage_index> */
+static void arena_account(arena_t *arena, size_t stage_index, size_t bytes,
+                          bool more);
+
+/* The key of the arena of every thread, and its destructor */
+static pthread_key_t arena_key;
+static pthread_once_t arena_key_once = PTHREAD_ONCE_INIT;
+static void arena_make_key(void);
+static void arena_thread_destroy(void *arena);
+/******************************************************************************/
+
+/********************************************* GLOBAL FUNCTIONS OF THE ARENA
+ * **************************************************************/
+void arena_init(arena_t *arena) {
+    arena->head = NULL;
+    arena->block = NULL;
+    arena->current = 0;
+    arena->peak = 0;
+    arena->reserved = 0;
+    arena->held = NULL;
+    arena->held_bytes = 0;
+    arena->n_stages = 1;
+    arena->stage = 0;
+    arena->stages[0].name = ARENA_NO_STAGE;
+    arena->stages[0].current = 0;
+    arena->stages[0].peak = 0;
+}
+
+void arena_destroy(arena_t *arena) {
+    arena_block_t *block = arena->head;
+    arena_held_t *held = arena->held;
+
+    while(NULL != block) {
+        arena_block_t *next = block->next;
+
+        free(block->data);
+        free(block);
+        block = next;
+    }
+    while(NULL != held) {
+        arena_held_t *next = held->next;
+
+        free(held);
+        held = next;
+    }
+    arena_init(arena);
+}
+
+void *arena_alloc(arena_t *arena, size_t bytes, bool zero) {
+    arena_block_t *block = arena->block;
+    unsigned char *output;
+
+    /* Every allocation keeps the next one aligned */
+    bytes = (bytes + MATRIX_ALIGN - 1) / MATRIX_ALIGN * MATRIX_ALIGN;
+    if(bytes == 0)
+        bytes = MATRIX_ALIGN;
+
+    /* The blocks after the one that's allocated from are empty: the first of
+     * them that has room is used */
+    if(NULL == block) {
+        block = arena->head;
+    }
+    while(NULL != block && block->size - block->used < bytes) {
+        block = block->next;
+    }
+    if(NULL == block && NULL == (block = arena_new_block(arena, bytes)))
+        return NULL;
+
+    arena->block = block;
+    output = block->data + block->used;
+    block->used += bytes;
+    arena_account(arena, arena->stage, bytes, true);
+    profile_allocated(bytes);
+
+    if(zero) {
+        memset(output, 0, bytes);
+    }
+    return output;
+}
+
+arena_mark_t arena_mark(const arena_t *arena) {
+    arena_mark_t mark;
+
+    mark.block = arena->block;
+    mark.used = (NULL != arena->block) ? arena->block->used : 0;
+    mark.current = arena->current - arena->held_bytes;
+
+    return mark;
+}
+
+void arena_release(arena_t *arena, arena_mark_t mark) {
+    arena_block_t *block;
+
+    /* Everything after the mark is released (the blocks are kept) */
+    block = (NULL != mark.block) ? mark.block->next : arena->head;
+    for(; NULL != block; block = block->next) {
+        block->used = 0;
+    }
+    if(NULL != mark.block) {
+        mark.block->used = mark.used;
+    }
+    arena->block = mark.block;
+
+    /* The bytes it holds aren't released along with it */
+    if(arena->current - arena->held_bytes > mark.current) {
+        arena_account(arena, arena->stage,
+                      arena->current - arena->held_bytes - mark.current,
+                      false);
+    }
+}
+
+size_t arena_stage(arena_t *arena, const char *name) {
+    size_t previous, i;
+
+    if(NULL == arena)
+        return 0;
+
+    previous = arena->stage;
+    for(i = 0; i < arena->n_stages; i++) {
+        if(strcmp(arena->stages[i].name, name) == 0)
+            break;
+    }
+
+    if(i == arena->n_stages) {
+        if(arena->n_stages == ARENA_MAX_STAGES) {
+            i = ARENA_MAX_STAGES - 1;
+        } else {
+            arena->stages[i].name = name;
+            arena->stages[i].current = 0;
+            arena->stages[i].peak = 0;
+            arena->n_stages++;
+        }
+    }
+
+    arena->stage = i;
+    return previous;
+}
+
+void arena_stage_restore(arena_t *arena, size_t stage) {
+    if(NULL != arena && stage < arena->n_stages) {
+        arena->stage = stage;
+    }
+}
+
+int arena_hold(arena_t *arena, const void *data, size_t bytes) {
+    arena_held_t *held = malloc(sizeof(*held));
+
+    if(NULL == held)
+        return BAD_ALLOC;
+
+    held->data = data;
+    held->bytes = bytes;
+    held->stage = arena->stage;
+    held->next = arena->held;
+    arena->held = held;
+    arena->held_bytes += bytes;
+    arena_account(arena, held->stage, bytes, true);
+
+    return 0;
+}
+
+bool arena_drop(arena_t *arena, const void *data) {
+    arena_held_t **link, *held;
+
+    for(link = &arena->held; NULL != *link; link = &(*link)->next) {
+        if((*link)->data == data) {
+            held = *link;
+            *link = held->next;
+            arena->held_bytes -= held->bytes;
+            arena_account(arena, held->stage, held->bytes, false);
+            free(held);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void arena_reset_stats(arena_t *arena) {
+    size_t i;
+
+    arena->peak = arena->current;
+    for(i = 0; i < arena->n_stages; i++) {
+        arena->stages[i].peak = arena->stages[i].current;
+    }
+}
+
+arena_t *arena_thread(void) {
+    arena_t *arena;
+
+    if(0 != pthread_once(&arena_key_once, arena_make_key))
+        return NULL;
+
+    if(NULL == (arena = pthread_getspecific(arena_key))) {
+        if(NULL == (arena = malloc(sizeof(*arena))))
+            return NULL;
+        arena_init(arena);
+        if(0 != pthread_setspecific(arena_key, arena)) {
+            free(arena);
+            return NULL;
+        }
+    }
+
+    return arena;
+}
+
+void arena_thread_free(void) {
+    arena_t *arena;
+
+    if(0 != pthread_once(&arena_key_once, arena_make_key))
+        return;
+
+    if(NULL != (arena = pthread_getspecific(arena_key))) {
+        pthread_setspecific(arena_key, NULL);
+        arena_thread_destroy(arena);
+    }
+}
+/******************************************************************************/
+
+/********************************************* STATIC FUNCTION DEFINITIONS
+ * (RELATED TO THE ARENA)
+ * **************************************************************/
+static arena_block_t *arena_new_block(arena_t *arena, size_t size) {
+    arena_block_t *block = malloc(sizeof(*block));
+    void *data;
+
+    if(NULL == block)
+        return NULL;
+
+    size = (size > ARENA_BLOCK_MIN) ? size : ARENA_BLOCK_MIN;
+    if(0 != posix_memalign(&data, MATRIX_ALIGN, size)) {
+        free(block);
+        return NULL;
+    }
+
+    block->data = (unsigned char *)data;
+    block->size = size;
+    block->used = 0;
+
+    /* Right after the block that's allocated from, so that a release keeps
+     * the order of the blocks */
+    if(NULL == arena->block) {
+        block->next = arena->head;
+        arena->head = block;
+    } else {
+        block->next = arena->block->next;
+        arena->block->next = block;
+    }
+    arena->reserved += size;
+
+    return block;
+}
+
+static void arena_account(arena_t *arena, size_t stage_index, size_t bytes,
+                          bool more) {
+    arena_stage_t *stage = &arena->stages[stage_index];
+
+    if(more) {
+        arena->current += bytes;
+        stage->current += bytes;
+    } else {
+        arena->current -= bytes;
+        stage->current -= (stage->current > bytes) ? bytes : stage->current;
+    }
+
+    if(arena->current > arena->peak) {
+        arena->peak = arena->current;
+    }
+    if(stage->current > stage->peak) {
+        stage->peak = stage->current;
+    }
+}
+
+static void arena_make_key(void) {
+    pthread_key_create(&arena_key, arena_thread_destroy);
+}
+
+static void arena_thread_destroy(void *arena) {
+    arena_destroy((arena_t *)arena);
+    free(arena);
+}
+/******************************************************************************/
@@ -0,0 +1,122 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "matrix.h"
+#include <stdlib.h>
+
+/* The least size (in bytes) of a block of an arena */
+#define ARENA_BLOCK_MIN (1 << 20)
+
+/* The most stages an arena keeps accounts of (the allocations of any further
+ * stage are accounted to the last one) */
+#define ARENA_MAX_STAGES 16
+
+/* The stage that's active before any stage is begun */
+#define ARENA_NO_STAGE "other"
+
+/* Define a structure that will hold a block of an arena: <used> bytes out of
+ * its <size> bytes (starting at <data>, aligned to MATRIX_ALIGN) are in use */
+typedef struct arena_block_t {
+    unsigned char *data;
+    size_t size;
+    size_t used;
+    struct arena_block_t *next;
+} arena_block_t;
+
+/* Define a structure that will hold an allocation that isn't a part of the
+ * arena, while it's accounted to it (see arena_hold): <bytes> bytes at
+ * <data>, accounted to the stage of the index <stage> */
+typedef struct arena_held_t {
+    const void *data;
+    size_t bytes;
+    size_t stage;
+    struct arena_held_t *next;
+} arena_held_t;
+
+/* Define a structure that will hold the accounts of a stage of a pipeline:
+ * the bytes of the arena it currently holds, and the most it ever held */
+typedef struct arena_stage_t {
+    const char *name;
+    size_t current;
+    size_t peak;
+} arena_stage_t;
+
+/* Define a structure that will hold an arena: a list of blocks, allocated
+ * from by bumping a pointer, and released back to a mark at once (see
+ * arena_mark). The blocks are kept once they're released, hence an arena
+ * that lives as long as its thread serves all of its jobs without going
+ * back to the heap. Every allocation is accounted to the stage that's active
+ * at the time (see arena_stage), as well as to the arena as a whole, and so
+ * are the allocations it holds (see arena_hold). */
+typedef struct arena_t {
+    arena_block_t *head;
+    arena_block_t *block; /* the block that's allocated from */
+    size_t current; /* including the bytes it holds */
+    size_t peak;
+    size_t reserved; /* the sizes of all of the blocks */
+    arena_held_t *held;
+    size_t held_bytes;
+    arena_stage_t stages[ARENA_MAX_STAGES];
+    size_t n_stages;
+    size_t stage; /* the index of the active stage */
+} arena_t;
+
+/* Define a structure that will hold a position of an arena, to be released
+ * back to */
+typedef struct arena_mark_t {
+    arena_block_t *block;
+    size_t used;
+    size_t current;
+} arena_mark_t;
+
+/* Initializes an empty arena (without any block) */
+void arena_init(arena_t *arena);
+
+/* Frees all of the blocks of the arena. The arena is empty afterwards. */
+void arena_destroy(arena_t *arena);
+
+/* Allocates <bytes> bytes out of the arena, aligned to MATRIX_ALIGN, and
+ * zeroes them only if <zero>. A new block is allocated only when none of the
+ * blocks that are left has room for them. Returns NULL in case of an
+ * allocation failure. */
+void *arena_alloc(arena_t *arena, size_t bytes, bool zero);
+
+/* Returns the current position of the arena. Releasing the arena back to it
+ * (arena_release) releases everything allocated after it at once. */
+arena_mark_t arena_mark(const arena_t *arena);
+void arena_release(arena_t *arena, arena_mark_t mark);
+
+/* Makes <name> (a string that outlives the arena) the active stage of the
+ * arena, and returns the index of the stage that was active (to be restored
+ * by arena_stage_restore). If <arena> is NULL, this function safely does
+ * nothing. */
+size_t arena_stage(arena_t *arena, const char *name);
+void arena_stage_restore(arena_t *arena, size_t stage);
+
+/* Accounts the <bytes> bytes at <data>, which aren't allocated out of the
+ * arena (e.g. the large matrices, see matrix_new_large), to the arena and to
+ * its active stage, until they're dropped (see arena_drop). Releasing the
+ * arena (arena_release) leaves them accounted. Returns 0 on success, and
+ * BAD_ALLOC in case of an allocation failure (then nothing is accounted). */
+int arena_hold(arena_t *arena, const void *data, size_t bytes);
+
+/* Stops accounting the bytes at <data> (see arena_hold) to the arena and to
+ * the stage they were accounted to. Returns false (and does nothing) if the
+ * arena doesn't hold them. */
+bool arena_drop(arena_t *arena, const void *data);
+
+/* Zeroes the accounts of the arena (its peaks start over from the bytes that
+ * are currently in use) */
+void arena_reset_stats(arena_t *arena);
+
+/* Returns the arena of the calling thread, which is created by the first
+ * call (and destroyed once the thread exits). Returns NULL in case of an
+ * allocation failure. */
+arena_t *arena_thread(void);
+
+/* Destroys the arena of the calling thread right away (e.g. before the
+ * program exits). If the thread has no arena, this function safely does
+ * nothing. */
+void arena_thread_free(void);
+
+#endif /* ARENA_H */
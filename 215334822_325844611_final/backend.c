@@ -0,0 +1,361 @@
+#define _POSIX_C_SOURCE 200112L
+#include "backend.h"
+#include "arena.h"
+#include "eigen.h"
+#include "isa.h"
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+#ifdef SPKMEANS_BLAS
+#include <cblas.h>
+
+/* LAPACK's dsyevr, through its Fortran interface (LAPACKE isn't always
+ * installed along with a LAPACK library, e.g. OpenBLAS's, while this always
+ * is). Every argument is passed by reference, and the lengths of the
+ * character arguments are passed last. */
+void dsyevr_(const char *jobz, const char *range, const char *uplo,
+             const int *n, double *a, const int *lda, const double *vl,
+             const double *vu, const int *il, const int *iu,
+             const double *abstol, int *m, double *w, double *z,
+             const int *ldz, int *isuppz, double *work, const int *lwork,
+             int *iwork, const int *liwork, int *info, size_t jobz_len,
+             size_t range_len, size_t uplo_len);
+#endif
+
+/********************************************* STATIC FUNCTION DECLARATIONS
+ * (THE REFERENCE BACKEND)
+ * **************************************************************/
+static int reference_adjacent(dpoint_t input[], size_t num_data, size_t dim,
+                              matrix_t W);
+static void reference_scale(matrix_t W, const double *D_sqrt,
+                            matrix_t output);
+static void reference_rotate(matrix_t V, size_t i, size_t j, double c,
+                             double s);
+static void reference_product(matrix_t A, matrix_t B, matrix_t C);
+/******************************************************************************/
+
+#ifdef SPKMEANS_BLAS
+/********************************************* STATIC FUNCTION DECLARATIONS
+ * (THE BLAS AND LAPACK BACKENDS)
+ * **************************************************************/
+/* The weights through the norm expansion
+ * ||x - y||^2 = ||x||^2 - 2 x.y + ||y||^2, whose dot products are found at
+ * once by dsyrk (on a contiguous copy of the datapoints) */
+static int blas_adjacent(dpoint_t input[], size_t num_data, size_t dim,
+                         matrix_t W);
+static void blas_rotate(matrix_t V, size_t i, size_t j, double c, double s);
+static void blas_product(matrix_t A, matrix_t B, matrix_t C);
+
+/* All of the eigen values (in ascending order) and eigen vectors, by dsyevr
+ * (in place of <mat>, which dsyevr overwrites) */
+static int lapack_eigen(const backend_t *backend, matrix_t mat, double *values,
+                        matrix_t vectors);
+/******************************************************************************/
+#endif
+
+/* The built in backends. The first one is the reference backend. */
+static const backend_t backends[] = {
+    {"reference", reference_adjacent, reference_scale, reference_rotate,
+     eigen_jacobi_solve, reference_product},
+#ifdef SPKMEANS_BLAS
+    {"blas", blas_adjacent, reference_scale, blas_rotate, eigen_jacobi_solve,
+     blas_product},
+    {"lapack", blas_adjacent, reference_scale, blas_rotate, lapack_eigen,
+     blas_product},
+#endif
+};
+
+/* The backend that's used (NULL until one is selected), guarded by
+ * <current_lock>. A run takes it once, when it's planned (see budget_plan). */
+static const backend_t *current = NULL;
+static pthread_mutex_t current_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t current_once = PTHREAD_ONCE_INIT;
+
+/* Makes <backend> the one that's used */
+static void backend_set(const backend_t *backend) {
+    pthread_mutex_lock(&current_lock);
+    current = backend;
+    pthread_mutex_unlock(&current_lock);
+}
+
+/* Selects the backend named by the environment, unless one was selected */
+static void backend_init_once(void) {
+    bool selected;
+
+    pthread_mutex_lock(&current_lock);
+    selected = NULL != current;
+    pthread_mutex_unlock(&current_lock);
+
+    if(!selected) {
+        backend_init();
+    }
+}
+
+/********************************************* GLOBAL FUNCTIONS OF THE BACKEND
+ * **************************************************************/
+const backend_t *backend_find(const char *name) {
+    size_t i;
+
+    for(i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        if(strcmp(backends[i].name, name) == 0)
+            return &backends[i];
+    }
+
+    return NULL;
+}
+
+int backend_select(const char *name) {
+    const backend_t *backend = backend_find(name);
+
+    if(NULL == backend)
+        return BAD_INPUT;
+
+    backend_set(backend);
+    return 0;
+}
+
+int backend_init(void) {
+    const char *name = getenv(BACKEND_ENV);
+
+    if(NULL == name || '\0' == *name) {
+        name = BACKEND_DEFAULT;
+    }
+
+    if(backend_select(name)) {
+        backend_set(&backends[0]);
+        return BAD_INPUT;
+    }
+    return 0;
+}
+
+const backend_t *backend_current(void) {
+    const backend_t *backend;
+
+    pthread_once(&current_once, backend_init_once);
+
+    pthread_mutex_lock(&current_lock);
+    backend = current;
+    pthread_mutex_unlock(&current_lock);
+    return backend;
+}
+/******************************************************************************/
+
+/********************************************* STATIC FUNCTION DEFINITIONS
+ * (THE REFERENCE BACKEND)
+ * **************************************************************/
+static int reference_adjacent(dpoint_t input[], size_t num_data, size_t dim,
+                              matrix_t W) {
+    const isa_kernels_t *kernels = isa_kernels();
+    arena_t *arena = arena_thread();
+    arena_mark_t mark;
+    double *packed, *distances;
+    size_t i, j, k;
+
+    if(NULL == arena)
+        return BAD_ALLOC;
+    mark = arena_mark(arena);
+
+    /* The datapoints are packed transposed, so that the distances of a
+     * datapoint to all of the ones after it are found side by side */
+    packed = arena_alloc(arena, num_data * dim * sizeof(double), false);
+    distances = arena_alloc(arena, num_data * sizeof(double), false);
+    if(NULL == packed || NULL == distances) {
+        arena_release(arena, mark);
+        return BAD_ALLOC;
+    }
+    for(i = 0; i < num_data; i++) {
+        for(k = 0; k < dim; k++) {
+            packed[k * num_data + i] = input[i].data[k];
+        }
+    }
+
+    for(i = 0; i < num_data; i++) {
+        /* The diagonal values are zeros */
+        matrix_set(W, i, i, 0);
+
+        kernels->squared_distances(input[i].data, packed + i + 1, num_data,
+                                   num_data - i - 1, dim, distances);
+        for(j = i + 1; j < num_data; j++) {
+            double tmp = exp(sqrt(distances[j - i - 1]) * (-0.5));
+            matrix_set(W, i, j, tmp);
+        }
+    }
+
+    /* The upper triangle is built row by row, and mirrored by tiles */
+    matrix_mirror_upper(W);
+
+    arena_release(arena, mark);
+    return 0;
+}
+
+static void reference_scale(matrix_t W, const double *D_sqrt,
+                            matrix_t output) {
+    size_t i, j;
+
+    for(i = 0; i < output.rows; i++) {
+        for(j = 0; j < output.cols; j++) {
+            /* L_norm = I - D_sqrt * WAM * D_sqrt */
+            double mult_val;
+
+            /* Matrix multiplication avoided by in-place editing of the output
+             * matrix. This is avoided since D_sqrt is always a diagonal matrix,
+             * and thus we represent D_sqrt's diagonal as an array */
+            mult_val = D_sqrt[i] * matrix_get(W, i, j) * D_sqrt[j];
+            matrix_set(output, i, j, (i == j) * 1 - mult_val);
+        }
+    }
+}
+
+static void reference_rotate(matrix_t V, size_t i, size_t j, double c,
+                             double s) {
+    /* P is essentially an identity matrix with 4 values changed. No need for a
+     * robust matrix multiplication algorithm. We'll change just the values in V
+     * that are supposed to be changed due to such multiplication, accordingly
+     * (the columns i and j, in place) */
+    isa_kernels()->rotate(V.data + i, V.data + j, V.stride, V.rows, c, s,
+                          V.data + i, V.data + j, V.stride);
+}
+
+static void reference_product(matrix_t A, matrix_t B, matrix_t C) {
+    size_t i, j, k;
+
+    /* Every row of C accumulates the rows of B, in the order of the columns
+     * of A */
+    for(i = 0; i < C.rows; i++) {
+        const double *a = matrix_row(A, i);
+        double *c = matrix_row(C, i);
+
+        for(k = 0; k < C.cols; k++) {
+            c[k] = 0;
+        }
+        for(j = 0; j < A.cols; j++) {
+            const double *b = matrix_row(B, j);
+
+            for(k = 0; k < C.cols; k++) {
+                c[k] += a[j] * b[k];
+            }
+        }
+    }
+}
+/******************************************************************************/
+
+#ifdef SPKMEANS_BLAS
+/********************************************* STATIC FUNCTION DEFINITIONS
+ * (THE BLAS AND LAPACK BACKENDS)
+ * **************************************************************/
+static int blas_adjacent(dpoint_t input[], size_t num_data, size_t dim,
+                         matrix_t W) {
+    arena_t *arena = arena_thread();
+    arena_mark_t mark;
+    double *points, *norms;
+    size_t i, j;
+
+    if(NULL == arena)
+        return BAD_ALLOC;
+    mark = arena_mark(arena);
+
+    points = arena_alloc(arena, num_data * dim * sizeof(double), false);
+    norms = arena_alloc(arena, num_data * sizeof(double), false);
+    if(NULL == points || NULL == norms) {
+        arena_release(arena, mark);
+        return BAD_ALLOC;
+    }
+
+    for(i = 0; i < num_data; i++) {
+        memcpy(points + i * dim, input[i].data, dim * sizeof(double));
+        norms[i] = cblas_ddot((int)dim, input[i].data, 1, input[i].data, 1);
+    }
+
+    /* The upper triangle of W holds the dot products of the datapoints */
+    cblas_dsyrk(CblasRowMajor, CblasUpper, CblasNoTrans, (int)num_data,
+                (int)dim, 1.0, points, (int)dim, 0.0, W.data, (int)W.stride);
+
+    for(i = 0; i < num_data; i++) {
+        matrix_set(W, i, i, 0);
+
+        for(j = i + 1; j < num_data; j++) {
+            double squared = norms[i] + norms[j] - 2 * matrix_get(W, i, j);
+            double tmp;
+
+            /* The expansion may turn out slightly negative for close points */
+            tmp = exp(sqrt((squared > 0) ? squared : 0) * (-0.5));
+            matrix_set(W, i, j, tmp);
+        }
+    }
+    matrix_mirror_upper(W);
+
+    arena_release(arena, mark);
+    return 0;
+}
+
+static void blas_rotate(matrix_t V, size_t i, size_t j, double c, double s) {
+    /* drot computes (c * x + s * y, c * y - s * x), hence the negated s */
+    cblas_drot((int)V.rows, V.data + i, (int)V.stride, V.data + j,
+               (int)V.stride, c, -s);
+}
+
+static void blas_product(matrix_t A, matrix_t B, matrix_t C) {
+    cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, (int)C.rows,
+                (int)C.cols, (int)A.cols, 1.0, A.data, (int)A.stride, B.data,
+                (int)B.stride, 0.0, C.data, (int)C.stride);
+}
+
+static int lapack_eigen(const backend_t *backend, matrix_t mat, double *values,
+                        matrix_t vectors) {
+    arena_t *arena = arena_thread();
+    arena_mark_t mark;
+    matrix_t Z;
+    const int n = (int)mat.rows, query = -1;
+    const double zero = 0;
+    int lda, ldz, found, info, lwork, liwork, *support, *iwork;
+    double work_size, *work;
+    size_t i, k;
+    (void)backend;
+
+    if(NULL == arena)
+        return BAD_ALLOC;
+    mark = arena_mark(arena);
+
+    /* A symmetric row-major matrix is its own column-major matrix, which
+     * dsyevr overwrites in place. The eigen vectors are the columns of Z
+     * (column-major), i.e. its rows as they're stored. */
+    if(matrix_new_scratch(mat.rows, mat.cols, true, &Z) ||
+       NULL == (support = arena_alloc(arena, 2 * mat.rows * sizeof(int),
+                                      false)))
+        goto error;
+    lda = (int)mat.stride;
+    ldz = (int)Z.stride;
+
+    /* Ask for the sizes of the workspaces first */
+    dsyevr_("V", "A", "L", &n, mat.data, &lda, &zero, &zero, &query, &query,
+            &zero, &found, values, Z.data, &ldz, support, &work_size, &query,
+            &liwork, &query, &info, 1, 1, 1);
+    if(0 != info)
+        goto error;
+    lwork = (int)work_size;
+    if(NULL == (work = arena_alloc(arena, lwork * sizeof(double), false)) ||
+       NULL == (iwork = arena_alloc(arena, liwork * sizeof(int), false)))
+        goto error;
+
+    dsyevr_("V", "A", "L", &n, mat.data, &lda, &zero, &zero, &query, &query,
+            &zero, &found, values, Z.data, &ldz, support, work, &lwork, iwork,
+            &liwork, &info, 1, 1, 1);
+    if(0 != info || found != n)
+        goto error;
+
+    for(i = 0; i < vectors.rows; i++) {
+        for(k = 0; k < vectors.cols; k++) {
+            matrix_set(vectors, i, k, matrix_get(Z, k, i));
+        }
+    }
+
+    arena_release(arena, mark);
+    return 0;
+
+error:
+    arena_release(arena, mark);
+    return BAD_ALLOC;
+}
+/******************************************************************************/
+#endif
@@ -0,0 +1,80 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include "matrix.h"
+#include <stdlib.h>
+
+/* The environment variable that names the backend (see backend_init) */
+#define BACKEND_ENV "SPKMEANS_BACKEND"
+
+/* The name of the backend that's used unless another one is named */
+#define BACKEND_DEFAULT "reference"
+
+/* Define a structure that will hold a linear algebra backend: the heavy
+ * numerical kernels of the goals, as a table of functions. Every backend
+ * computes the same things, but may compute them differently (in another
+ * order of operations, or by another algorithm altogether), hence only the
+ * reference backend reproduces the outputs of the original implementation
+ * exactly (as they're printed, to 4 decimal places).
+ *
+ * 	adjacent: fills the num_data x num_data matrix <W> with the weights
+ * 		exp(-||x_i - x_j|| / 2) of every pair of datapoints (and zeros on its
+ * 		diagonal). Returns 0 on success, and BAD_ALLOC in case of an
+ * 		allocation failure.
+ * 	scale: stores I - D * W * D in <output> (every element of it is written),
+ * 		where D is the diagonal matrix whose diagonal is <D_sqrt>. <output>
+ * 		may be <W> itself.
+ * 	rotate: applies the rotation of the columns <i> < <j> of <V> by <c>, <s>
+ * 		in place (a right-hand multiplication of V by a jacobi rotation).
+ * 	eigen: finds all of the eigen values of the symmetric matrix <mat> (into
+ * 		<values>, an array of mat.rows elements) and their eigen vectors (into
+ * 		the columns of <vectors>, a mat.rows x mat.rows matrix that starts as
+ * 		the identity). The eigen values aren't necessarily sorted. <mat> may
+ * 		be overwritten (it's the working matrix of the solver). Returns 0 on
+ * 		success, and BAD_ALLOC in case of an allocation failure.
+ * 	product: stores A * B in <C> (every element of it is written).
+ *
+ * The matrices may be padded (see matrix_row), unless stated otherwise. */
+typedef struct backend_t {
+    const char *name;
+    int (*adjacent)(dpoint_t input[], size_t num_data, size_t dim,
+                    matrix_t W);
+    void (*scale)(matrix_t W, const double *D_sqrt, matrix_t output);
+    void (*rotate)(matrix_t V, size_t i, size_t j, double c, double s);
+    int (*eigen)(const struct backend_t *backend, matrix_t mat,
+                 double *values, matrix_t vectors);
+    void (*product)(matrix_t A, matrix_t B, matrix_t C);
+} backend_t;
+
+/* Returns the backend of the given name, or NULL if it isn't built in. The
+ * backends are:
+ * 		reference: the loops of this project (vectorized by the kernels of the
+ * 			instruction set, see isa.h), and Jacobi's algorithm.
+ * 		blas: the kernels of a CBLAS library (dsyrk for the weights, drot for
+ * 			the rotations and dgemm for the products), still with Jacobi's
+ * 			algorithm.
+ * 		lapack: the blas backend, whose eigen values and vectors are found by
+ * 			LAPACK's dsyevr instead (sorted, and precise regardless of the
+ * 			amount of rotations Jacobi's algorithm is limited to).
+ * The blas and lapack backends are built in only when this project is built
+ * with SPKMEANS_BLAS defined (see comp.sh and setup.py). */
+const backend_t *backend_find(const char *name);
+
+/* Makes the backend of the given name the one that's used from now on. The
+ * runs that are already planned keep the backend they were planned with (see
+ * budget_plan_t), so a switch never reaches a run that's underway. Returns 0
+ * on success, and BAD_INPUT in case it isn't built in (then the backend is
+ * left as is). */
+int backend_select(const char *name);
+
+/* Selects the backend named by the BACKEND_ENV environment variable (or
+ * BACKEND_DEFAULT, if it's unset). Returns 0 on success, and BAD_INPUT in case
+ * it isn't built in (then BACKEND_DEFAULT is selected). */
+int backend_init(void);
+
+/* Returns the backend that's used. The first call selects it (see
+ * backend_init), unless one was selected already. A run calls it once (see
+ * budget_plan), and sticks to what it returned. */
+const backend_t *backend_current(void);
+
+#endif /* BACKEND_H */
@@ -0,0 +1,245 @@
+#include "budget.h"
+#include "backend.h"
+#include "disk.h"
+#include "eigen.h"
+#include <string.h>
+
+/********************************************* STATIC FUNCTION DECLARATIONS
+ * (BUDGET)
+ * **************************************************************/
+/* Returns the memory that's available on the host (in bytes), or 0 if it
+ * can't be found */
+static size_t budget_available(void);
+
+/* The plans that are tried, from the fastest to the one that needs the least
+ * memory (see budget_plan) */
+static const struct {
+    bool jacobi_only;
+    bool out_of_core;
+} plans[] = {{false, false}, {true, false}, {false, true}, {true, true}};
+
+/* Returns the bytes of a num_data x num_data matrix whose rows are padded
+ * (see matrix_new_padded) */
+static size_t budget_padded_square(size_t num_data);
+
+/* Returns the bytes that the eigen solver of <backend> needs on top of its
+ * matrix and the eigen vectors (see backend.h) */
+static size_t budget_solver(const backend_t *backend, size_t num_data,
+                            bool jacobi_only);
+
+/* The memory budget (0 for none), unless it's the memory that's available
+ * at the time */
+static size_t limit = 0;
+static bool automatic = false;
+/******************************************************************************/
+
+/********************************************* GLOBAL FUNCTIONS OF THE BUDGET
+ * **************************************************************/
+int budget_init(void) {
+    const char *value = getenv(BUDGET_ENV);
+    const char *units = "KMGT";
+    unsigned long amount;
+    char *end;
+
+    limit = 0;
+    automatic = false;
+    if(NULL == value || '\0' == *value)
+        return 0;
+
+    if(strcmp(value, "auto") == 0) {
+        automatic = true;
+        return 0;
+    }
+
+    if(*value < '0' || *value > '9')
+        return BAD_INPUT;
+    amount = strtoul(value, &end, 10);
+    if('\0' != *end) {
+        const char *unit = strchr(units, *end);
+        size_t i;
+
+        if(NULL == unit || '\0' != end[1])
+            return BAD_INPUT;
+        for(i = 0; i <= (size_t)(unit - units); i++) {
+            if(amount > (unsigned long)-1 / 1024)
+                return BAD_INPUT;
+            amount *= 1024;
+        }
+    }
+
+    limit = amount;
+    return 0;
+}
+
+size_t budget_limit(void) {
+    return automatic ? budget_available() : limit;
+}
+
+void budget_plan_init(budget_plan_t *plan) {
+    plan->goal = "no goal yet";
+    plan->num_data = 0;
+    plan->dim = 0;
+    plan->estimate = 0;
+    plan->limit = 0;
+    plan->backend = backend_current();
+    plan->jacobi_only = false;
+    plan->out_of_core = false;
+}
+
+size_t budget_estimate(const backend_t *backend, const char *goal,
+                       size_t num_data, size_t dim, bool jacobi_only,
+                       bool out_of_core) {
+    /* The n x n matrices (the weights, the laplacian, the eigen vectors and
+     * the output of jacobi), unless they're mapped */
+    const size_t square =
+        out_of_core ? 0 : num_data * num_data * sizeof(double);
+    const size_t padded = out_of_core ? 0 : budget_padded_square(num_data);
+    const size_t vector = num_data * sizeof(double);
+    size_t points, adjacent, laplacian, spectrum;
+
+    /* The datapoints (a single matrix, whose rows are viewed by the
+     * datapoints), and the scratch of the weights (a transposed copy of the
+     * datapoints, and a row of distances) */
+    points = num_data * dim * sizeof(double) + num_data * sizeof(dpoint_t);
+    adjacent = num_data * dim * sizeof(double) + vector;
+
+    /* The degrees are found in place of the weights */
+    if(strcmp(goal, "wam") == 0 || strcmp(goal, "ddg") == 0)
+        return points + square + adjacent;
+
+    /* The normalized laplacian is built in place of the weights (along with
+     * the degrees) */
+    laplacian = square + ((adjacent > vector) ? adjacent : vector);
+    if(strcmp(goal, "lnorm") == 0)
+        return points + laplacian;
+
+    /* The eigen solver works in place of its matrix, along with the eigen
+     * vectors, the eigen values and the scratch of the solver */
+    spectrum = square + padded + vector +
+               budget_solver(backend, num_data, jacobi_only);
+    if(strcmp(goal, "jacobi") == 0) {
+        /* The output (the eigen values above the eigen vectors) is built once
+         * the matrix is freed, while the eigen vectors are still held */
+        size_t output =
+            padded + square + vector + num_data * sizeof(eigen_t);
+
+        return points + ((spectrum > output) ? spectrum : output);
+    }
+
+    /* T is normalized in place of the eigen vectors, and the kmeans mechanism
+     * clusters its rows. The model keeps a copy of the datapoints, and their
+     * degrees. */
+    if(strcmp(goal, "spk") == 0)
+        return points + ((laplacian > spectrum) ? laplacian : spectrum);
+    if(strcmp(goal, "fit") == 0)
+        return 2 * points + vector +
+               ((laplacian > spectrum) ? laplacian : spectrum);
+
+    return points;
+}
+
+int budget_plan(const char *goal, size_t num_data, size_t dim,
+                budget_plan_t *plan) {
+    size_t i;
+
+    plan->goal = goal;
+    plan->num_data = num_data;
+    plan->dim = dim;
+    plan->limit = budget_limit();
+    plan->backend = backend_current();
+
+    /* The first plan that fits is taken (Jacobi's algorithm needs the least
+     * memory of all of the eigen solvers). A scratch directory without a
+     * budget means that the runs are wanted out of core. */
+    for(i = (disk_enabled() && 0 == plan->limit) ? 2 : 0;
+        i < sizeof(plans) / sizeof(plans[0]); i++) {
+        if(plans[i].out_of_core && !disk_enabled())
+            break;
+
+        plan->jacobi_only = plans[i].jacobi_only;
+        plan->out_of_core = plans[i].out_of_core;
+        plan->estimate =
+            budget_estimate(plan->backend, goal, num_data, dim,
+                            plan->jacobi_only, plan->out_of_core);
+        if(!budget_exceeded(plan))
+            break;
+    }
+
+    disk_thread_use(plan->out_of_core);
+    return budget_exceeded(plan) ? BAD_ALLOC : 0;
+}
+
+bool budget_exceeded(const budget_plan_t *plan) {
+    return 0 != plan->limit && plan->estimate > plan->limit;
+}
+
+void budget_report(FILE *file, const budget_plan_t *plan) {
+    const char *estimate_unit, *limit_unit;
+    size_t estimate = budget_scale(plan->estimate, &estimate_unit);
+    size_t limit = budget_scale(plan->limit, &limit_unit);
+
+    fprintf(file,
+            "%s of %lu datapoints needs about %lu %s, over the memory budget "
+            "of %lu %s\n",
+            plan->goal, (unsigned long)plan->num_data,
+            (unsigned long)estimate, estimate_unit, (unsigned long)limit,
+            limit_unit);
+}
+
+size_t budget_scale(size_t bytes, const char **unit) {
+    static const char *units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    size_t i;
+
+    for(i = 0; bytes > 10240 && i + 1 < sizeof(units) / sizeof(units[0]);
+        i++) {
+        bytes = bytes / 1024 + (0 != bytes % 1024);
+    }
+
+    *unit = units[i];
+    return bytes;
+}
+/******************************************************************************/
+
+/********************************************* STATIC FUNCTION DEFINITIONS
+ * (RELATED TO THE BUDGET)
+ * **************************************************************/
+static size_t budget_available(void) {
+    FILE *meminfo = fopen("/proc/meminfo", "r");
+    char line[128];
+    unsigned long kib;
+    size_t available = 0;
+
+    if(NULL == meminfo)
+        return 0;
+
+    while(NULL != fgets(line, sizeof(line), meminfo)) {
+        if(1 == sscanf(line, "MemAvailable: %lu kB", &kib)) {
+            available = (size_t)kib * 1024;
+            break;
+        }
+    }
+
+    fclose(meminfo);
+    return available;
+}
+
+static size_t budget_padded_square(size_t num_data) {
+    const size_t per_line = MATRIX_ALIGN / sizeof(double);
+    size_t stride = (num_data + per_line - 1) / per_line * per_line;
+
+    return num_data * stride * sizeof(double);
+}
+
+static size_t budget_solver(const backend_t *backend, size_t num_data,
+                            bool jacobi_only) {
+    /* Jacobi's algorithm copies two columns aside */
+    if(jacobi_only || backend->eigen == eigen_jacobi_solve)
+        return 2 * num_data * sizeof(double);
+
+    /* dsyevr finds the eigen vectors into a matrix of its own, and needs
+     * workspaces of 26 doubles and 10 ints per row (along with 2 ints of
+     * support) */
+    return budget_padded_square(num_data) + 26 * num_data * sizeof(double) +
+           12 * num_data * sizeof(int);
+}
+/******************************************************************************/
@@ -0,0 +1,90 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include "backend.h"
+#include "matrix.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The environment variable that sets the memory budget (see budget_init) */
+#define BUDGET_ENV "SPKMEANS_MEMORY_BUDGET"
+
+/* Define a structure that will hold the plan of a single run: how it's
+ * performed, and the peak of the memory it's estimated to need that way (see
+ * budget_estimate). A plan of a run that doesn't fit the budget holds the
+ * cheapest estimate there is (see budget_exceeded).
+ * 		goal: the goal that was planned ("wam", "ddg", "lnorm", "jacobi",
+ * 			"spk" or "fit").
+ * 		num_data, dim: the datapoints it was planned for.
+ * 		limit: the budget it was planned within (0 for none).
+ * 		backend: the backend of the run, taken once it's planned (see
+ * 			backend_current). Every stage of the run uses it, even if another
+ * 			backend is selected meanwhile.
+ * 		jacobi_only: whether the eigen values are found by Jacobi's algorithm
+ * 			even if the backend has an eigen solver of its own (which needs
+ * 			more memory, see backend.h).
+ * 		out_of_core: whether the n x n matrices of the run are mapped from
+ * 			files of the scratch directory (see disk.h), rather than held in
+ * 			memory. */
+typedef struct budget_plan_t {
+    const char *goal;
+    size_t num_data;
+    size_t dim;
+    size_t estimate;
+    size_t limit;
+    const backend_t *backend;
+    bool jacobi_only;
+    bool out_of_core;
+} budget_plan_t;
+
+/* Sets the memory budget according to the BUDGET_ENV environment variable:
+ * unset or empty leaves the runs unlimited, "auto" is the memory that's
+ * available on the host when the run is planned (MemAvailable of
+ * /proc/meminfo, or unlimited if it can't be read), and otherwise it's an
+ * amount of bytes, optionally followed by K, M, G or T (powers of 1024).
+ * Returns 0 on success, and BAD_INPUT in case the value is malformed (then
+ * the runs are left unlimited). */
+int budget_init(void);
+
+/* Returns the memory budget of the runs (in bytes), or 0 if they're
+ * unlimited (see budget_init) */
+size_t budget_limit(void);
+
+/* Initializes an empty plan: no goal, the plan of the backend that's used
+ * (in memory), no limit */
+void budget_plan_init(budget_plan_t *plan);
+
+/* Returns the peak of the memory (in bytes) that <goal> is estimated to need
+ * for <num_data> datapoints of <dim> coordinates, along with the datapoints
+ * themselves. Unless <jacobi_only>, the eigen solver of <backend> is used. If
+ * <out_of_core>, the n x n matrices are mapped, hence they aren't a part of
+ * the peak. An unknown goal needs the datapoints only. */
+size_t budget_estimate(const backend_t *backend, const char *goal,
+                       size_t num_data, size_t dim, bool jacobi_only,
+                       bool out_of_core);
+
+/* Plans <goal> for <num_data> datapoints of <dim> coordinates within the
+ * memory budget, into <plan>, for the backend that's used (see
+ * backend_current): the eigen solver of the backend is used, unless
+ * it doesn't fit while Jacobi's algorithm does. If neither fits and there's a
+ * scratch directory (see disk_init), the run is out of core, which it always
+ * is if there's a scratch directory and no budget. The plan is followed by the
+ * large matrices of the calling thread (see disk_thread_use).
+ * Returns 0 on success, and BAD_ALLOC in case no plan fits (before anything is
+ * allocated). */
+int budget_plan(const char *goal, size_t num_data, size_t dim,
+                budget_plan_t *plan);
+
+/* Returns whether the given plan doesn't fit its budget */
+bool budget_exceeded(const budget_plan_t *plan);
+
+/* Writes the estimate of the given plan (which doesn't fit its budget) into
+ * <file>, as a single line */
+void budget_report(FILE *file, const budget_plan_t *plan);
+
+/* Returns the given amount of bytes in the smallest unit (B, KiB, MiB, GiB or
+ * TiB) that keeps it at 10240 units at most (rounded up), and stores the name
+ * of the unit in <unit> */
+size_t budget_scale(size_t bytes, const char **unit);
+
+#endif /* BUDGET_H */
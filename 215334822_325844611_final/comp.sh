@@ -1,4 +1,36 @@
 #!/bin/bash
 
+# The debug build (SPKMEANS_DEBUG=1 bash comp.sh) bounds checks every access
+# of the matrix accessors (see matrix.h), and keeps the debug info. Running the
+# tester with SPKMEANS_DEBUG=1 builds both interfaces this way.
+flags="-ansi -Wall -Wextra -Werror -pedantic-errors"
+if [[ -n $SPKMEANS_DEBUG && $SPKMEANS_DEBUG != 0 ]]; then
+    flags="$flags -g -DMATRIX_DEBUG"
+fi
+
+# The BLAS build (SPKMEANS_BLAS=1 bash comp.sh) adds the blas and lapack
+# backends (see backend.h), linked against SPKMEANS_BLAS_LIBS (OpenBLAS by
+# default). The backend is picked at runtime by SPKMEANS_BACKEND.
+libs="-lm -pthread"
+if [[ -n $SPKMEANS_BLAS && $SPKMEANS_BLAS != 0 ]]; then
+    flags="$flags -DSPKMEANS_BLAS"
+    libs="$libs ${SPKMEANS_BLAS_LIBS:--lopenblas}"
+fi
+
+sources="matrix.c arena.c backend.c isa.c profile.c budget.c disk.c graph.c eigen.c kmeanspp.c distance.c loader.c writer.c spkmeans.c spkmeans_goals.c"
+
+# The benchmarks replace the main of spkmeans.c: bash comp.sh benchmark times
+# every stage of the pipeline on synthetic datasets (see
+# ../generated/benchmark_spkmeans.c), and bash comp.sh parsing times the CSV
+# loader against fscanf (see ../generated/benchmark_parsing.c)
+if [[ $1 == "benchmark" ]]; then
+    gcc $flags -DSPKMEANS_NO_MAIN -I. ../generated/benchmark_spkmeans.c $sources $libs -o ../generated/benchmark_spkmeans
+    exit
+fi
+if [[ $1 == "parsing" ]]; then
+    gcc $flags -DSPKMEANS_NO_MAIN -I. ../generated/benchmark_parsing.c $sources $libs -o ../generated/benchmark_parsing
+    exit
+fi
+
 # assembling and linking
-gcc -ansi -Wall -Wextra -Werror -pedantic-errors matrix.c graph.c eigen.c spkmeans.c spkmeans_goals.c -lm -o spkmeans
+gcc $flags $sources $libs -o spkmeans
@@ -0,0 +1,201 @@
+#define _POSIX_C_SOURCE 200809L
+#include "disk.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/********************************************* STATIC FUNCTION DECLARATIONS
+ * (DISK)
+ * **************************************************************/
+/* The name of the files of the scratch directory (see mkstemp) */
+#define DISK_TEMPLATE "spkmeans-XXXXXX"
+
+/* Define a structure that will hold a mapping of the scratch directory, as a
+ * node of the list of all of them */
+typedef struct disk_mapping_t {
+    void *addr;
+    size_t len;
+    struct disk_mapping_t *next;
+} disk_mapping_t;
+
+/* Creates a file of <size> bytes within the scratch directory, which is
+ * removed right away. Returns its descriptor, or -1 on failure. */
+static int disk_create(size_t size);
+
+/* The scratch directory (NULL for none) */
+static const char *directory = NULL;
+
+/* The mappings that weren't freed yet, guarded by <mappings_lock> */
+static disk_mapping_t *mappings = NULL;
+static pthread_mutex_t mappings_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* The key of whether every thread maps its large matrices (non-NULL if it
+ * does) */
+static pthread_key_t use_key;
+static pthread_once_t use_key_once = PTHREAD_ONCE_INIT;
+static void disk_make_key(void);
+/******************************************************************************/
+
+/********************************************* GLOBAL FUNCTIONS OF THE DISK
+ * **************************************************************/
+int disk_init(void) {
+    const char *value = getenv(DISK_ENV);
+    struct stat st;
+
+    directory = NULL;
+    if(NULL == value || '\0' == *value)
+        return 0;
+
+    if(0 != stat(value, &st) || !S_ISDIR(st.st_mode) ||
+       0 != access(value, W_OK | X_OK))
+        return BAD_INPUT;
+
+    directory = value;
+    return 0;
+}
+
+bool disk_enabled(void) {
+    return NULL != directory;
+}
+
+void disk_thread_use(bool use) {
+    if(0 != pthread_once(&use_key_once, disk_make_key))
+        return;
+
+    pthread_setspecific(use_key, use ? (void *)&use_key : NULL);
+}
+
+bool disk_thread_used(void) {
+    if(NULL == directory || 0 != pthread_once(&use_key_once, disk_make_key))
+        return false;
+
+    return NULL != pthread_getspecific(use_key);
+}
+
+int disk_alloc(size_t size, void **output) {
+    disk_mapping_t *mapping;
+    void *addr;
+    int fd;
+
+    *output = NULL;
+    if(NULL == directory)
+        return BAD_ALLOC;
+
+    /* A matrix without any elements still gets a mapping */
+    size = size ? size : 1;
+    if(NULL == (mapping = malloc(sizeof(*mapping))))
+        return BAD_ALLOC;
+    if(0 > (fd = disk_create(size))) {
+        free(mapping);
+        return BAD_ALLOC;
+    }
+
+    /* The mapping holds the file on its own */
+    addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(MAP_FAILED == addr) {
+        free(mapping);
+        return BAD_ALLOC;
+    }
+
+    mapping->addr = addr;
+    mapping->len = size;
+    pthread_mutex_lock(&mappings_lock);
+    mapping->next = mappings;
+    mappings = mapping;
+    pthread_mutex_unlock(&mappings_lock);
+
+    *output = addr;
+    return 0;
+}
+
+bool disk_free(void *data) {
+    disk_mapping_t **link, *mapping = NULL;
+
+    /* Without a scratch directory nothing is ever mapped, hence every matrix
+     * is freed without taking the lock */
+    if(NULL == directory)
+        return false;
+
+    pthread_mutex_lock(&mappings_lock);
+    for(link = &mappings; NULL != *link; link = &(*link)->next) {
+        if((*link)->addr == data) {
+            mapping = *link;
+            *link = mapping->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mappings_lock);
+
+    if(NULL == mapping)
+        return false;
+
+    munmap(mapping->addr, mapping->len);
+    free(mapping);
+    return true;
+}
+void disk_advise(const void *data, bool sequential) {
+    disk_mapping_t *mapping;
+
+    if(NULL == directory)
+        return;
+
+    pthread_mutex_lock(&mappings_lock);
+    for(mapping = mappings; NULL != mapping; mapping = mapping->next) {
+        if(mapping->addr == data) {
+            posix_madvise(mapping->addr, mapping->len,
+                          sequential ? POSIX_MADV_SEQUENTIAL
+                                     : POSIX_MADV_NORMAL);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mappings_lock);
+}
+/******************************************************************************/
+
+/********************************************* STATIC FUNCTION DEFINITIONS
+ * (RELATED TO THE DISK)
+ * **************************************************************/
+static int disk_create(size_t size) {
+    char *path;
+    int fd, signal;
+
+    if((off_t)size < 0 || (size_t)(off_t)size != size)
+        return -1;
+
+    path = malloc(strlen(directory) + sizeof("/" DISK_TEMPLATE));
+    if(NULL == path)
+        return -1;
+    sprintf(path, "%s/%s", directory, DISK_TEMPLATE);
+
+    fd = mkstemp(path);
+    if(0 <= fd) {
+        unlink(path);
+    }
+    free(path);
+    if(0 > fd)
+        return -1;
+
+    /* The blocks are reserved up front, so that a full disk fails here rather
+     * than on a write into the mapping (SIGBUS). A file system that can't
+     * reserve them gets a sparse file. */
+    signal = posix_fallocate(fd, 0, (off_t)size);
+    if(0 != signal && (ENOSPC == signal || EFBIG == signal ||
+                       0 != ftruncate(fd, (off_t)size)))
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static void disk_make_key(void) {
+    pthread_key_create(&use_key, NULL);
+}
+/******************************************************************************/
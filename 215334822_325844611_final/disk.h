@@ -0,0 +1,52 @@
+#ifndef DISK_H
+#define DISK_H
+
+#include "matrix.h"
+#include <stdlib.h>
+
+/* The environment variable that names the scratch directory of the runs that
+ * are out of core (see disk_init) */
+#define DISK_ENV "SPKMEANS_SCRATCH_DIR"
+
+/* Sets the scratch directory according to the DISK_ENV environment variable:
+ * unset or empty leaves every run in memory, and otherwise the n x n matrices
+ * of the runs that are planned out of core (see budget_plan) are mapped from
+ * files of that directory. Returns 0 on success, and BAD_INPUT in case it
+ * isn't a writable directory (then every run is left in memory). */
+int disk_init(void);
+
+/* Returns whether there's a scratch directory (see disk_init) */
+bool disk_enabled(void);
+
+/* Sets whether the large matrices of the calling thread (see
+ * matrix_new_large) are mapped from the scratch directory, until it's set
+ * again. It's set by every plan of a run (see budget_plan). */
+void disk_thread_use(bool use);
+
+/* Returns whether the large matrices of the calling thread are mapped from
+ * the scratch directory (which never holds if there's none) */
+bool disk_thread_used(void);
+
+/* Maps <size> bytes of a new file of the scratch directory into <output>,
+ * zero-initialized and aligned to a page. The file is removed right away, so
+ * that its blocks are released along with the mapping (see disk_free), even
+ * if the process dies. The whole file is reserved up front, and the mapping
+ * is left with the default readahead (see disk_advise).
+ * Returns 0 on success, and BAD_ALLOC otherwise (e.g. there's no scratch
+ * directory, or not enough space within it), in which case <output> is
+ * NULL. */
+int disk_alloc(size_t size, void **output);
+
+/* Unmaps the given mapping (see disk_alloc). Returns false (and does
+ * nothing) if <data> isn't the address of such a mapping, right away if
+ * there's no scratch directory. */
+bool disk_free(void *data);
+
+/* Advises the given mapping (see disk_alloc) to be accessed sequentially if
+ * <sequential> (the graph matrices are built, scanned and scaled row by row),
+ * and with the default readahead otherwise (Jacobi's rotations walk two
+ * columns at a time). Does nothing if <data> isn't the address of such a
+ * mapping. */
+void disk_advise(const void *data, bool sequential);
+
+#endif /* DISK_H */
@@ -0,0 +1,194 @@
+#include "distance.h"
+#include "isa.h"
+#include <float.h>
+#include <math.h>
+
+/********************************************* STATIC FUNCTION DECLARATIONS
+ * (BLOCKED DISTANCE KERNEL)
+ * **************************************************************/
+/* Size of the micro kernel: the dot products of DISTANCE_MICRO_POINTS points
+ * with DISTANCE_MICRO_WIDTH centroids are accumulated together (in registers),
+ * so that every loaded coordinate is used by several products. The micro
+ * kernel is the dot kernel of the instruction set (see isa.h). */
+#define DISTANCE_MICRO_POINTS ISA_DOT_POINTS
+#define DISTANCE_MICRO_WIDTH ISA_DOT_WIDTH
+
+/* Copy the centroids [tile_begin, tile_end) into <tile>, transposed: the k-th
+ * coordinates of all of the centroids of the tile are contiguous. Rows of the
+ * tile are <tile_rows> long, and the centroids beyond tile_end are zeroed. */
+static void distance_pack_tile(matrix_t centroids, size_t tile_begin,
+                               size_t tile_end, size_t tile_rows, double *tile);
+
+/* Handle a single block of points against a single packed tile of centroids
+ * (starting at the centroid <tile_begin>, <tile_len> centroids long), updating
+ * the running minimum of every point of the block (<best_dists>,
+ * <best_labels>), and the running second minimum (<second_dists>). */
+static void distance_block_tile(matrix_t points, size_t block_begin,
+                                size_t block_end, const double *point_norms,
+                                const double *tile, size_t tile_rows,
+                                size_t tile_begin, size_t tile_len,
+                                const double *centroid_norms,
+                                double *best_dists, double *second_dists,
+                                size_t *best_labels);
+/******************************************************************************/
+
+/********************************************* GLOBAL FUNCTIONS OF THE DISTANCE
+ * MODULE **************************************************************/
+void distance_row_norms(matrix_t mat, double *output) {
+    size_t i, k;
+
+    for(i = 0; i < mat.rows; i++) {
+        const double *row = matrix_row(mat, i);
+        double sum = 0.0;
+
+        for(k = 0; k < mat.cols; k++) {
+            sum += row[k] * row[k];
+        }
+
+        output[i] = sum;
+    }
+}
+
+int distance_argmin(matrix_t points, const double *point_norms,
+                    matrix_t centroids, const double *centroid_norms,
+                    size_t *labels, double *min_dists, double *gaps) {
+    double best_dists[DISTANCE_POINTS_BLOCK];
+    double second_dists[DISTANCE_POINTS_BLOCK];
+    size_t best_labels[DISTANCE_POINTS_BLOCK];
+    size_t tile_rows, block_begin, block_end, tile_begin, tile_end, p;
+    double *tile;
+
+    /* Amount of centroids in a tile: a multiple of the micro kernel's width,
+     * and at least one micro kernel */
+    tile_rows = DISTANCE_TILE_BYTES / (sizeof(double) * points.cols);
+    tile_rows -= tile_rows % DISTANCE_MICRO_WIDTH;
+    tile_rows = (tile_rows == 0) ? DISTANCE_MICRO_WIDTH : tile_rows;
+
+    tile = malloc(tile_rows * points.cols * sizeof(double));
+    if(NULL == tile)
+        return BAD_ALLOC;
+
+    for(block_begin = 0; block_begin < points.rows;
+        block_begin += DISTANCE_POINTS_BLOCK)
+    {
+        block_end = block_begin + DISTANCE_POINTS_BLOCK;
+        block_end = (block_end > points.rows) ? points.rows : block_end;
+
+        for(p = 0; p < block_end - block_begin; p++) {
+            best_dists[p] = HUGE_VAL;
+            second_dists[p] = HUGE_VAL;
+            best_labels[p] = 0;
+        }
+
+        for(tile_begin = 0; tile_begin < centroids.rows;
+            tile_begin += tile_rows)
+        {
+            tile_end = tile_begin + tile_rows;
+            tile_end = (tile_end > centroids.rows) ? centroids.rows : tile_end;
+
+            /* With a single tile, it's packed once for all of the blocks */
+            if(block_begin == 0 || tile_rows < centroids.rows) {
+                distance_pack_tile(centroids, tile_begin, tile_end, tile_rows,
+                                   tile);
+            }
+
+            distance_block_tile(points, block_begin, block_end, point_norms,
+                                tile, tile_rows, tile_begin,
+                                tile_end - tile_begin, centroid_norms,
+                                best_dists, second_dists, best_labels);
+        }
+
+        for(p = 0; p < block_end - block_begin; p++) {
+            labels[block_begin + p] = best_labels[p];
+            if(NULL != min_dists) {
+                /* The expansion may go slightly below zero due to rounding */
+                min_dists[block_begin + p] =
+                    (best_dists[p] > 0.0) ? best_dists[p] : 0.0;
+            }
+            if(NULL != gaps) {
+                gaps[block_begin + p] = second_dists[p] - best_dists[p];
+            }
+        }
+    }
+
+    free(tile);
+    return 0;
+}
+
+double distance_margin(size_t dim, double point_norm, double centroid_norm) {
+    /* Every expanded distance is off by up to (dim + 2) roundings of the
+     * norms, and so is every exact one (of at most twice the norms). The
+     * centering of the coordinates doubles it, and so does the gap. */
+    return 16.0 * (double)(dim + 2) * DBL_EPSILON * (point_norm + centroid_norm);
+}
+/******************************************************************************/
+
+/********************************************* STATIC FUNCTION DEFINITIONS
+ * (RELATED TO THE BLOCKED DISTANCE KERNEL)
+ * **************************************************************/
+static void distance_pack_tile(matrix_t centroids, size_t tile_begin,
+                               size_t tile_end, size_t tile_rows,
+                               double *tile) {
+    size_t c, k;
+
+    for(k = 0; k < centroids.cols; k++) {
+        double *row = tile + k * tile_rows;
+
+        for(c = tile_begin; c < tile_end; c++) {
+            row[c - tile_begin] = matrix_row(centroids, c)[k];
+        }
+        for(c = tile_end - tile_begin; c < tile_rows; c++) {
+            row[c] = 0.0;
+        }
+    }
+}
+
+static void distance_block_tile(matrix_t points, size_t block_begin,
+                                size_t block_end, const double *point_norms,
+                                const double *tile, size_t tile_rows,
+                                size_t tile_begin, size_t tile_len,
+                                const double *centroid_norms,
+                                double *best_dists, double *second_dists,
+                                size_t *best_labels) {
+    const isa_kernels_t *kernels = isa_kernels();
+    const double *x[DISTANCE_MICRO_POINTS];
+    double dot[DISTANCE_MICRO_POINTS * DISTANCE_MICRO_WIDTH];
+    size_t dim = points.cols, p, q, c, j, amount;
+
+    for(p = block_begin; p < block_end; p += DISTANCE_MICRO_POINTS) {
+        amount = block_end - p;
+        amount = (amount > DISTANCE_MICRO_POINTS) ? DISTANCE_MICRO_POINTS
+                                                  : amount;
+
+        /* A partial group of points repeats its first point (its results are
+         * simply ignored) */
+        for(q = 0; q < DISTANCE_MICRO_POINTS; q++) {
+            x[q] = matrix_row(points, p + ((q < amount) ? q : 0));
+        }
+
+        for(c = 0; c < tile_len; c += DISTANCE_MICRO_WIDTH) {
+            /* Micro kernel: consecutive centroids are contiguous in the
+             * packed tile */
+            kernels->dot(x, tile + c, tile_rows, dim, dot);
+
+            /* Fused argmin (in order, so that ties pick the lowest index) */
+            for(q = 0; q < amount; q++) {
+                size_t b = p + q - block_begin;
+
+                for(j = 0; j < DISTANCE_MICRO_WIDTH && c + j < tile_len; j++) {
+                    double dist = point_norms[p + q] -
+                                  2 * dot[q * DISTANCE_MICRO_WIDTH + j] +
+                                  centroid_norms[tile_begin + c + j];
+                    if(dist < best_dists[b]) {
+                        second_dists[b] = best_dists[b];
+                        best_dists[b] = dist;
+                        best_labels[b] = tile_begin + c + j;
+                    } else if(dist < second_dists[b]) {
+                        second_dists[b] = dist;
+                    }
+                }
+            }
+        }
+    }
+}
+/******************************************************************************/
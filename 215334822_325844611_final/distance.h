@@ -0,0 +1,51 @@
+#ifndef DISTANCE_H
+#define DISTANCE_H
+
+#include "matrix.h"
+#include <stdlib.h>
+
+/* Amount of points handled by each block of the blocked distance kernel */
+#define DISTANCE_POINTS_BLOCK 64
+
+/* Size (in bytes) of each tile of centroids in the blocked distance kernel.
+ * Chosen so that a tile, along with the current block of points, stays in the
+ * L1/L2 caches */
+#define DISTANCE_TILE_BYTES (16 * 1024)
+
+/* Store the squared euclidean norm of every row of <mat> in <output> (an
+ * array of mat.rows elements). */
+void distance_row_norms(matrix_t mat, double *output);
+
+/* For every row of <points>, find the closest row of <centroids> (squared
+ * euclidean distance), and store its index in <labels>. If <min_dists> isn't
+ * NULL, the matching squared distances are stored in it. If <gaps> isn't
+ * NULL, the gap between the closest distance and the second closest one is
+ * stored in it (HUGE_VAL for a single centroid), so that the points whose
+ * closest centroid isn't certain can be told (see distance_margin).
+ *
+ * The distances are computed through the norm expansion
+ * ||x - c||^2 = ||x||^2 - 2 x.c + ||c||^2, using the given precomputed norms
+ * (see distance_row_norms), as a blocked points x centroids product with a
+ * fused argmin. The centroids are traversed in tiles of DISTANCE_TILE_BYTES,
+ * so that each tile is reused by a whole block of points while it's still
+ * cached. Each tile is packed transposed, so that the dot products of a point
+ * with consecutive centroids are computed side by side. On ties, the lowest
+ * index is picked.
+ *
+ * Pre-Condition: points.cols == centroids.cols, centroids.rows > 0
+ *
+ * Returns 0 on success, and BAD_ALLOC in case of an allocation failure. */
+int distance_argmin(matrix_t points, const double *point_norms,
+                     matrix_t centroids, const double *centroid_norms,
+                     size_t *labels, double *min_dists, double *gaps);
+
+/* Returns a bound on the rounding error of the gap between two distances that
+ * are found through the norm expansion (see distance_argmin), for a point of
+ * the squared norm <point_norm> and centroids of squared norms up to
+ * <centroid_norm>, in <dim> dimensions. Two centroids whose distances are
+ * further apart than that are ordered just as their exact distances (see
+ * sqdist) are. The bound grows with the norms, hence the points and the
+ * centroids are better centered around the origin. */
+double distance_margin(size_t dim, double point_norm, double centroid_norm);
+
+#endif /* DISTANCE_H */
@@ -1,360 +1,390 @@
-#include "eigen.h"
-#include "matrix.h"
-#include <math.h>
-
-/********************************************* STATIC FUNCTION DECLARATIONS
- * (JACOBI's ALGORITHM)
- * **************************************************************/
-/* Given the diagonal matrix <mat_of_eigens>, pull the eigen values out of its
- * diagonal, sort them if needed, and determine how many of them we need to
- * store in the <output> argument. The determination of the amount of eigen
- * values, is done by the value of <K>. If K==0, then we use the heuristic gap
- * to determine a new K. Once K is determined, we store the <K>-first eigen
- * vectors into the <output> argument. Most of this function's work is to simply
- * format the output of the jacobi algorithm - And when needed, apply the
- * heuristic gap. */
-static int jacobi_format_output(matrix_t mat_vectors, matrix_t mat_of_eigens,
-                                size_t K, jacobi_t *output);
-
-/* In case K==0 was given as input, we try to determine a new valid K using the
- *eigen heuristic gap. <eigen_values_amount> is the amount of eigen values. We
- *need that for the heuristic's algorithm. Pre-Conditions: the given array of
- *eigen values must be sorted by value (remember: eigen is a struct) */
-static size_t jacobi_eigen_heuristic(eigen_t *sorted_eigen_values,
-                                     size_t eigen_values_amount);
-
-/* Given an the last stage of A_tag in the jacobi algorithm, extract its eigen
-   values. If sort equals <true>, sort the eigen values. An array of eigen
-   values would be assigned to the output argument. */
-static int jacobi_extract_eigen_values(matrix_t mat, bool sort,
-                                       eigen_t **output);
-
-/* In the jacobi algorithm, this is the function that transforms A_tag (the next
- * matrix in the recursive algorithm), through the current A matrix */
-static void jacobi_update_A_tag(matrix_t A_tag, matrix_t A, matrix_ind_t loc,
-                                double c, double s);
-
-/* Given the <c> and <s> and <i,j> (in <loc>), which we are supposed to build a
- rotation matrix upon, simply
- * apply the changes *in-place*, that would have occurred due to a right-hand
- multiplication in the rotation matrix.
- * This changes will be applied to the matrix <V>.
- * Pre-condition:
- - matrix_ind_t <loc> must be an index of the the largest off diagonal value, in
- the upper half of the current jacobi matrix. This means, that <loc> must point
- to an index that satisfies i < j. */
-static void jacobi_apply_rotation(matrix_t V, matrix_ind_t loc, double c,
-                                  double s);
-
-/* Calculate the rotation matrix using the given data, and store the result in
- * the pre-allocated `output`. */
-int eigen_build_rotation_matrix(matrix_ind_t loc, double c, double s,
-                                matrix_t output);
-
-/* Given two matrices, determine the distance between their sum of squared
- * off-diagonals */
-static double jacobi_distance_of_squared_offdiagonals(matrix_t mat1,
-                                                      matrix_t mat2);
-
-/* Calculae the values of 'c' and 's' of the desired rotation matrix */
-static void jacobi_calc_c_s(double *c, double *s, matrix_t current_jacobi_mat,
-                            matrix_ind_t loc);
-/******************************************************************************/
-
-/********************************************* GLOBAL FUNCTIONS OF THE EIGEN
- * MODULE **************************************************************/
-
-int eigen_jacobi(matrix_t mat, size_t K, jacobi_t *output) {
-    size_t iterations;
-    matrix_t A, A_tag, V;
-    matrix_ind_t loc;
-    double s, c;
-
-    A.data = NULL;
-    A_tag.data = NULL;
-    V.data = NULL;
-
-    if(matrix_identity(mat.rows, &V))
-        goto error;
-    if(matrix_clone(mat, &A_tag))
-        goto error;
-    if(matrix_clone(mat, &A))
-        goto error;
-
-    for(iterations = 0; iterations < max_jacobi_iterations; iterations++) {
-        matrix_copy(
-            A,
-            A_tag); /* matrices are created with equal dims - no error check */
-
-        loc = matrix_ind_of_largest_offdiagonal(A);
-        if(0 == matrix_get(A, loc.i, loc.j))
-            break; /* stop the algorithm if the matrix of the last iteration is
-                      diagonal (the next step will result in nan-s) */
-
-        jacobi_calc_c_s(&c, &s, A, loc);
-        jacobi_apply_rotation(
-            V, loc, c,
-            s); /* in-place multiplication of the rotation matrix of the current
-                   iteration and V (the output eigen vector matrix) */
-        jacobi_update_A_tag(
-            A_tag, A, loc, c,
-            s); /* updating the current matrix of the jacobi algorith into the
-                   new matrix of the next iteration */
-
-        if(jacobi_distance_of_squared_offdiagonals(A, A_tag) <= epsilon)
-            break;
-    }
-
-    /* Extract the eigen values and eigen vectors and insert them into an output
-     * format */
-    if(jacobi_format_output(V, A_tag, K, output))
-        goto error;
-
-    /* If  K < num_data, then goal = spk, and we have to sort the eigen values,
-     * therefore creating another matrix for the eigen vectors - hence, we don't
-     * need V anymore */
-    if(K < V.cols) {
-        matrix_free(V);
-    }
-
-    /* Free-ing */
-    matrix_free(A);
-    matrix_free(A_tag);
-    return 0;
-
-error:
-    matrix_free_safe(A);
-    matrix_free_safe(A_tag);
-    matrix_free_safe(V);
-
-    return BAD_ALLOC;
-}
-
-int eigen_jacobi_to_mat(jacobi_t origin, matrix_t *output) {
-    size_t i, j;
-
-    /* Creating the output matrix */
-    if(matrix_new(origin.eigen_vectors.rows + 1, origin.eigen_vectors.cols,
-                  output)) {
-        return BAD_ALLOC;
-    }
-
-    /* Building the first row of the matrix (the eigen values) */
-    for(j = 0; j < output->cols; j++) {
-        double value = origin.eigen_values[j].value;
-
-        /* Building the eigen value that will be inserted into the output matrix
-         */
-        if((value > -0.00005) && (value <= 0))
-        { /* If we need to round up an eigen value */
-            value = 0.0;
-        }
-
-        /* Inserting the eigen value into the output matrix */
-        matrix_set(*output, 0, j, value);
-    }
-
-    /* Building the rest of the rows of the matrix (the eigen vectors) */
-    for(i = 1; i < output->rows; i++) {
-        for(j = 0; j < output->cols; j++) {
-            matrix_set(*output, i, j,
-                       matrix_get(origin.eigen_vectors, i - 1, j));
-        }
-    }
-
-    /* Free the original output format */
-    free(origin.eigen_values);
-    matrix_free(origin.eigen_vectors);
-
-    return 0;
-}
-
-int eigen_compare(const void *eigen1, const void *eigen2) {
-    double eigen1_val = ((eigen_t *)eigen1)->value;
-    double eigen2_val = ((eigen_t *)eigen2)->value;
-
-    return (eigen1_val > eigen2_val) ? 1 : ((eigen1_val < eigen2_val) ? -1 : 0);
-}
-
-int sign(double val) {
-    if(val >= 0)
-        return 1;
-    return -1;
-}
-/******************************************************************************/
-
-/********************************************* STATIC FUNCTION DEFINITIONS
- * (RELATED TO JACOBI's ALGORITHM)
- * **************************************************************/
-static int jacobi_format_output(matrix_t mat_vectors, matrix_t mat_of_eigens,
-                                size_t K, jacobi_t *output) {
-    size_t i, j;
-    eigen_t *sorted_eigen_values = NULL;
-    matrix_t eigen_vectors;
-
-    if(K < mat_vectors.cols) { /* The goal was spk, since K == mat_vectors.cols
-                                  is prohibited by the Python CMD interface */
-        /* sort the eigen values */
-        if(jacobi_extract_eigen_values(mat_of_eigens, true,
-                                       &sorted_eigen_values))
-            goto error;
-
-        /* If K == 0, it means the CMD asked us to use the heuristic gap to
-         * determine K */
-        if(K == 0) {
-            K = jacobi_eigen_heuristic(sorted_eigen_values, mat_of_eigens.rows);
-        }
-
-        /* Form a matrix with the K-first eigen values */
-        if(matrix_new(mat_vectors.rows, K, &eigen_vectors))
-            goto error;
-
-        /* For each eigen value out of the first K, find its corresponding
-         * column in V, and copy it into <eigen_vectors> */
-        for(j = 0; j < K; j++) {
-            size_t eigen_col = sorted_eigen_values[j].col;
-
-            for(i = 0; i < eigen_vectors.rows; i++) {
-                matrix_set(eigen_vectors, i, j,
-                           matrix_get(mat_vectors, i, eigen_col));
-            }
-        }
-
-        /* Format the output */
-        output->eigen_vectors = eigen_vectors;
-        output->eigen_values = sorted_eigen_values;
-
-    } else if(K == mat_vectors.cols) {
-        /* If K = mat_vectors.cols, it means that the jacobi algorithm was
-         * powered alone. That is, since K = mat_vectors.cols is prohibited by
-         * the python CMD interface. Moreover, it's since we use this case as an
-         * indicator to when jacobi was powered without any future spectral
-         * clustering use. In such case, a jacobi algorithm alone isn't due to
-         * any specification of K, and we will return all of the eigen
-         * values/vectors (unsorted) */
-
-        /* Extracting all of the eigen values, without sorting */
-        if(jacobi_extract_eigen_values(mat_of_eigens, false,
-                                       &output->eigen_values))
-            goto error;
-
-        /* Extracting all of the eigen vectors */
-        output->eigen_vectors = mat_vectors;
-    }
-
-    return 0;
-
-error:
-    if(sorted_eigen_values) {
-        free(sorted_eigen_values);
-    }
-    return BAD_ALLOC;
-}
-
-static size_t jacobi_eigen_heuristic(eigen_t *sorted_eigen_values,
-                                     size_t size) {
-    size_t i, K = size;
-    double tmp;
-    double max_gap = -1;
-
-    for(i = 0; i < size / 2; i++) {
-        tmp = fabs(sorted_eigen_values[i].value -
-                   sorted_eigen_values[i + 1].value);
-
-        if(tmp > max_gap) {
-            max_gap = tmp;
-            K = i + 1;
-        }
-    }
-
-    return K;
-}
-
-static int jacobi_extract_eigen_values(matrix_t mat, bool sort,
-                                       eigen_t **output) {
-    size_t i;
-
-    *output = malloc(mat.rows * sizeof(eigen_t));
-    if(NULL == *output)
-        return BAD_ALLOC;
-
-    for(i = 0; i < mat.cols; i++) {
-        (*output)[i].value = matrix_get(mat, i, i);
-        (*output)[i].col = i;
-    }
-
-    if(sort) {
-        qsort(*output, mat.cols, sizeof(eigen_t), eigen_compare);
-    }
-
-    return 0;
-}
-
-static void jacobi_update_A_tag(matrix_t A_tag, matrix_t A, matrix_ind_t loc,
-                                double c, double s) {
-    double c2, s2, Aii, Ajj, Aij;
-    size_t i, j, r;
-
-    i = loc.i;
-    j = loc.j;
-
-    for(r = 0; r < A.rows; r++) {
-        if(r != i && r != j) {
-            double a_ri, a_rj;
-
-            a_ri = matrix_get(A, r, i);
-            a_rj = matrix_get(A, r, j);
-
-            matrix_set(A_tag, r, i, c * a_ri - s * a_rj);
-            matrix_set(A_tag, i, r, c * a_ri - s * a_rj);
-            matrix_set(A_tag, r, j, c * a_rj + s * a_ri);
-            matrix_set(A_tag, j, r, c * a_rj + s * a_ri);
-        }
-    }
-
-    matrix_set(A_tag, i, j, 0);
-    matrix_set(A_tag, j, i, 0);
-
-    c2 = c * c;
-    s2 = s * s;
-    Aii = matrix_get(A, i, i);
-    Ajj = matrix_get(A, j, j);
-    Aij = matrix_get(A, i, j);
-    matrix_set(A_tag, i, i, c2 * Aii + s2 * Ajj - 2 * c * s * Aij);
-    matrix_set(A_tag, j, j, s2 * Aii + c2 * Ajj + 2 * c * s * Aij);
-}
-
-static void jacobi_apply_rotation(matrix_t V, matrix_ind_t loc, double c,
-                                  double s) {
-    size_t row;
-
-    /* P is essentially an identity matrix with 4 values changed. No need for a
-     * robust matrix multiplication algorithm. We'll change just the values in V
-     * that are supposed to be changed due to such multiplication, accordingly
-     */
-    for(row = 0; row < V.rows; row++) {
-        double row_i, row_j;
-        row_i = c * matrix_get(V, row, loc.i) - s * matrix_get(V, row, loc.j);
-        row_j = s * matrix_get(V, row, loc.i) + c * matrix_get(V, row, loc.j);
-        matrix_set(V, row, loc.i, row_i);
-        matrix_set(V, row, loc.j, row_j);
-    }
-}
-
-static double jacobi_distance_of_squared_offdiagonals(matrix_t mat1,
-                                                      matrix_t mat2) {
-    return matrix_sum_squared_off(mat1) - matrix_sum_squared_off(mat2);
-}
-
-static void jacobi_calc_c_s(double *c, double *s, matrix_t current_jacobi_mat,
-                            matrix_ind_t loc) {
-    double theta, tmp;
-
-    theta = (matrix_get(current_jacobi_mat, loc.j, loc.j) -
-             matrix_get(current_jacobi_mat, loc.i, loc.i)) /
-            (2 * matrix_get(current_jacobi_mat, loc.i, loc.j));
-    tmp = sign(theta) / (fabs(theta) + sqrt(pow(theta, 2) + 1));
-    *c = 1 / sqrt(pow(tmp, 2) + 1);
-    *s = tmp * (*c);
-}
-/******************************************************************************/
+#include "eigen.h"
+#include "arena.h"
+#include "isa.h"
+#include "matrix.h"
+#include "profile.h"
+#include <math.h>
+#include <string.h>
+
+/********************************************* STATIC FUNCTION DECLARATIONS
+ * (JACOBI's ALGORITHM)
+ * **************************************************************/
+/* Given the eigen values <values> (of the eigen vectors <mat_vectors>), sort
+ * them if needed, and determine how many of them we need to
+ * store in the <output> argument. The determination of the amount of eigen
+ * values, is done by the value of <K>. If K==0, then we use the heuristic gap
+ * to determine a new K. Once K is determined, we store the <K>-first eigen
+ * vectors into the <output> argument. Most of this function's work is to simply
+ * format the output of the jacobi algorithm - And when needed, apply the
+ * heuristic gap. */
+static int jacobi_format_output(matrix_t mat_vectors, const double *values,
+                                size_t K, jacobi_t *output);
+
+/* In case K==0 was given as input, we try to determine a new valid K using the
+ *eigen heuristic gap. <eigen_values_amount> is the amount of eigen values. We
+ *need that for the heuristic's algorithm. Pre-Conditions: the given array of
+ *eigen values must be sorted by value (remember: eigen is a struct) */
+static size_t jacobi_eigen_heuristic(eigen_t *sorted_eigen_values,
+                                     size_t eigen_values_amount);
+
+/* Given the <amount> eigen values found by the backend, extract them along
+   with their columns. If sort equals <true>, sort the eigen values. An array
+   of eigen values would be assigned to the output argument. */
+static int jacobi_extract_eigen_values(const double *values, size_t amount,
+                                       bool sort, eigen_t **output);
+
+/* In the jacobi algorithm, this is the function that transforms the current A
+ * matrix into the next matrix in the recursive algorithm (A_tag), in place.
+ * <columns> is a scratch of 2 * A.rows elements. */
+static void jacobi_update_A(matrix_t A, matrix_ind_t loc, double c, double s,
+                            double *columns);
+
+/* Calculate the rotation matrix using the given data, and store the result in
+ * the pre-allocated `output`. */
+int eigen_build_rotation_matrix(matrix_ind_t loc, double c, double s,
+                                matrix_t output);
+
+/* Calculae the values of 'c' and 's' of the desired rotation matrix */
+static void jacobi_calc_c_s(double *c, double *s, matrix_t current_jacobi_mat,
+                            matrix_ind_t loc);
+/******************************************************************************/
+
+/********************************************* GLOBAL FUNCTIONS OF THE EIGEN
+ * MODULE **************************************************************/
+
+int eigen_jacobi(const backend_t *backend, matrix_t mat, size_t K,
+                 bool jacobi_only, jacobi_t *output) {
+    arena_t *arena = arena_thread();
+    profile_t *profile = profile_thread();
+    arena_mark_t mark;
+    double *values;
+    matrix_t V;
+    size_t i, phase;
+
+    V.data = NULL;
+    if(NULL == arena)
+        return BAD_ALLOC;
+    mark = arena_mark(arena);
+    phase = profile_phase(profile, "jacobi");
+
+    /* The rotations walk the columns of <mat> (which may have been built row
+     * by row, e.g. the normalized laplacian) and of V */
+    matrix_advise(mat, false);
+
+    /* V is padded, so that every one of its rows is aligned, and starts as
+     * the identity matrix (it's as large as <mat>). The eigen values are
+     * scratch. */
+    if(matrix_new_large(mat.rows, mat.cols, true, true, &V))
+        goto error;
+    for(i = 0; i < V.rows; i++) {
+        matrix_set(V, i, i, 1);
+    }
+    if(NULL == (values = arena_alloc(arena, mat.rows * sizeof(double), false)))
+        goto error;
+
+    /* Find the eigen values and eigen vectors (Jacobi's algorithm, unless the
+     * backend has an eigen solver of its own that may be used) */
+    if(jacobi_only ? eigen_jacobi_solve(backend, mat, values, V)
+                   : backend->eigen(backend, mat, values, V))
+        goto error;
+
+    /* Extract the eigen values and eigen vectors and insert them into an output
+     * format. The eigen vectors are V itself (or a view of its first columns,
+     * which starts at its storage), hence V is freed along with them. */
+    if(jacobi_format_output(V, values, K, output))
+        goto error;
+
+    /* Releasing the scratch */
+    arena_release(arena, mark);
+    profile_phase_restore(profile, phase);
+    return 0;
+
+error:
+    arena_release(arena, mark);
+    profile_phase_restore(profile, phase);
+    matrix_free_safe(V);
+
+    return BAD_ALLOC;
+}
+
+int eigen_jacobi_solve(const backend_t *backend, matrix_t mat, double *values,
+                       matrix_t vectors) {
+    size_t iterations, rotations = 0;
+    arena_t *arena = arena_thread();
+    profile_t *profile;
+    arena_mark_t mark;
+    matrix_ind_t loc;
+    double s, c, off, next_off, *columns;
+    size_t i;
+
+    if(NULL == arena)
+        return BAD_ALLOC;
+    mark = arena_mark(arena);
+
+    /* The algorithm works on <mat> in place: every iteration turns it into
+     * the matrix of the next one, out of a copy of the two columns that the
+     * rotation mixes (scratch) */
+    if(NULL == (columns = arena_alloc(arena, 2 * mat.rows * sizeof(double),
+                                      false)))
+    {
+        arena_release(arena, mark);
+        return BAD_ALLOC;
+    }
+
+    /* A single pass over the matrix of every iteration finds both its sum of
+     * squared off-diagonals and its largest off-diagonal */
+    matrix_scan_offdiagonal(mat, &off, &loc);
+    for(iterations = 0; iterations < max_jacobi_iterations; iterations++) {
+        if(0 == matrix_get(mat, loc.i, loc.j))
+            break; /* stop the algorithm if the matrix of the last iteration is
+                      diagonal (the next step will result in nan-s) */
+
+        jacobi_calc_c_s(&c, &s, mat, loc);
+        backend->rotate(
+            vectors, loc.i, loc.j, c,
+            s); /* in-place multiplication of the rotation matrix of the current
+                   iteration and V (the output eigen vector matrix) */
+        jacobi_update_A(mat, loc, c, s,
+                        columns); /* updating the current matrix of the jacobi
+                                     algorith into the new matrix of the next
+                                     iteration */
+        rotations++;
+
+        /* The distance between the sums of squared off-diagonals of the two
+         * matrices (the sum of the next one is the sum of the current one on
+         * the next iteration, and so is its largest off-diagonal) */
+        matrix_scan_offdiagonal(mat, &next_off, &loc);
+        if(off - next_off <= epsilon)
+            break;
+        off = next_off;
+    }
+
+    /* The eigen values are the diagonal of the last matrix */
+    for(i = 0; i < mat.rows; i++) {
+        values[i] = matrix_get(mat, i, i);
+    }
+
+    /* The rotations that were applied, and how far from diagonal the last
+     * matrix is */
+    if(NULL != (profile = profile_thread())) {
+        profile->jacobi_rotations = rotations;
+        profile->jacobi_off_norm = sqrt(matrix_sum_squared_off(mat));
+    }
+
+    /* Releasing the scratch */
+    arena_release(arena, mark);
+    return 0;
+}
+
+int eigen_jacobi_to_mat(jacobi_t origin, matrix_t *output) {
+    size_t i, j;
+
+    /* Creating the output matrix */
+    if(matrix_new_large(origin.eigen_vectors.rows + 1,
+                        origin.eigen_vectors.cols, false, false, output)) {
+        return BAD_ALLOC;
+    }
+
+    /* Building the first row of the matrix (the eigen values) */
+    for(j = 0; j < output->cols; j++) {
+        double value = origin.eigen_values[j].value;
+
+        /* Building the eigen value that will be inserted into the output matrix
+         */
+        if((value > -0.00005) && (value <= 0))
+        { /* If we need to round up an eigen value */
+            value = 0.0;
+        }
+
+        /* Inserting the eigen value into the output matrix */
+        matrix_set(*output, 0, j, value);
+    }
+
+    /* Building the rest of the rows of the matrix (the eigen vectors) */
+    for(i = 1; i < output->rows; i++) {
+        for(j = 0; j < output->cols; j++) {
+            matrix_set(*output, i, j,
+                       matrix_get(origin.eigen_vectors, i - 1, j));
+        }
+    }
+
+    /* Free the original output format */
+    free(origin.eigen_values);
+    matrix_free(origin.eigen_vectors);
+
+    return 0;
+}
+
+int eigen_compare(const void *eigen1, const void *eigen2) {
+    double eigen1_val = ((eigen_t *)eigen1)->value;
+    double eigen2_val = ((eigen_t *)eigen2)->value;
+
+    return (eigen1_val > eigen2_val) ? 1 : ((eigen1_val < eigen2_val) ? -1 : 0);
+}
+
+int sign(double val) {
+    if(val >= 0)
+        return 1;
+    return -1;
+}
+/******************************************************************************/
+
+/********************************************* STATIC FUNCTION DEFINITIONS
+ * (RELATED TO JACOBI's ALGORITHM)
+ * **************************************************************/
+static int jacobi_format_output(matrix_t mat_vectors, const double *values,
+                                size_t K, jacobi_t *output) {
+    size_t i, j;
+    eigen_t *sorted_eigen_values = NULL;
+    double *row_of_vectors = NULL;
+
+    if(K < mat_vectors.cols) { /* The goal was spk, since K == mat_vectors.cols
+                                  is prohibited by the Python CMD interface */
+        /* sort the eigen values */
+        if(jacobi_extract_eigen_values(values, mat_vectors.cols, true,
+                                       &sorted_eigen_values))
+            goto error;
+
+        /* If K == 0, it means the CMD asked us to use the heuristic gap to
+         * determine K */
+        if(K == 0) {
+            K = jacobi_eigen_heuristic(sorted_eigen_values, mat_vectors.cols);
+        }
+
+        /* Permute the columns of V in place, so that its first K columns are
+         * the eigen vectors of the K-first eigen values (in order). Every row
+         * gathers them through a buffer of K values. */
+        if(NULL == (row_of_vectors = malloc(K * sizeof(double))))
+            goto error;
+
+        for(i = 0; i < mat_vectors.rows; i++) {
+            double *row = matrix_row(mat_vectors, i);
+
+            for(j = 0; j < K; j++) {
+                row_of_vectors[j] = row[sorted_eigen_values[j].col];
+            }
+            memcpy(row, row_of_vectors, K * sizeof(double));
+        }
+        free(row_of_vectors);
+
+        /* Format the output: a view of the first K columns of V */
+        output->eigen_vectors = matrix_view_cols(mat_vectors, 0, K);
+        output->eigen_values = sorted_eigen_values;
+
+    } else if(K == mat_vectors.cols) {
+        /* If K = mat_vectors.cols, it means that the jacobi algorithm was
+         * powered alone. That is, since K = mat_vectors.cols is prohibited by
+         * the python CMD interface. Moreover, it's since we use this case as an
+         * indicator to when jacobi was powered without any future spectral
+         * clustering use. In such case, a jacobi algorithm alone isn't due to
+         * any specification of K, and we will return all of the eigen
+         * values/vectors (unsorted) */
+
+        /* Extracting all of the eigen values, without sorting */
+        if(jacobi_extract_eigen_values(values, mat_vectors.cols, false,
+                                       &output->eigen_values))
+            goto error;
+
+        /* Extracting all of the eigen vectors */
+        output->eigen_vectors = mat_vectors;
+    }
+
+    return 0;
+
+error:
+    if(sorted_eigen_values) {
+        free(sorted_eigen_values);
+    }
+    return BAD_ALLOC;
+}
+
+static size_t jacobi_eigen_heuristic(eigen_t *sorted_eigen_values,
+                                     size_t size) {
+    size_t i, K = size;
+    double tmp;
+    double max_gap = -1;
+
+    for(i = 0; i < size / 2; i++) {
+        tmp = fabs(sorted_eigen_values[i].value -
+                   sorted_eigen_values[i + 1].value);
+
+        if(tmp > max_gap) {
+            max_gap = tmp;
+            K = i + 1;
+        }
+    }
+
+    return K;
+}
+
+static int jacobi_extract_eigen_values(const double *values, size_t amount,
+                                       bool sort, eigen_t **output) {
+    size_t i;
+
+    *output = malloc(amount * sizeof(eigen_t));
+    if(NULL == *output)
+        return BAD_ALLOC;
+
+    for(i = 0; i < amount; i++) {
+        (*output)[i].value = values[i];
+        (*output)[i].col = i;
+    }
+
+    if(sort) {
+        qsort(*output, amount, sizeof(eigen_t), eigen_compare);
+    }
+
+    return 0;
+}
+
+static void jacobi_update_A(matrix_t A, matrix_ind_t loc, double c, double s,
+                            double *columns) {
+    double c2, s2, Aii, Ajj, Aij;
+    double *column_i = columns, *column_j = columns + A.rows;
+    size_t i, j, r;
+
+    i = loc.i;
+    j = loc.j;
+
+    /* Everything the next matrix is built out of is read before any of it is
+     * overwritten: the columns i and j, and where they cross */
+    Aii = matrix_get(A, i, i);
+    Ajj = matrix_get(A, j, j);
+    Aij = matrix_get(A, i, j);
+    for(r = 0; r < A.rows; r++) {
+        column_i[r] = matrix_get(A, r, i);
+        column_j[r] = matrix_get(A, r, j);
+    }
+
+    /* The rows i and j of A_tag are the rotated columns i and j of A, and its
+     * columns i and j mirror them (where they cross, they're set below) */
+    isa_kernels()->rotate(column_i, column_j, 1, A.rows, c, s,
+                          matrix_row(A, i), matrix_row(A, j), 1);
+    for(r = 0; r < A.rows; r++) {
+        if(r != i && r != j) {
+            matrix_set(A, r, i, matrix_get(A, i, r));
+            matrix_set(A, r, j, matrix_get(A, j, r));
+        }
+    }
+
+    matrix_set(A, i, j, 0);
+    matrix_set(A, j, i, 0);
+
+    c2 = c * c;
+    s2 = s * s;
+    matrix_set(A, i, i, c2 * Aii + s2 * Ajj - 2 * c * s * Aij);
+    matrix_set(A, j, j, s2 * Aii + c2 * Ajj + 2 * c * s * Aij);
+}
+
+static void jacobi_calc_c_s(double *c, double *s, matrix_t current_jacobi_mat,
+                            matrix_ind_t loc) {
+    double theta, tmp;
+
+    theta = (matrix_get(current_jacobi_mat, loc.j, loc.j) -
+             matrix_get(current_jacobi_mat, loc.i, loc.i)) /
+            (2 * matrix_get(current_jacobi_mat, loc.i, loc.j));
+    tmp = sign(theta) / (fabs(theta) + sqrt(pow(theta, 2) + 1));
+    *c = 1 / sqrt(pow(tmp, 2) + 1);
+    *s = tmp * (*c);
+}
+/******************************************************************************/
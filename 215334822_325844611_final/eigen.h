@@ -3,6 +3,7 @@
 
 #include <math.h>
 
+#include "backend.h"
 #include "matrix.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -21,7 +22,9 @@ typedef struct eigen_value_t {
 /* Define a structure that will hold the output of the Jacobi algorithm. That
  * includes the eigen values as well as the eigen_vectors matrix If K is desired
  * in the output, you can just check that throught the amount of cols of
- * eigen_vectors. K == eigen_vectors.cols */
+ * eigen_vectors. K == eigen_vectors.cols. The eigen vectors may be a view of
+ * the first columns of the padded matrix the algorithm worked on (freed with
+ * matrix_free all the same). */
 typedef struct jacobi_t {
     matrix_t eigen_vectors;
     eigen_t *eigen_values;
@@ -34,13 +37,30 @@ typedef struct jacobi_t {
  * 		<mat> must be a "symmetric" matrix.
  *		<K> must be lower or equal to <mat.rows>
  *
+ * <mat> is the working matrix of the algorithm, hence it's overwritten (its
+ * contents are meaningless afterwards).
+ *
  * If K == 0: using the heuristic gap, determine a new positive K, and return
  *the first (while sorted) K eigen values along with their eigen vectors If 0 <
  *K < mat.rows: return the first (while sorted) K eigen values along with thier
  *eigen vectors If K = mat.rows: return all of the K eigen values along with
  *their eigen vectors. This part doesn't necessarily return the eigen values
- *sorted */
-int eigen_jacobi(matrix_t mat, size_t K, jacobi_t *output);
+ *sorted
+ *
+ * The eigen values and vectors are found by the eigen solver of <backend>,
+ *which is Jacobi's algorithm unless it's the lapack backend (or unless
+ *<jacobi_only>, see budget.h). */
+int eigen_jacobi(const backend_t *backend, matrix_t mat, size_t K,
+                 bool jacobi_only, jacobi_t *output);
+
+/* The eigen solver of the reference backend (see backend_t): Jacobi's
+ * algorithm, which applies its rotations to <vectors> through the given
+ * backend. The algorithm works on <mat> in place (it becomes the last matrix
+ * of the algorithm), and only needs a scratch of 2 * mat.rows elements on top
+ * of it. The eigen values are the diagonal of the last matrix of the
+ * algorithm, in the order of its columns. */
+int eigen_jacobi_solve(const backend_t *backend, matrix_t mat, double *values,
+                       matrix_t vectors);
 
 /* Cast a variable of type <jacobi_output> into <matrix_t>, for printing
  * purposes only! If we print that matrix, we will get the desired printage of a
@@ -1,104 +1,125 @@
 #include "graph.h"
+#include "arena.h"
+#include "backend.h"
 #include "matrix.h"
-
-/* Find the Euclidean norm of two vectors of the same dim x 1 */
-static double euclidean_norm(dpoint_t v1, dpoint_t v2, size_t dim) {
-    size_t i;
-    double sum = 0.0;
-
-    for(i = 0; i < dim; i++) {
-        sum += pow((v1.data[i] - v2.data[i]), 2);
-    }
-
-    return sqrt(sum);
+#include "profile.h"
+#include <string.h>
+
+/* Fills <W> with the weights of the datapoints, by <backend> (accounted to
+ * the "wam" phase of the profile of the thread) */
+static int graph_adjacent(const backend_t *backend, dpoint_t input[],
+                          size_t num_data, size_t dim, matrix_t W) {
+    profile_t *profile = profile_thread();
+    size_t phase = profile_phase(profile, "wam");
+    int signal = backend->adjacent(input, num_data, dim, W);
+
+    profile_phase_restore(profile, phase);
+    return signal;
 }
 
-int graph_adjacent_matrix(dpoint_t input[], size_t num_data, size_t dim,
-                          matrix_t *output) {
-    size_t i, j;
+int graph_adjacent_matrix(const backend_t *backend, dpoint_t input[],
+                          size_t num_data, size_t dim, matrix_t *output) {
+    profile_t *profile = profile_thread();
+    size_t phase = profile_phase(profile, "wam");
 
-    /* Creating the output matrix */
-    if(matrix_new(num_data, num_data, output) != 0)
+    /* Creating the output matrix (every element of it is written) */
+    if(matrix_new_large(num_data, num_data, false, false, output) != 0)
         goto error;
+    matrix_advise(*output, true);
 
-    /* Building the output matrix */
-    for(i = 0; i < num_data; i++) {
-        /* starting with j = i + 1 ensures none of the diagonal values are
-         * nonzero */
-        for(j = i + 1; j < num_data; j++) {
-            double tmp = exp(euclidean_norm(input[i], input[j], dim) * (-0.5));
-            matrix_set(*output, i, j, tmp);
-            matrix_set(*output, j, i, tmp);
-        }
-    }
+    /* Building the output matrix (by the backend) */
+    if(graph_adjacent(backend, input, num_data, dim, *output))
+        goto error;
+    profile_phase_restore(profile, phase);
     return 0;
 
 error:
     /* Free-ing */
+    profile_phase_restore(profile, phase);
     matrix_free_safe(*output);
     return BAD_ALLOC;
 }
 
-int graph_diagonal_degree_matrix(dpoint_t input[], size_t num_data, size_t dim,
-                                 bool is_sqrt, matrix_t *output) {
-    size_t i, j;
-    matrix_t W;
-
-    /* in case of an error */
-    W.data = NULL;
-    output->data = NULL;
+int graph_diagonal_degree_matrix(const backend_t *backend, dpoint_t input[],
+                                 size_t num_data, size_t dim, bool is_sqrt,
+                                 matrix_t *output) {
+    profile_t *profile = profile_thread();
+    size_t i, j, phase = profile_phase(profile, "ddg");
 
-    /* Build the WAM matrix */
-    if(graph_adjacent_matrix(input, num_data, dim, &W))
+    /* Build the WAM matrix in place of the output matrix (every element of it
+     * is written), which it's turned into row by row: the degree of a row is
+     * all that's needed of it. Hence a single n^2 matrix is ever needed. */
+    if(matrix_new_large(num_data, num_data, false, false, output))
         goto error;
-
-    /* Create the output matrix */
-    if(matrix_new(W.rows, W.cols, output))
+    matrix_advise(*output, true);
+    if(graph_adjacent(backend, input, num_data, dim, *output))
         goto error;
 
     /* Build the output matrix */
-    for(i = 0; i < W.rows; i++) {
+    for(i = 0; i < output->rows; i++) {
+        double *row = matrix_row(*output, i);
         double sum = 0.0;
 
         /* Calculate row-specific sum */
-        for(j = 0; j < W.cols; j++) {
-            sum += matrix_get(W, i, j);
+        for(j = 0; j < output->cols; j++) {
+            sum += row[j];
         }
 
         /* Insert the value into the diagonal degree matrix. Apply a square root
          * in case we want D^(-1/2) */
-        matrix_set(*output, i, i, (is_sqrt ? (1 / sqrt(sum)) : sum));
+        memset(row, 0, output->cols * sizeof(double));
+        row[i] = is_sqrt ? (1 / sqrt(sum)) : sum;
     }
 
-    /* Free-ing */
-    matrix_free_safe(W);
-
+    profile_phase_restore(profile, phase);
     return 0;
 
 error:
     /* Free-ing */
+    profile_phase_restore(profile, phase);
     matrix_free_safe(*output);
     return BAD_ALLOC;
 }
 
-int graph_normalized_laplacian(dpoint_t input[], size_t num_data, size_t dim,
-                               matrix_t *output) {
+int graph_normalized_laplacian(const backend_t *backend, dpoint_t input[],
+                               size_t num_data, size_t dim, matrix_t *output) {
+    return graph_normalized_laplacian_degrees(backend, input, num_data, dim,
+                                              NULL, output);
+}
+
+int graph_normalized_laplacian_degrees(const backend_t *backend,
+                                       dpoint_t input[], size_t num_data,
+                                       size_t dim, double *degrees,
+                                       matrix_t *output) {
+    arena_t *arena = arena_thread();
+    profile_t *profile = profile_thread();
+    arena_mark_t mark;
     matrix_t W;
     double *D_sqrt;
-    size_t i, j;
+    size_t i, j, phase;
 
     /* in case of an error */
-    W.data = NULL;
-    D_sqrt = NULL;
     output->data = NULL;
-
-    /* Build the WAM matrix */
-    if(graph_adjacent_matrix(input, num_data, dim, &W))
+    if(NULL == arena)
+        return BAD_ALLOC;
+    mark = arena_mark(arena);
+    phase = profile_phase(profile, "lnorm");
+
+    /* Build the WAM matrix in place of the output matrix (every element of it
+     * is written), which it's turned into in the end. Hence a single n^2
+     * matrix is ever needed. */
+    if(matrix_new_large(num_data, num_data, false, false, output))
+        goto error;
+    matrix_advise(*output, true);
+    W = *output;
+    if(graph_adjacent(backend, input, num_data, dim, W))
         goto error;
 
     /* Build D_sqrt manually. There's no need to create a matrix of size n^2
      * just to know it's diagonal (which is n values) */
-    D_sqrt = (double *)calloc(W.rows, sizeof(double));
+    profile_phase(profile, "ddg");
+    if(NULL == (D_sqrt = arena_alloc(arena, W.rows * sizeof(double), false)))
+        goto error;
     for(i = 0; i < W.rows; i++) {
         double sum = 0.0;
         for(j = 0; j < W.rows; j++) {
@@ -106,38 +127,26 @@ int graph_normalized_laplacian(dpoint_t input[], size_t num_data, size_t dim,
         }
 
         D_sqrt[i] = 1 / sqrt(sum);
-    }
-
-    /* Creating the output matrix */
-    if(matrix_new(W.rows, W.rows, output))
-        goto error;
-
-    /* Building the output matrix */
-    for(i = 0; i < output->rows; i++) {
-        for(j = 0; j < output->cols; j++) {
-            /* L_norm = I - D_sqrt * WAM * D_sqrt */
-            double mult_val;
-
-            /* Matrix multiplication avoided by in-place editing of the output
-             * matrix. This is avoided since D_sqrt is always a diagonal matrix,
-             * and thus we represent D_sqrt's diagonal as an array */
-            mult_val = D_sqrt[i] * matrix_get(W, i, j) * D_sqrt[j];
-            matrix_set(*output, i, j, (i == j) * 1 - mult_val);
+        if(NULL != degrees) {
+            degrees[i] = sum;
         }
     }
 
-    /* Free-ing */
-    if(D_sqrt != NULL)
-        free(D_sqrt);
-    matrix_free(W);
+    /* Building the output matrix: L_norm = I - D_sqrt * WAM * D_sqrt (by the
+     * backend, in place of W) */
+    profile_phase(profile, "lnorm");
+    backend->scale(W, D_sqrt, *output);
+
+    /* Releasing the scratch */
+    arena_release(arena, mark);
+    profile_phase_restore(profile, phase);
 
     return 0;
 
 error:
     /* Free-ing */
-    if(D_sqrt != NULL)
-        free(D_sqrt);
-    matrix_free_safe(W);
+    arena_release(arena, mark);
+    profile_phase_restore(profile, phase);
     matrix_free_safe(*output);
     return BAD_ALLOC;
 }
@@ -3,17 +3,19 @@
 
 #include <math.h>
 
+#include "backend.h"
 #include "matrix.h"
 #include <stdio.h>
 #include <stdlib.h>
 
 /* Calculate and return the weighted adjacency matrix of the given list of
-   datapoints.
+   datapoints. Every function of the graph does its heavy lifting by the given
+   <backend> (see backend.h).
 
    In case of allocation failure, the return value has a `data` field of `NULL`.
  */
-int graph_adjacent_matrix(dpoint_t input[], size_t num_data, size_t dim,
-                          matrix_t *output);
+int graph_adjacent_matrix(const backend_t *backend, dpoint_t input[],
+                          size_t num_data, size_t dim, matrix_t *output);
 
 /* Calculate and return the diagonal degree matrix of the given matrix <mat>.
    In such case that the boolean is_sqrt equals <true>, the returned matrix is D
@@ -21,14 +23,23 @@ int graph_adjacent_matrix(dpoint_t input[], size_t num_data, size_t dim,
 
    In case of allocation failure, the return value has a `data` field of `NULL`.
  */
-int graph_diagonal_degree_matrix(dpoint_t input[], size_t num_data, size_t dim,
-                                 bool is_sqrt, matrix_t *output);
+int graph_diagonal_degree_matrix(const backend_t *backend, dpoint_t input[],
+                                 size_t num_data, size_t dim, bool is_sqrt,
+                                 matrix_t *output);
 
 /* Calculate the normalized graph Laplacian matrix of the given list of
    datapoints, and store the result in `output`. On success, returns 0.
 
    In case of any allocation failure, the return value is `BAD_ALLOC`.*/
-int graph_normalized_laplacian(dpoint_t input[], size_t num_data, size_t dim,
-                               matrix_t *output);
+int graph_normalized_laplacian(const backend_t *backend, dpoint_t input[],
+                               size_t num_data, size_t dim, matrix_t *output);
+
+/* The same as graph_normalized_laplacian, while storing the degree of every
+   datapoint (the sum of its row in the weighted adjacency matrix) in
+   <degrees>, an array of num_data elements (unless it's NULL). */
+int graph_normalized_laplacian_degrees(const backend_t *backend,
+                                       dpoint_t input[], size_t num_data,
+                                       size_t dim, double *degrees,
+                                       matrix_t *output);
 
 #endif
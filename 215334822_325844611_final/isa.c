@@ -0,0 +1,545 @@
+#define _POSIX_C_SOURCE 200112L
+#include "isa.h"
+#include <pthread.h>
+#include <string.h>
+
+/* The vectorized variants need GCC's (or Clang's) target attributes and CPU
+ * detection, on x86. Otherwise, only the scalar variants are built in. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ISA_X86
+#include <immintrin.h>
+#define ISA_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+/* The AVX2 and AVX-512 variants clear the upper halves of the vector registers
+ * (_mm256_zeroupper) before they return or fall back to SSE2 code: the
+ * compiler only does so when it optimizes, and SSE2 code that runs on dirty
+ * upper halves is several times slower. */
+
+/********************************************* STATIC FUNCTION DECLARATIONS
+ * (THE KERNELS)
+ * **************************************************************/
+static void scalar_squared_distances(const double *point,
+                                     const double *packed, size_t ld,
+                                     size_t count, size_t dim, double *out);
+static void scalar_rotate(const double *x, const double *y, size_t stride,
+                          size_t n, double c, double s, double *out_x,
+                          double *out_y, size_t out_stride);
+static void scalar_dot(const double *const *x, const double *col, size_t ld,
+                       size_t dim, double *dot);
+static void scalar_add(double *sum, const double *x, size_t n);
+static void scalar_move(double *c, const double *x, double eta, size_t n);
+
+#ifdef ISA_X86
+static void sse2_squared_distances(const double *point, const double *packed,
+                                   size_t ld, size_t count, size_t dim,
+                                   double *out);
+static void sse2_rotate(const double *x, const double *y, size_t stride,
+                        size_t n, double c, double s, double *out_x,
+                        double *out_y, size_t out_stride);
+static void sse2_dot(const double *const *x, const double *col, size_t ld,
+                     size_t dim, double *dot);
+static void sse2_add(double *sum, const double *x, size_t n);
+static void sse2_move(double *c, const double *x, double eta, size_t n);
+
+static void avx2_squared_distances(const double *point, const double *packed,
+                                   size_t ld, size_t count, size_t dim,
+                                   double *out);
+static void avx2_rotate(const double *x, const double *y, size_t stride,
+                        size_t n, double c, double s, double *out_x,
+                        double *out_y, size_t out_stride);
+static void avx2_dot(const double *const *x, const double *col, size_t ld,
+                     size_t dim, double *dot);
+static void avx2_add(double *sum, const double *x, size_t n);
+static void avx2_move(double *c, const double *x, double eta, size_t n);
+
+static void avx512_squared_distances(const double *point,
+                                     const double *packed, size_t ld,
+                                     size_t count, size_t dim, double *out);
+static void avx512_rotate(const double *x, const double *y, size_t stride,
+                          size_t n, double c, double s, double *out_x,
+                          double *out_y, size_t out_stride);
+static void avx512_dot(const double *const *x, const double *col, size_t ld,
+                       size_t dim, double *dot);
+static void avx512_add(double *sum, const double *x, size_t n);
+static void avx512_move(double *c, const double *x, double eta, size_t n);
+#endif
+/******************************************************************************/
+
+/* The variants of every level, indexed by it */
+static const isa_kernels_t levels[ISA_LEVELS] = {
+    {ISA_SCALAR, "scalar", scalar_squared_distances, scalar_rotate,
+     scalar_dot, scalar_add, scalar_move},
+#ifdef ISA_X86
+    {ISA_SSE2, "sse2", sse2_squared_distances, sse2_rotate, sse2_dot,
+     sse2_add, sse2_move},
+    {ISA_AVX2, "avx2", avx2_squared_distances, avx2_rotate, avx2_dot,
+     avx2_add, avx2_move},
+    {ISA_AVX512, "avx512", avx512_squared_distances, avx512_rotate,
+     avx512_dot, avx512_add, avx512_move},
+#else
+    {ISA_SSE2, "sse2", NULL, NULL, NULL, NULL, NULL},
+    {ISA_AVX2, "avx2", NULL, NULL, NULL, NULL, NULL},
+    {ISA_AVX512, "avx512", NULL, NULL, NULL, NULL, NULL},
+#endif
+};
+
+/* The kernels that are used (NULL until they're selected) */
+static const isa_kernels_t *current = NULL;
+static bool forced = false;
+static pthread_once_t current_once = PTHREAD_ONCE_INIT;
+
+/* Selects the kernels named by the environment, unless any were selected */
+static void isa_init_once(void) {
+    if(NULL == current) {
+        isa_init();
+    }
+}
+
+/********************************************* GLOBAL FUNCTIONS OF THE ISA
+ * MODULE **************************************************************/
+const char *isa_name(isa_level_t level) {
+    return levels[level].name;
+}
+
+isa_level_t isa_detect(void) {
+#ifdef ISA_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+        return ISA_AVX512;
+    if(__builtin_cpu_supports("avx2"))
+        return ISA_AVX2;
+    if(__builtin_cpu_supports("sse2"))
+        return ISA_SSE2;
+#endif
+    return ISA_SCALAR;
+}
+
+int isa_init(void) {
+    const char *name = getenv(ISA_ENV);
+    isa_level_t detected = isa_detect();
+    size_t i;
+
+    forced = false;
+    current = &levels[detected];
+    if(NULL == name || '\0' == *name)
+        return 0;
+
+    for(i = 0; i < ISA_LEVELS; i++) {
+        if(strcmp(levels[i].name, name) == 0)
+            break;
+    }
+
+    /* A level newer than the CPU's would fault on its first instruction */
+    if(i == ISA_LEVELS || (isa_level_t)i > detected)
+        return BAD_INPUT;
+
+    forced = true;
+    current = &levels[i];
+    return 0;
+}
+
+bool isa_forced(void) {
+    pthread_once(&current_once, isa_init_once);
+
+    return forced;
+}
+
+const isa_kernels_t *isa_kernels(void) {
+    pthread_once(&current_once, isa_init_once);
+
+    return current;
+}
+/******************************************************************************/
+
+/********************************************* STATIC FUNCTION DEFINITIONS
+ * (THE SCALAR KERNELS)
+ * **************************************************************/
+static void scalar_squared_distances(const double *point,
+                                     const double *packed, size_t ld,
+                                     size_t count, size_t dim, double *out) {
+    size_t j, k;
+
+    for(j = 0; j < count; j++) {
+        double sum = 0.0;
+
+        for(k = 0; k < dim; k++) {
+            double diff = point[k] - packed[k * ld + j];
+            sum += diff * diff;
+        }
+        out[j] = sum;
+    }
+}
+
+static void scalar_rotate(const double *x, const double *y, size_t stride,
+                          size_t n, double c, double s, double *out_x,
+                          double *out_y, size_t out_stride) {
+    size_t r;
+
+    for(r = 0; r < n; r++) {
+        double xr = x[r * stride], yr = y[r * stride];
+
+        out_x[r * out_stride] = c * xr - s * yr;
+        out_y[r * out_stride] = s * xr + c * yr;
+    }
+}
+
+static void scalar_dot(const double *const *x, const double *col, size_t ld,
+                       size_t dim, double *dot) {
+    size_t q, j, k;
+
+    for(q = 0; q < ISA_DOT_POINTS * ISA_DOT_WIDTH; q++) {
+        dot[q] = 0.0;
+    }
+    for(k = 0; k < dim; k++, col += ld) {
+        for(q = 0; q < ISA_DOT_POINTS; q++) {
+            double xk = x[q][k];
+
+            for(j = 0; j < ISA_DOT_WIDTH; j++) {
+                dot[q * ISA_DOT_WIDTH + j] += xk * col[j];
+            }
+        }
+    }
+}
+
+static void scalar_add(double *sum, const double *x, size_t n) {
+    size_t i;
+
+    for(i = 0; i < n; i++) {
+        sum[i] += x[i];
+    }
+}
+
+static void scalar_move(double *c, const double *x, double eta, size_t n) {
+    size_t i;
+
+    for(i = 0; i < n; i++) {
+        c[i] += eta * (x[i] - c[i]);
+    }
+}
+/******************************************************************************/
+
+#ifdef ISA_X86
+/********************************************* STATIC FUNCTION DEFINITIONS
+ * (THE SSE2 KERNELS: 2 DOUBLES A VECTOR)
+ * **************************************************************/
+ISA_TARGET("sse2")
+static void sse2_squared_distances(const double *point, const double *packed,
+                                   size_t ld, size_t count, size_t dim,
+                                   double *out) {
+    size_t j, k;
+
+    for(j = 0; j + 2 <= count; j += 2) {
+        __m128d sum = _mm_setzero_pd();
+
+        for(k = 0; k < dim; k++) {
+            __m128d diff = _mm_sub_pd(_mm_set1_pd(point[k]),
+                                      _mm_loadu_pd(packed + k * ld + j));
+            sum = _mm_add_pd(sum, _mm_mul_pd(diff, diff));
+        }
+        _mm_storeu_pd(out + j, sum);
+    }
+    scalar_squared_distances(point, packed + j, ld, count - j, dim, out + j);
+}
+
+ISA_TARGET("sse2")
+static void sse2_rotate(const double *x, const double *y, size_t stride,
+                        size_t n, double c, double s, double *out_x,
+                        double *out_y, size_t out_stride) {
+    const __m128d vc = _mm_set1_pd(c), vs = _mm_set1_pd(s);
+    size_t r;
+
+    for(r = 0; r + 2 <= n; r += 2) {
+        const double *xr = x + r * stride, *yr = y + r * stride;
+        double *oxr = out_x + r * out_stride, *oyr = out_y + r * out_stride;
+        __m128d vx = _mm_set_pd(xr[stride], xr[0]);
+        __m128d vy = _mm_set_pd(yr[stride], yr[0]);
+        __m128d rx = _mm_sub_pd(_mm_mul_pd(vc, vx), _mm_mul_pd(vs, vy));
+        __m128d ry = _mm_add_pd(_mm_mul_pd(vs, vx), _mm_mul_pd(vc, vy));
+
+        _mm_storel_pd(oxr, rx);
+        _mm_storeh_pd(oxr + out_stride, rx);
+        _mm_storel_pd(oyr, ry);
+        _mm_storeh_pd(oyr + out_stride, ry);
+    }
+    scalar_rotate(x + r * stride, y + r * stride, stride, n - r, c, s,
+                  out_x + r * out_stride, out_y + r * out_stride, out_stride);
+}
+
+ISA_TARGET("sse2")
+static void sse2_dot(const double *const *x, const double *col, size_t ld,
+                     size_t dim, double *dot) {
+    __m128d acc[ISA_DOT_POINTS][ISA_DOT_WIDTH / 2];
+    size_t q, j, k;
+
+    for(q = 0; q < ISA_DOT_POINTS; q++) {
+        for(j = 0; j < ISA_DOT_WIDTH / 2; j++) {
+            acc[q][j] = _mm_setzero_pd();
+        }
+    }
+    for(k = 0; k < dim; k++, col += ld) {
+        for(q = 0; q < ISA_DOT_POINTS; q++) {
+            __m128d xk = _mm_set1_pd(x[q][k]);
+
+            for(j = 0; j < ISA_DOT_WIDTH / 2; j++) {
+                acc[q][j] = _mm_add_pd(
+                    acc[q][j], _mm_mul_pd(xk, _mm_loadu_pd(col + 2 * j)));
+            }
+        }
+    }
+    for(q = 0; q < ISA_DOT_POINTS; q++) {
+        for(j = 0; j < ISA_DOT_WIDTH / 2; j++) {
+            _mm_storeu_pd(dot + q * ISA_DOT_WIDTH + 2 * j, acc[q][j]);
+        }
+    }
+}
+
+ISA_TARGET("sse2")
+static void sse2_add(double *sum, const double *x, size_t n) {
+    size_t i;
+
+    for(i = 0; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(sum + i,
+                      _mm_add_pd(_mm_loadu_pd(sum + i), _mm_loadu_pd(x + i)));
+    }
+    scalar_add(sum + i, x + i, n - i);
+}
+
+ISA_TARGET("sse2")
+static void sse2_move(double *c, const double *x, double eta, size_t n) {
+    const __m128d veta = _mm_set1_pd(eta);
+    size_t i;
+
+    for(i = 0; i + 2 <= n; i += 2) {
+        __m128d vc = _mm_loadu_pd(c + i);
+        __m128d step = _mm_mul_pd(veta, _mm_sub_pd(_mm_loadu_pd(x + i), vc));
+
+        _mm_storeu_pd(c + i, _mm_add_pd(vc, step));
+    }
+    scalar_move(c + i, x + i, eta, n - i);
+}
+/******************************************************************************/
+
+/********************************************* STATIC FUNCTION DEFINITIONS
+ * (THE AVX2 KERNELS: 4 DOUBLES A VECTOR)
+ * **************************************************************/
+ISA_TARGET("avx2")
+static void avx2_squared_distances(const double *point, const double *packed,
+                                   size_t ld, size_t count, size_t dim,
+                                   double *out) {
+    size_t j, k;
+
+    for(j = 0; j + 4 <= count; j += 4) {
+        __m256d sum = _mm256_setzero_pd();
+
+        for(k = 0; k < dim; k++) {
+            __m256d diff = _mm256_sub_pd(_mm256_set1_pd(point[k]),
+                                         _mm256_loadu_pd(packed + k * ld + j));
+            sum = _mm256_add_pd(sum, _mm256_mul_pd(diff, diff));
+        }
+        _mm256_storeu_pd(out + j, sum);
+    }
+    _mm256_zeroupper();
+    sse2_squared_distances(point, packed + j, ld, count - j, dim, out + j);
+}
+
+ISA_TARGET("avx2")
+static void avx2_rotate(const double *x, const double *y, size_t stride,
+                        size_t n, double c, double s, double *out_x,
+                        double *out_y, size_t out_stride) {
+    const __m256d vc = _mm256_set1_pd(c), vs = _mm256_set1_pd(s);
+    const __m128i index =
+        _mm_set_epi32((int)(3 * stride), (int)(2 * stride), (int)stride, 0);
+    size_t r;
+
+    for(r = 0; r + 4 <= n; r += 4) {
+        double *oxr = out_x + r * out_stride, *oyr = out_y + r * out_stride;
+        __m256d vx = _mm256_i32gather_pd(x + r * stride, index, 8);
+        __m256d vy = _mm256_i32gather_pd(y + r * stride, index, 8);
+        __m256d rx =
+            _mm256_sub_pd(_mm256_mul_pd(vc, vx), _mm256_mul_pd(vs, vy));
+        __m256d ry =
+            _mm256_add_pd(_mm256_mul_pd(vs, vx), _mm256_mul_pd(vc, vy));
+
+        if(out_stride == 1) {
+            _mm256_storeu_pd(oxr, rx);
+            _mm256_storeu_pd(oyr, ry);
+        } else { /* there's no scatter before AVX-512 */
+            __m128d low_x = _mm256_castpd256_pd128(rx);
+            __m128d high_x = _mm256_extractf128_pd(rx, 1);
+            __m128d low_y = _mm256_castpd256_pd128(ry);
+            __m128d high_y = _mm256_extractf128_pd(ry, 1);
+
+            _mm_storel_pd(oxr, low_x);
+            _mm_storeh_pd(oxr + out_stride, low_x);
+            _mm_storel_pd(oxr + 2 * out_stride, high_x);
+            _mm_storeh_pd(oxr + 3 * out_stride, high_x);
+            _mm_storel_pd(oyr, low_y);
+            _mm_storeh_pd(oyr + out_stride, low_y);
+            _mm_storel_pd(oyr + 2 * out_stride, high_y);
+            _mm_storeh_pd(oyr + 3 * out_stride, high_y);
+        }
+    }
+    _mm256_zeroupper();
+    sse2_rotate(x + r * stride, y + r * stride, stride, n - r, c, s,
+                out_x + r * out_stride, out_y + r * out_stride, out_stride);
+}
+
+ISA_TARGET("avx2")
+static void avx2_dot(const double *const *x, const double *col, size_t ld,
+                     size_t dim, double *dot) {
+    __m256d acc[ISA_DOT_POINTS][ISA_DOT_WIDTH / 4];
+    size_t q, j, k;
+
+    for(q = 0; q < ISA_DOT_POINTS; q++) {
+        for(j = 0; j < ISA_DOT_WIDTH / 4; j++) {
+            acc[q][j] = _mm256_setzero_pd();
+        }
+    }
+    for(k = 0; k < dim; k++, col += ld) {
+        for(q = 0; q < ISA_DOT_POINTS; q++) {
+            __m256d xk = _mm256_set1_pd(x[q][k]);
+
+            for(j = 0; j < ISA_DOT_WIDTH / 4; j++) {
+                acc[q][j] = _mm256_add_pd(
+                    acc[q][j],
+                    _mm256_mul_pd(xk, _mm256_loadu_pd(col + 4 * j)));
+            }
+        }
+    }
+    for(q = 0; q < ISA_DOT_POINTS; q++) {
+        for(j = 0; j < ISA_DOT_WIDTH / 4; j++) {
+            _mm256_storeu_pd(dot + q * ISA_DOT_WIDTH + 4 * j, acc[q][j]);
+        }
+    }
+    _mm256_zeroupper();
+}
+
+ISA_TARGET("avx2")
+static void avx2_add(double *sum, const double *x, size_t n) {
+    size_t i;
+
+    for(i = 0; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(sum + i, _mm256_add_pd(_mm256_loadu_pd(sum + i),
+                                                _mm256_loadu_pd(x + i)));
+    }
+    _mm256_zeroupper();
+    sse2_add(sum + i, x + i, n - i);
+}
+
+ISA_TARGET("avx2")
+static void avx2_move(double *c, const double *x, double eta, size_t n) {
+    const __m256d veta = _mm256_set1_pd(eta);
+    size_t i;
+
+    for(i = 0; i + 4 <= n; i += 4) {
+        __m256d vc = _mm256_loadu_pd(c + i);
+        __m256d step =
+            _mm256_mul_pd(veta, _mm256_sub_pd(_mm256_loadu_pd(x + i), vc));
+
+        _mm256_storeu_pd(c + i, _mm256_add_pd(vc, step));
+    }
+    _mm256_zeroupper();
+    sse2_move(c + i, x + i, eta, n - i);
+}
+/******************************************************************************/
+
+/********************************************* STATIC FUNCTION DEFINITIONS
+ * (THE AVX-512 KERNELS: 8 DOUBLES A VECTOR)
+ * **************************************************************/
+ISA_TARGET("avx512f")
+static void avx512_squared_distances(const double *point,
+                                     const double *packed, size_t ld,
+                                     size_t count, size_t dim, double *out) {
+    size_t j, k;
+
+    for(j = 0; j + 8 <= count; j += 8) {
+        __m512d sum = _mm512_setzero_pd();
+
+        for(k = 0; k < dim; k++) {
+            __m512d diff = _mm512_sub_pd(_mm512_set1_pd(point[k]),
+                                         _mm512_loadu_pd(packed + k * ld + j));
+            sum = _mm512_add_pd(sum, _mm512_mul_pd(diff, diff));
+        }
+        _mm512_storeu_pd(out + j, sum);
+    }
+    avx2_squared_distances(point, packed + j, ld, count - j, dim, out + j);
+}
+
+ISA_TARGET("avx512f")
+static void avx512_rotate(const double *x, const double *y, size_t stride,
+                          size_t n, double c, double s, double *out_x,
+                          double *out_y, size_t out_stride) {
+    const __m512d vc = _mm512_set1_pd(c), vs = _mm512_set1_pd(s);
+    const __m256i lanes = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256i index =
+        _mm256_mullo_epi32(lanes, _mm256_set1_epi32((int)stride));
+    const __m256i out_index =
+        _mm256_mullo_epi32(lanes, _mm256_set1_epi32((int)out_stride));
+    size_t r;
+
+    for(r = 0; r + 8 <= n; r += 8) {
+        __m512d vx = _mm512_i32gather_pd(index, x + r * stride, 8);
+        __m512d vy = _mm512_i32gather_pd(index, y + r * stride, 8);
+        __m512d rx =
+            _mm512_sub_pd(_mm512_mul_pd(vc, vx), _mm512_mul_pd(vs, vy));
+        __m512d ry =
+            _mm512_add_pd(_mm512_mul_pd(vs, vx), _mm512_mul_pd(vc, vy));
+
+        _mm512_i32scatter_pd(out_x + r * out_stride, out_index, rx, 8);
+        _mm512_i32scatter_pd(out_y + r * out_stride, out_index, ry, 8);
+    }
+    avx2_rotate(x + r * stride, y + r * stride, stride, n - r, c, s,
+                out_x + r * out_stride, out_y + r * out_stride, out_stride);
+}
+
+ISA_TARGET("avx512f")
+static void avx512_dot(const double *const *x, const double *col, size_t ld,
+                       size_t dim, double *dot) {
+    __m512d acc[ISA_DOT_POINTS];
+    size_t q, k;
+
+    for(q = 0; q < ISA_DOT_POINTS; q++) {
+        acc[q] = _mm512_setzero_pd();
+    }
+    for(k = 0; k < dim; k++, col += ld) {
+        __m512d row = _mm512_loadu_pd(col);
+
+        for(q = 0; q < ISA_DOT_POINTS; q++) {
+            acc[q] = _mm512_add_pd(
+                acc[q], _mm512_mul_pd(_mm512_set1_pd(x[q][k]), row));
+        }
+    }
+    for(q = 0; q < ISA_DOT_POINTS; q++) {
+        _mm512_storeu_pd(dot + q * ISA_DOT_WIDTH, acc[q]);
+    }
+    _mm256_zeroupper();
+}
+
+ISA_TARGET("avx512f")
+static void avx512_add(double *sum, const double *x, size_t n) {
+    size_t i;
+
+    for(i = 0; i + 8 <= n; i += 8) {
+        _mm512_storeu_pd(sum + i, _mm512_add_pd(_mm512_loadu_pd(sum + i),
+                                                _mm512_loadu_pd(x + i)));
+    }
+    avx2_add(sum + i, x + i, n - i);
+}
+
+ISA_TARGET("avx512f")
+static void avx512_move(double *c, const double *x, double eta, size_t n) {
+    const __m512d veta = _mm512_set1_pd(eta);
+    size_t i;
+
+    for(i = 0; i + 8 <= n; i += 8) {
+        __m512d vc = _mm512_loadu_pd(c + i);
+        __m512d step =
+            _mm512_mul_pd(veta, _mm512_sub_pd(_mm512_loadu_pd(x + i), vc));
+
+        _mm512_storeu_pd(c + i, _mm512_add_pd(vc, step));
+    }
+    avx2_move(c + i, x + i, eta, n - i);
+}
+/******************************************************************************/
+#endif
@@ -0,0 +1,77 @@
+#ifndef ISA_H
+#define ISA_H
+
+#include "matrix.h"
+#include <stdlib.h>
+
+/* The environment variable that forces an instruction set (see isa_init) */
+#define ISA_ENV "SPKMEANS_ISA"
+
+/* Size of the dot products kernel: the dot products of ISA_DOT_POINTS points
+ * with ISA_DOT_WIDTH consecutive centroids of a packed tile (see distance.c)
+ * are accumulated together */
+#define ISA_DOT_POINTS 4
+#define ISA_DOT_WIDTH 8
+
+/* The instruction sets that the kernels have variants for, from the oldest to
+ * the newest. Every level requires the ones before it. */
+typedef enum isa_level_t {
+    ISA_SCALAR = 0,
+    ISA_SSE2,
+    ISA_AVX2,
+    ISA_AVX512,
+    ISA_LEVELS
+} isa_level_t;
+
+/* Define a structure that will hold the variants of the vectorized kernels
+ * for a single instruction set. Every variant vectorizes across independent
+ * outputs only, and performs the exact same operations (in the same order,
+ * without fused multiply-adds) for every one of them, hence all of the levels
+ * produce bit-identical results.
+ *
+ * 	squared_distances: out[j] = sum_k((point[k] - packed[k * ld + j])^2) for
+ * 		every j < count, where the datapoints are packed transposed (the k-th
+ * 		coordinates of all of them are contiguous, <ld> apart).
+ * 	rotate: out_x[r] = c * x[r] - s * y[r], out_y[r] = s * x[r] + c * y[r]
+ * 		for every r < n, where the inputs are <stride> apart and the outputs
+ * 		are <out_stride> apart (they may be the inputs themselves).
+ * 	dot: dot[q * ISA_DOT_WIDTH + j] = sum_k(x[q][k] * col[k * ld + j]) for
+ * 		every q < ISA_DOT_POINTS and j < ISA_DOT_WIDTH.
+ * 	add: sum[i] += x[i] for every i < n.
+ * 	move: c[i] += eta * (x[i] - c[i]) for every i < n. */
+typedef struct isa_kernels_t {
+    isa_level_t level;
+    const char *name;
+    void (*squared_distances)(const double *point, const double *packed,
+                              size_t ld, size_t count, size_t dim,
+                              double *out);
+    void (*rotate)(const double *x, const double *y, size_t stride, size_t n,
+                   double c, double s, double *out_x, double *out_y,
+                   size_t out_stride);
+    void (*dot)(const double *const *x, const double *col, size_t ld,
+                size_t dim, double *dot);
+    void (*add)(double *sum, const double *x, size_t n);
+    void (*move)(double *c, const double *x, double eta, size_t n);
+} isa_kernels_t;
+
+/* Returns the name of the given level ("scalar", "sse2", "avx2" or
+ * "avx512") */
+const char *isa_name(isa_level_t level);
+
+/* Returns the newest level that both this build and the CPU support */
+isa_level_t isa_detect(void);
+
+/* Selects the kernels of the level named by the ISA_ENV environment variable
+ * (or of isa_detect's level, if it's unset). Returns 0 on success, and
+ * BAD_INPUT in case the name is unknown or the level isn't supported (then
+ * isa_detect's level is selected). */
+int isa_init(void);
+
+/* Returns whether the level was forced by the environment (see isa_init) */
+bool isa_forced(void);
+
+/* Returns the kernels that are used. The first call selects them (see
+ * isa_init), unless they were selected already. */
+const isa_kernels_t *isa_kernels(void);
+
+#endif /* ISA_H */
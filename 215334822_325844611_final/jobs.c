@@ -0,0 +1,183 @@
+#define _POSIX_C_SOURCE 200112L
+#include "jobs.h"
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+/********************************************* STATIC FUNCTION DECLARATIONS
+ * (JOBS)
+ * **************************************************************/
+/* The entry point of a worker thread: performs the queued tasks one after the
+ * other, until the pool is stopping and its queue is empty */
+static void *jobs_worker(void *arg);
+/******************************************************************************/
+
+/********************************************* GLOBAL FUNCTIONS OF THE POOL
+ * **************************************************************/
+int jobs_pool_init(jobs_pool_t *pool, size_t n_threads) {
+    size_t i;
+
+    if(n_threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = (cpus > 0) ? (size_t)cpus : 1;
+    }
+
+    pool->head = NULL;
+    pool->tail = NULL;
+    pool->stopping = false;
+    pool->n_threads = 0;
+    if(NULL == (pool->threads = calloc(n_threads, sizeof(*pool->threads))))
+        return BAD_ALLOC;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+
+    /* A pool with fewer threads than asked for is still a pool */
+    for(i = 0; i < n_threads; i++) {
+        if(0 != pthread_create(&pool->threads[pool->n_threads], NULL,
+                               jobs_worker, pool))
+            break;
+        pool->n_threads++;
+    }
+
+    if(pool->n_threads == 0) {
+        pthread_cond_destroy(&pool->wake);
+        pthread_mutex_destroy(&pool->lock);
+        free(pool->threads);
+        pool->threads = NULL;
+        return BAD_ALLOC;
+    }
+
+    return 0;
+}
+
+int jobs_pool_submit(jobs_pool_t *pool, void (*run)(void *arg), void *arg) {
+    jobs_task_t *task = malloc(sizeof(*task));
+
+    if(NULL == task)
+        return BAD_ALLOC;
+
+    task->run = run;
+    task->arg = arg;
+    task->next = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if(NULL == pool->tail) {
+        pool->head = task;
+    } else {
+        pool->tail->next = task;
+    }
+    pool->tail = task;
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    return 0;
+}
+
+void jobs_pool_destroy(jobs_pool_t *pool) {
+    size_t i;
+
+    if(NULL == pool->threads)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for(i = 0; i < pool->n_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    pool->threads = NULL;
+    pool->n_threads = 0;
+}
+/******************************************************************************/
+
+/********************************************* GLOBAL FUNCTIONS OF THE EVENTS
+ * **************************************************************/
+void jobs_event_init(jobs_event_t *event) {
+    event->set = false;
+    pthread_mutex_init(&event->lock, NULL);
+    pthread_cond_init(&event->cond, NULL);
+}
+
+void jobs_event_set(jobs_event_t *event) {
+    pthread_mutex_lock(&event->lock);
+    event->set = true;
+    pthread_cond_broadcast(&event->cond);
+    pthread_mutex_unlock(&event->lock);
+}
+
+bool jobs_event_wait(jobs_event_t *event, double timeout) {
+    struct timespec deadline;
+    bool set;
+
+    if(timeout >= 0) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += (time_t)timeout;
+        deadline.tv_nsec += (long)((timeout - (double)(time_t)timeout) * 1e9);
+        if(deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    pthread_mutex_lock(&event->lock);
+    while(!event->set) {
+        if(timeout < 0) {
+            pthread_cond_wait(&event->cond, &event->lock);
+        } else if(ETIMEDOUT == pthread_cond_timedwait(&event->cond,
+                                                      &event->lock, &deadline))
+        {
+            break;
+        }
+    }
+    set = event->set;
+    pthread_mutex_unlock(&event->lock);
+
+    return set;
+}
+
+void jobs_event_destroy(jobs_event_t *event) {
+    pthread_cond_destroy(&event->cond);
+    pthread_mutex_destroy(&event->lock);
+}
+/******************************************************************************/
+
+/********************************************* STATIC FUNCTION DEFINITIONS
+ * (RELATED TO THE POOL)
+ * **************************************************************/
+static void *jobs_worker(void *arg) {
+    jobs_pool_t *pool = (jobs_pool_t *)arg;
+
+    pthread_mutex_lock(&pool->lock);
+    for(;;) {
+        jobs_task_t *task;
+
+        while(NULL == pool->head && !pool->stopping) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        if(NULL == pool->head) /* stopping, and nothing is left to do */
+            break;
+
+        task = pool->head;
+        pool->head = task->next;
+        if(NULL == pool->head) {
+            pool->tail = NULL;
+        }
+
+        /* Perform the task without holding the lock */
+        pthread_mutex_unlock(&pool->lock);
+        task->run(task->arg);
+        free(task);
+        pthread_mutex_lock(&pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+/******************************************************************************/
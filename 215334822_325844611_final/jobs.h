@@ -0,0 +1,73 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "matrix.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+/* Define a structure that will hold a single queued task of a pool: the
+ * function that performs it, and its argument */
+typedef struct jobs_task_t {
+    void (*run)(void *arg);
+    void *arg;
+    struct jobs_task_t *next;
+} jobs_task_t;
+
+/* Define a structure that will hold a pool of worker threads, which perform
+ * the submitted tasks in the order of their submission. The tasks run without
+ * any lock held, hence they may take as long as they need. */
+typedef struct jobs_pool_t {
+    pthread_t *threads;
+    size_t n_threads;
+    jobs_task_t *head;
+    jobs_task_t *tail;
+    bool stopping;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+} jobs_pool_t;
+
+/* Define a structure that will hold a one-shot event: it's set once (e.g. by
+ * the task that completes a job), and any amount of threads may wait for
+ * it */
+typedef struct jobs_event_t {
+    bool set;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} jobs_event_t;
+
+/*
+ * THE POOL
+ */
+
+/* Starts a pool of <n_threads> worker threads (0 means one per online CPU).
+ * Returns BAD_ALLOC in case the pool can't be allocated or not even a single
+ * thread can be started. */
+int jobs_pool_init(jobs_pool_t *pool, size_t n_threads);
+
+/* Queues the task run(arg), to be performed by the next idle worker. Returns
+ * BAD_ALLOC in case of an allocation failure (the task isn't queued then). */
+int jobs_pool_submit(jobs_pool_t *pool, void (*run)(void *arg), void *arg);
+
+/* Performs all of the tasks that are still queued, and then stops the workers
+ * and frees the pool. */
+void jobs_pool_destroy(jobs_pool_t *pool);
+
+/*
+ * EVENTS
+ */
+
+/* Initializes an event that isn't set */
+void jobs_event_init(jobs_event_t *event);
+
+/* Sets the event, and wakes up all of the threads that wait for it */
+void jobs_event_set(jobs_event_t *event);
+
+/* Waits until the event is set. A negative <timeout> (in seconds) waits for
+ * as long as it takes. Returns true if the event is set, and false in case
+ * the timeout has passed before that. */
+bool jobs_event_wait(jobs_event_t *event, double timeout);
+
+/* Frees the resources of the event (no thread may be waiting for it) */
+void jobs_event_destroy(jobs_event_t *event);
+
+#endif /* JOBS_H */
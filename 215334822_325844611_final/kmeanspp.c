@@ -0,0 +1,258 @@
+#include "kmeanspp.h"
+#include "profile.h"
+
+/********************************************* STATIC FUNCTION DECLARATIONS
+ * (MT19937 + KMEANS++)
+ * **************************************************************/
+/* Regenerate the whole state of the generator (the "twist" of MT19937) */
+static void rng_generate(rng_t *rng);
+
+/* Update <min_dist> so that each entry holds the minimum between its current
+ * value and the squared distance of the matching row of <points> from the row
+ * <centroid>. If <init> is true, the current values are ignored. */
+static void kmeanspp_update_min_dist(matrix_t points, size_t centroid,
+                                     double *min_dist, bool init);
+
+/* Build the cumulative distribution of the weighted choice out of the
+ * distances, and return the amount of rows below the first value of the
+ * distribution that is bigger than <u> (np.searchsorted(..., side='right')).
+ * Returns (size_t)-1 in case the distances don't form a distribution. */
+static size_t kmeanspp_weighted_choice(double *min_dist, double *cdf, size_t n,
+                                       double u);
+/******************************************************************************/
+
+/********************************************* MT19937 GENERATOR
+ * **************************************************************/
+#define RNG_SHIFT 397
+#define RNG_MATRIX_A 0x9908b0dfUL
+#define RNG_UPPER_MASK 0x80000000UL
+#define RNG_LOWER_MASK 0x7fffffffUL
+#define RNG_WORD_MASK 0xffffffffUL
+
+void rng_seed(rng_t *rng, unsigned long seed) {
+    int pos;
+
+    seed &= RNG_WORD_MASK;
+    for(pos = 0; pos < RNG_STATE_LEN; pos++) {
+        rng->key[pos] = seed;
+        seed = (1812433253UL * (seed ^ (seed >> 30)) + pos + 1) & RNG_WORD_MASK;
+    }
+    rng->pos = RNG_STATE_LEN;
+}
+
+unsigned long rng_next_uint32(rng_t *rng) {
+    unsigned long y;
+
+    if(rng->pos == RNG_STATE_LEN) {
+        rng_generate(rng);
+    }
+
+    y = rng->key[rng->pos++];
+
+    /* Tempering */
+    y ^= (y >> 11);
+    y ^= (y << 7) & 0x9d2c5680UL;
+    y ^= (y << 15) & 0xefc60000UL;
+    y ^= (y >> 18);
+
+    return y & RNG_WORD_MASK;
+}
+
+double rng_next_double(rng_t *rng) {
+    unsigned long a = rng_next_uint32(rng) >> 5;
+    unsigned long b = rng_next_uint32(rng) >> 6;
+
+    return (a * 67108864.0 + b) / 9007199254740992.0;
+}
+
+size_t rng_next_interval(rng_t *rng, size_t max) {
+    size_t mask = max, value;
+
+    if(max == 0)
+        return 0;
+
+    /* Smallest bit mask that is bigger or equal to <max> */
+    mask |= mask >> 1;
+    mask |= mask >> 2;
+    mask |= mask >> 4;
+    mask |= mask >> 8;
+    mask |= mask >> 16;
+    mask |= (mask >> 16) >> 16; /* no-op on 32-bit size_t */
+
+    /* Rejection sampling. Just like NumPy, a single 32-bit word is used for
+     * each attempt if the range allows it, and two words otherwise */
+    do {
+        if(max <= RNG_WORD_MASK) {
+            value = (size_t)rng_next_uint32(rng) & mask;
+        } else {
+            value = (size_t)rng_next_uint32(rng);
+            value = ((value << 16) << 16) | (size_t)rng_next_uint32(rng);
+            value &= mask;
+        }
+    } while(value > max);
+
+    return value;
+}
+
+static void rng_generate(rng_t *rng) {
+    unsigned long y;
+    int i;
+
+    for(i = 0; i < RNG_STATE_LEN - RNG_SHIFT; i++) {
+        y = (rng->key[i] & RNG_UPPER_MASK) | (rng->key[i + 1] & RNG_LOWER_MASK);
+        rng->key[i] =
+            rng->key[i + RNG_SHIFT] ^ (y >> 1) ^ ((y & 1) ? RNG_MATRIX_A : 0);
+    }
+    for(; i < RNG_STATE_LEN - 1; i++) {
+        y = (rng->key[i] & RNG_UPPER_MASK) | (rng->key[i + 1] & RNG_LOWER_MASK);
+        rng->key[i] = rng->key[i + (RNG_SHIFT - RNG_STATE_LEN)] ^ (y >> 1) ^
+                      ((y & 1) ? RNG_MATRIX_A : 0);
+    }
+    y = (rng->key[RNG_STATE_LEN - 1] & RNG_UPPER_MASK) |
+        (rng->key[0] & RNG_LOWER_MASK);
+    rng->key[RNG_STATE_LEN - 1] = rng->key[RNG_SHIFT - 1] ^ (y >> 1) ^
+                                  ((y & 1) ? RNG_MATRIX_A : 0);
+
+    rng->pos = 0;
+}
+/******************************************************************************/
+
+/********************************************* KMEANS++ SEEDING
+ * **************************************************************/
+int kmeanspp_init(matrix_t points, size_t K, unsigned long seed,
+                  size_t *output) {
+    size_t i, phase;
+    double *min_dist = NULL, *cdf = NULL;
+    profile_t *profile = profile_thread();
+    rng_t rng;
+    int signal;
+
+    if(K == 0)
+        return 0;
+    if(K > points.rows)
+        return BAD_INPUT;
+
+    phase = profile_phase(profile, "seeding");
+    min_dist = malloc(points.rows * sizeof(double));
+    cdf = malloc(points.rows * sizeof(double));
+    if(NULL == min_dist || NULL == cdf) {
+        signal = BAD_ALLOC;
+        goto error;
+    }
+
+    rng_seed(&rng, seed);
+
+    /* The first centroid is picked uniformly */
+    output[0] = rng_next_interval(&rng, points.rows - 1);
+    kmeanspp_update_min_dist(points, output[0], min_dist, true);
+
+    /* Each of the next centroids is picked with a probability proportional to
+     * its squared distance from the closest centroid picked so far */
+    for(i = 1; i < K; i++) {
+        output[i] = kmeanspp_weighted_choice(min_dist, cdf, points.rows,
+                                             rng_next_double(&rng));
+        if(output[i] == (size_t)-1) {
+            signal = BAD_INPUT;
+            goto error;
+        }
+
+        if(i < K - 1) {
+            kmeanspp_update_min_dist(points, output[i], min_dist, false);
+        }
+    }
+
+    free(min_dist);
+    free(cdf);
+    profile_phase_restore(profile, phase);
+    return 0;
+
+error:
+    if(NULL != min_dist)
+        free(min_dist);
+    if(NULL != cdf)
+        free(cdf);
+    profile_phase_restore(profile, phase);
+    return signal;
+}
+
+static void kmeanspp_update_min_dist(matrix_t points, size_t centroid,
+                                     double *min_dist, bool init) {
+    const double *c = matrix_row(points, centroid);
+    const double *p = points.data;
+    size_t dim = points.cols, stride = points.stride, i, k;
+
+    /* Four rows are handled at a time, each with its own accumulator. Every
+     * accumulator still sums its coordinates in order, so the distances are
+     * identical to the ones of a plain loop (and of the Python seeding) */
+    for(i = 0; i + 4 <= points.rows; i += 4, p += 4 * stride) {
+        double d0 = 0.0, d1 = 0.0, d2 = 0.0, d3 = 0.0;
+
+        for(k = 0; k < dim; k++) {
+            double t0 = p[k] - c[k];
+            double t1 = p[stride + k] - c[k];
+            double t2 = p[2 * stride + k] - c[k];
+            double t3 = p[3 * stride + k] - c[k];
+
+            d0 += t0 * t0;
+            d1 += t1 * t1;
+            d2 += t2 * t2;
+            d3 += t3 * t3;
+        }
+
+        min_dist[i] = (init || d0 < min_dist[i]) ? d0 : min_dist[i];
+        min_dist[i + 1] = (init || d1 < min_dist[i + 1]) ? d1 : min_dist[i + 1];
+        min_dist[i + 2] = (init || d2 < min_dist[i + 2]) ? d2 : min_dist[i + 2];
+        min_dist[i + 3] = (init || d3 < min_dist[i + 3]) ? d3 : min_dist[i + 3];
+    }
+
+    /* Remaining rows */
+    for(; i < points.rows; i++, p += stride) {
+        double d = 0.0;
+
+        for(k = 0; k < dim; k++) {
+            double t = p[k] - c[k];
+            d += t * t;
+        }
+
+        min_dist[i] = (init || d < min_dist[i]) ? d : min_dist[i];
+    }
+}
+
+static size_t kmeanspp_weighted_choice(double *min_dist, double *cdf, size_t n,
+                                       double u) {
+    size_t i, low, high;
+    double sum = 0.0, total;
+
+    for(i = 0; i < n; i++) {
+        sum += min_dist[i];
+    }
+
+    if(!(sum > 0.0))
+        return (size_t)-1;
+
+    /* Same sequence of floating point operations as NumPy's choice:
+     * p = dist / sum, cdf = cumsum(p), cdf /= cdf[-1] */
+    cdf[0] = min_dist[0] / sum;
+    for(i = 1; i < n; i++) {
+        cdf[i] = cdf[i - 1] + min_dist[i] / sum;
+    }
+    total = cdf[n - 1];
+    for(i = 0; i < n; i++) {
+        cdf[i] /= total;
+    }
+
+    /* Binary search for the first value that is bigger than u */
+    low = 0;
+    high = n;
+    while(low < high) {
+        size_t mid = low + (high - low) / 2;
+        if(cdf[mid] <= u) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return (low < n) ? low : n - 1;
+}
+/******************************************************************************/
@@ -0,0 +1,51 @@
+#ifndef KMEANSPP_H
+#define KMEANSPP_H
+
+#include "matrix.h"
+#include <stdlib.h>
+
+/* The amount of 32-bit words in the state of the MT19937 generator */
+#define RNG_STATE_LEN 624
+
+/* The seed used by the Python interface (np.random.seed(0)) */
+#define KMEANSPP_DEFAULT_SEED 0
+
+/* Define a structure that will hold the state of an MT19937 generator. The
+ * generator is bit-compatible with NumPy's legacy `RandomState`, so that a
+ * given seed produces the exact same choices as `np.random.seed(seed)`
+ * followed by `np.random.choice` */
+typedef struct rng_t {
+    unsigned long key[RNG_STATE_LEN];
+    int pos;
+} rng_t;
+
+/* Seed the given generator, the same way `np.random.seed(seed)` does */
+void rng_seed(rng_t *rng, unsigned long seed);
+
+/* Return the next 32-bit word produced by the generator */
+unsigned long rng_next_uint32(rng_t *rng);
+
+/* Return a uniformly distributed double in [0, 1) (53 bits of randomness).
+ * Equivalent to `np.random.random_sample()` */
+double rng_next_double(rng_t *rng);
+
+/* Return a uniformly distributed integer in [0, max]. Equivalent to
+ * `np.random.randint(0, max + 1)` (and hence to `np.random.choice` of a range
+ * of max + 1 elements without probabilities) */
+size_t rng_next_interval(rng_t *rng, size_t max);
+
+/* Pick <K> initial centroids out of the rows of <points>, using the kmeans++
+ * seeding algorithm, and store their indices in the pre-allocated <output>
+ * (an array of K elements).
+ *
+ * The choices are identical to the ones made by the original Python seeding
+ * (np.random.seed(seed), then one np.random.choice per centroid), so the
+ * default seed reproduces the outputs of the Python interface.
+ *
+ * Returns 0 on success, BAD_ALLOC in case of an allocation failure, and
+ * BAD_INPUT in case the datapoints don't allow a weighted choice (e.g. K is
+ * bigger than the number of rows, or all of the remaining distances are 0). */
+int kmeanspp_init(matrix_t points, size_t K, unsigned long seed,
+                  size_t *output);
+
+#endif /* KMEANSPP_H */
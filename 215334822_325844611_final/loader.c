@@ -0,0 +1,1141 @@
+#define _POSIX_C_SOURCE 200112L
+#include "loader.h"
+#include "profile.h"
+#include "writer.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/********************************************* STATIC FUNCTION DECLARATIONS
+ * (CSV LOADER)
+ * **************************************************************/
+/* The most significant digits that fit exactly in a double's mantissa, and
+ * the biggest power of 10 that's exactly representable as a double. Within
+ * these limits, a single multiplication (or division) by a power of 10 is
+ * correctly rounded, hence identical to strtod (Clinger's fast path). */
+#define LOADER_FAST_DIGITS 15
+#define LOADER_FAST_EXP 22
+
+/* Define a structure that will hold a chunk of whole lines of the text, parsed
+ * by a single thread. The first pass over the chunk counts its lines and rows
+ * (non-blank lines), and the second one parses its rows into the matrix,
+ * starting at the row <first_row>. */
+typedef struct loader_chunk_t {
+    const char *begin;
+    const char *end;
+    size_t cols;
+    size_t lines;
+    size_t rows;
+    size_t first_line;
+    size_t first_row;
+    double *data;
+    bool counting; /* which pass is performed */
+    loader_error_t error;
+    pthread_t thread;
+    bool started;
+} loader_chunk_t;
+
+/* Define a structure that will hold the rows parsed so far, in a buffer that
+ * grows (doubling) as more rows are appended. The amount of values per row is
+ * discovered from the first row, and the amount of rows once the text ends. */
+typedef struct loader_rows_t {
+    double *data;
+    size_t rows;
+    size_t cols;
+    size_t capacity;
+    size_t line;         /* the amount of lines seen so far */
+    size_t expected_len; /* the length of the whole text (0 if unknown) */
+} loader_rows_t;
+
+/* Parses the lines of [begin, end) and appends their rows to <acc>. The text
+ * must end right after a newline, unless it's the end of the whole text.
+ * Returns 0 on success, and BAD_ALLOC or BAD_INPUT (described in <error>)
+ * otherwise, in which case the rows of <acc> are freed. */
+static int loader_append_rows(loader_rows_t *acc, const char *begin,
+                              const char *end, loader_error_t *error);
+
+/* Moves the rows of <acc> into <output> (releasing their spare capacity).
+ * Returns BAD_INPUT in case there are no rows. */
+static int loader_finish_rows(loader_rows_t *acc, matrix_t *output,
+                              loader_error_t *error);
+
+/* Parses the text on several threads (see loader_parse_csv). <begin> is the
+ * first row of the text, which has <cols> values. */
+static int loader_parse_csv_parallel(const char *text, const char *begin,
+                                     const char *end, size_t cols,
+                                     size_t n_threads, matrix_t *output,
+                                     loader_error_t *error);
+
+/* Performs the current pass over all of the given chunks, the first one on
+ * the calling thread */
+static void loader_run_chunks(loader_chunk_t *chunks, size_t n_chunks);
+
+/* The entry point of a parsing thread: performs the current pass over a
+ * single chunk */
+static void *loader_chunk_worker(void *arg);
+
+/* Parses a single row of <cols> values out of [begin, end) into <row>, and
+ * stores a pointer right past the row (and its line ending) in <next>.
+ * Returns NULL on success, and the reason of the failure otherwise. */
+static const char *loader_parse_row(const char *begin, const char *end,
+                                    double *row, size_t cols,
+                                    const char **next);
+
+/* Returns the amount of comma separated values of the line starting at
+ * <begin> */
+static size_t loader_count_cols(const char *begin, const char *end);
+
+/* Skips spaces, tabs and '\r's */
+static const char *loader_skip_blanks(const char *p, const char *end);
+
+/* Parses the number starting at <begin> with strtod (on a terminated copy of
+ * it, as the text isn't necessarily terminated) */
+static const char *loader_parse_double_slow(const char *begin,
+                                            const char *end, double *output);
+/******************************************************************************/
+
+/********************************************* STATIC FUNCTION DECLARATIONS
+ * (BINARY FORMATS)
+ * **************************************************************/
+/* The magic string of NumPy's format, and the length of the fixed part of
+ * its header (magic, version and the length of the rest of the header) in
+ * versions 1 and 2 of the format */
+#define LOADER_NPY_MAGIC "\x93NUMPY"
+#define LOADER_NPY_MAGIC_LEN 6
+#define LOADER_NPY_PREFIX_V1 10
+#define LOADER_NPY_PREFIX_V2 12
+
+/* Maps the whole given file into <mapping> (read-only). An empty file isn't
+ * mapped (the `addr` field is NULL, and the `len` field is 0). */
+static int loader_map_file(const char *filename, loader_mapping_t *mapping);
+
+/* Builds the matrix out of the doubles stored in the mapping at <offset>. The
+ * mapping is used in place if possible, and released otherwise (the doubles
+ * are copied, byte swapped if <swap> and transposed if <fortran>). */
+static int loader_use_mapping(loader_mapping_t *mapping, size_t offset,
+                              size_t rows, size_t cols, bool swap,
+                              bool fortran, matrix_t *output,
+                              loader_error_t *error);
+
+/* Copies the doubles at <src> into a newly allocated matrix (byte swapped if
+ * <swap>, and transposed if <fortran>) */
+static int loader_copy_doubles(const unsigned char *src, size_t rows,
+                               size_t cols, bool swap, bool fortran,
+                               matrix_t *output);
+
+/* Decodes the header of a record of the binary format, found at <offset> in
+ * the mapping, into its dimensions and whether its doubles must be swapped */
+static int loader_binary_record(const loader_mapping_t *mapping, size_t offset,
+                                size_t *rows, size_t *cols, bool *swap,
+                                loader_error_t *error);
+
+/* Decodes the header of the binary format / of NumPy's format, and builds
+ * the matrix out of the mapping */
+static int loader_decode_binary(loader_mapping_t *mapping, matrix_t *output,
+                                loader_error_t *error);
+static int loader_decode_npy(loader_mapping_t *mapping, matrix_t *output,
+                             loader_error_t *error);
+
+/* Builds the header of the matrix in the binary format / in NumPy's format
+ * into <header> (which must hold LOADER_HEADER_MAX bytes), and returns its
+ * length */
+#define LOADER_HEADER_MAX 128
+static size_t loader_binary_header(matrix_t points, unsigned char *header);
+static size_t loader_npy_header(matrix_t points, unsigned char *header);
+
+/* Writes the doubles of the matrix (row after row) into <fd>: at once if
+ * it's contiguous, and row by row otherwise */
+static int loader_write_doubles(int fd, matrix_t points);
+
+/* Reads (writes) an unsigned 64-bit integer stored in the given byte order.
+ * Returns BAD_INPUT in case the value doesn't fit in a size_t. */
+static int loader_read_u64(const unsigned char *bytes, bool little,
+                           size_t *output);
+static void loader_write_u64(unsigned char *bytes, bool little, size_t value);
+
+/* Returns true if the native byte order is little endian */
+static bool loader_native_little(void);
+
+/* Stores the reason of a rejected binary input in <error> (unless it's NULL)
+ * and returns BAD_INPUT */
+static int loader_reject(loader_error_t *error, const char *reason);
+/******************************************************************************/
+
+/********************************************* GLOBAL FUNCTIONS OF THE LOADER
+ * **************************************************************/
+int loader_parse_csv(const char *text, size_t len, size_t n_threads,
+                     matrix_t *output, loader_error_t *error) {
+    const char *p = text, *end = text + len;
+    loader_rows_t acc;
+    int signal;
+
+    output->data = NULL;
+
+    if(n_threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = (cpus > 0) ? (size_t)cpus : 1;
+    }
+    if(n_threads > len / LOADER_CHUNK_MIN_BYTES) {
+        n_threads = len / LOADER_CHUNK_MIN_BYTES;
+    }
+
+    /* Once the amount of values per row is known (out of the first row that
+     * isn't blank), large texts are split between several threads */
+    if(n_threads > 1) {
+        for(p = loader_skip_blanks(p, end); p < end && *p == '\n';) {
+            p = loader_skip_blanks(p + 1, end);
+        }
+        if(p < end)
+            return loader_parse_csv_parallel(text, p, end,
+                                             loader_count_cols(p, end),
+                                             n_threads, output, error);
+    }
+
+    memset(&acc, 0, sizeof(acc));
+    acc.expected_len = len;
+
+    if((signal = loader_append_rows(&acc, text, end, error)))
+        return signal;
+    return loader_finish_rows(&acc, output, error);
+}
+
+int loader_load_stream(int fd, matrix_t *output, loader_error_t *error) {
+    loader_rows_t acc;
+    char *buf;
+    size_t len = 0, cap = LOADER_STREAM_BUFFER;
+    bool eof = false;
+    int signal = 0;
+
+    output->data = NULL;
+    memset(&acc, 0, sizeof(acc));
+
+    if(NULL == (buf = malloc(cap)))
+        return BAD_ALLOC;
+    profile_allocated(cap);
+
+    while(!eof) {
+        ssize_t result;
+        size_t complete;
+
+        /* A line that's longer than the whole buffer: grow it */
+        if(len == cap) {
+            char *grown = realloc(buf, cap * 2);
+            if(NULL == grown) {
+                signal = BAD_ALLOC;
+                break;
+            }
+            profile_allocated(cap);
+            buf = grown;
+            cap *= 2;
+        }
+
+        result = read(fd, buf + len, cap - len);
+        if(result < 0) {
+            if(errno == EINTR)
+                continue;
+            signal = BAD_INPUT;
+            break;
+        }
+        eof = (result == 0);
+        len += (size_t)result;
+
+        /* Parse the complete lines, and keep the last (incomplete) line for
+         * the next read, unless it's the end of the input */
+        for(complete = len; !eof && complete > 0 && buf[complete - 1] != '\n';)
+        {
+            complete--;
+        }
+        if(complete > 0) {
+            if((signal = loader_append_rows(&acc, buf, buf + complete, error)))
+                break;
+
+            memmove(buf, buf + complete, len - complete);
+            len -= complete;
+        }
+    }
+
+    free(buf);
+    if(signal) {
+        if(NULL != acc.data)
+            free(acc.data);
+        return signal;
+    }
+    return loader_finish_rows(&acc, output, error);
+}
+
+int loader_load_csv(const char *filename, matrix_t *output,
+                    loader_error_t *error) {
+    loader_mapping_t mapping;
+    int signal;
+
+    output->data = NULL;
+
+    if((signal = loader_map_file(filename, &mapping)))
+        return signal;
+
+    /* The file is read once, from its beginning to its end */
+    if(NULL != mapping.addr) {
+        posix_madvise(mapping.addr, mapping.len, POSIX_MADV_SEQUENTIAL);
+    }
+
+    signal = loader_parse_csv(
+        (NULL != mapping.addr) ? (const char *)mapping.addr : "", mapping.len,
+        0, output, error);
+
+    loader_unmap(&mapping);
+    return signal;
+}
+
+int loader_load(const char *filename, matrix_t *output,
+                loader_mapping_t *mapping, loader_error_t *error) {
+    const char *ext = strrchr(filename, '.');
+    int signal;
+
+    output->data = NULL;
+    mapping->addr = NULL;
+    mapping->len = 0;
+
+    if(strcmp(filename, "-") == 0)
+        return loader_load_stream(STDIN_FILENO, output, error);
+
+    if(NULL == ext || ext == filename)
+        return BAD_INPUT;
+
+    if(strcmp(ext, ".csv") == 0 || strcmp(ext, ".txt") == 0)
+        return loader_load_csv(filename, output, error);
+
+    if(strcmp(ext, ".bin") != 0 && strcmp(ext, ".npy") != 0)
+        return BAD_INPUT;
+
+    if((signal = loader_map_file(filename, mapping)))
+        return signal;
+
+    if(strcmp(ext, ".bin") == 0) {
+        signal = loader_decode_binary(mapping, output, error);
+    } else {
+        signal = loader_decode_npy(mapping, output, error);
+    }
+
+    if(signal) {
+        loader_unmap(mapping);
+    }
+    return signal;
+}
+
+void loader_unmap(loader_mapping_t *mapping) {
+    if(NULL != mapping->addr) {
+        munmap(mapping->addr, mapping->len);
+    }
+    mapping->addr = NULL;
+    mapping->len = 0;
+}
+
+int loader_save(const char *filename, matrix_t points) {
+    const char *ext = strrchr(filename, '.');
+    unsigned char header[LOADER_HEADER_MAX];
+    size_t header_len;
+    int fd, signal;
+
+    if(NULL == ext || (strcmp(ext, ".bin") != 0 && strcmp(ext, ".npy") != 0))
+        return BAD_INPUT;
+
+    if(strcmp(ext, ".bin") == 0) {
+        header_len = loader_binary_header(points, header);
+    } else {
+        header_len = loader_npy_header(points, header);
+    }
+
+    if(0 > (fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666)))
+        return BAD_OUTPUT;
+
+    if(0 == (signal = writer_write_all(fd, header, header_len))) {
+        signal = loader_write_doubles(fd, points);
+    }
+
+    if(0 != close(fd)) {
+        signal = BAD_OUTPUT;
+    }
+    return signal;
+}
+
+int loader_save_records(const char *filename, const matrix_t *matrices,
+                        size_t count) {
+    unsigned char header[LOADER_HEADER_MAX];
+    size_t i;
+    int fd, signal = 0;
+
+    if(0 > (fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666)))
+        return BAD_OUTPUT;
+
+    for(i = 0; i < count && 0 == signal; i++) {
+        size_t header_len = loader_binary_header(matrices[i], header);
+
+        if(0 == (signal = writer_write_all(fd, header, header_len))) {
+            signal = loader_write_doubles(fd, matrices[i]);
+        }
+    }
+
+    if(0 != close(fd)) {
+        signal = BAD_OUTPUT;
+    }
+    return signal;
+}
+
+int loader_load_records(const char *filename, matrix_t *outputs, size_t count,
+                        loader_error_t *error) {
+    loader_mapping_t mapping;
+    size_t i, offset = 0;
+    int signal = 0;
+
+    for(i = 0; i < count; i++) {
+        outputs[i].data = NULL;
+    }
+
+    if((signal = loader_map_file(filename, &mapping)))
+        return signal;
+
+    for(i = 0; i < count && 0 == signal; i++) {
+        size_t rows, cols, len;
+        bool swap;
+
+        if((signal = loader_binary_record(&mapping, offset, &rows, &cols,
+                                          &swap, error)))
+            break;
+        offset += LOADER_BINARY_HEADER;
+
+        len = rows * cols;
+        if(rows == 0 || cols == 0) {
+            signal = loader_reject(error, "no rows");
+        } else if(len / cols != rows ||
+                  len > (mapping.len - offset) / sizeof(double)) {
+            signal = loader_reject(error, "truncated data");
+        } else {
+            signal = loader_copy_doubles(
+                (const unsigned char *)mapping.addr + offset, rows, cols, swap,
+                false, &outputs[i]);
+            offset += len * sizeof(double);
+        }
+    }
+
+    if(0 == signal && offset != mapping.len) {
+        signal = loader_reject(error, "trailing data");
+    }
+
+    loader_unmap(&mapping);
+    if(signal) {
+        for(i = 0; i < count; i++) {
+            matrix_free_safe(outputs[i]);
+            outputs[i].data = NULL;
+        }
+    }
+    return signal;
+}
+
+const char *loader_parse_double(const char *begin, const char *end,
+                                double *output) {
+    static const double powers[LOADER_FAST_EXP + 1] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+        1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+        1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char *p = begin;
+    double mantissa = 0.0;
+    long exponent = 0, explicit_exponent = 0;
+    int digits = 0;
+    bool negative = false, any_digit = false;
+
+    if(p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+
+    /* Integral part (leading zeros aren't significant) */
+    for(; p < end && *p >= '0' && *p <= '9'; p++) {
+        any_digit = true;
+        if(digits > 0 || *p != '0') {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits++;
+        }
+    }
+
+    /* Fractional part */
+    if(p < end && *p == '.') {
+        for(p++; p < end && *p >= '0' && *p <= '9'; p++) {
+            any_digit = true;
+            if(digits > 0 || *p != '0') {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits++;
+            }
+            exponent--;
+        }
+    }
+
+    if(!any_digit)
+        return loader_parse_double_slow(begin, end, output);
+
+    /* Exponent */
+    if(p < end && (*p == 'e' || *p == 'E')) {
+        bool negative_exponent = false;
+        const char *exponent_begin;
+
+        p++;
+        if(p < end && (*p == '-' || *p == '+')) {
+            negative_exponent = (*p == '-');
+            p++;
+        }
+
+        exponent_begin = p;
+        for(; p < end && *p >= '0' && *p <= '9'; p++) {
+            if(explicit_exponent < 10000) {
+                explicit_exponent = explicit_exponent * 10 + (*p - '0');
+            }
+        }
+        if(p == exponent_begin)
+            return loader_parse_double_slow(begin, end, output);
+
+        exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+    }
+
+    /* Anything that isn't a plain decimal number (or that doesn't fit the
+     * fast path) is left to strtod */
+    if(digits > LOADER_FAST_DIGITS ||
+       (p < end && (*p == '.' || *p == 'x' || *p == 'X' ||
+                    (*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z'))))
+        return loader_parse_double_slow(begin, end, output);
+
+    if(mantissa != 0.0) {
+        if(exponent < -LOADER_FAST_EXP || exponent > LOADER_FAST_EXP)
+            return loader_parse_double_slow(begin, end, output);
+
+        if(exponent >= 0) {
+            mantissa *= powers[exponent];
+        } else {
+            mantissa /= powers[-exponent];
+        }
+    }
+
+    *output = negative ? -mantissa : mantissa;
+    return p;
+}
+/******************************************************************************/
+
+/********************************************* STATIC FUNCTION DEFINITIONS
+ * (RELATED TO THE CSV LOADER)
+ * **************************************************************/
+static int loader_parse_csv_parallel(const char *text, const char *begin,
+                                     const char *end, size_t cols,
+                                     size_t n_threads, matrix_t *output,
+                                     loader_error_t *error) {
+    loader_chunk_t *chunks;
+    const char *p;
+    size_t i, lines = 0, rows = 0;
+
+    chunks = calloc(n_threads, sizeof(*chunks));
+    if(NULL == chunks)
+        return BAD_ALLOC;
+
+    /* The lines before <begin> are blank */
+    for(p = text; p < begin; p++) {
+        lines += (*p == '\n');
+    }
+
+    /* Split the rest of the text into chunks of (about) the same size, each
+     * ending right after a newline */
+    for(i = 0; i < n_threads; i++) {
+        const char *chunk_end = end;
+
+        if(i + 1 < n_threads) {
+            chunk_end = begin + (size_t)(end - begin) / n_threads * (i + 1);
+            chunk_end = (chunk_end < p) ? p : chunk_end;
+            while(chunk_end < end && chunk_end > begin &&
+                  chunk_end[-1] != '\n')
+            {
+                chunk_end++;
+            }
+        }
+
+        chunks[i].begin = p;
+        chunks[i].end = chunk_end;
+        chunks[i].cols = cols;
+        chunks[i].counting = true;
+        p = chunk_end;
+    }
+
+    /* First pass: count the lines and rows of every chunk, and stitch them
+     * into the offsets of the chunks */
+    loader_run_chunks(chunks, n_threads);
+    for(i = 0; i < n_threads; i++) {
+        chunks[i].first_line = lines;
+        chunks[i].first_row = rows;
+        lines += chunks[i].lines;
+        rows += chunks[i].rows;
+    }
+
+    /* Second pass: parse every chunk into its place in the matrix */
+    if(matrix_new(rows, cols, output)) {
+        free(chunks);
+        return BAD_ALLOC;
+    }
+    for(i = 0; i < n_threads; i++) {
+        chunks[i].data = output->data;
+        chunks[i].counting = false;
+    }
+    loader_run_chunks(chunks, n_threads);
+
+    /* Report the first malformed row of the text */
+    for(i = 0; i < n_threads; i++) {
+        if(0 != chunks[i].error.line) {
+            if(NULL != error) {
+                *error = chunks[i].error;
+            }
+            matrix_free(*output);
+            output->data = NULL;
+            free(chunks);
+            return BAD_INPUT;
+        }
+    }
+
+    free(chunks);
+    return 0;
+}
+
+static int loader_append_rows(loader_rows_t *acc, const char *begin,
+                              const char *end, loader_error_t *error) {
+    const char *p = begin, *next, *reason;
+
+    while(p < end) {
+        acc->line++;
+
+        /* Blank lines are skipped */
+        p = loader_skip_blanks(p, end);
+        if(p == end)
+            break;
+        if(*p == '\n') {
+            p++;
+            continue;
+        }
+
+        if(acc->cols == 0) {
+            acc->cols = loader_count_cols(p, end);
+        }
+
+        /* Grow the buffer (doubling it, so that each value is moved a
+         * constant amount of times on average). Every growth is accounted to
+         * the profile, as the bytes it adds. */
+        if(acc->rows == acc->capacity) {
+            size_t capacity = (acc->capacity == 0) ? 64 : acc->capacity * 2;
+            double *grown =
+                realloc(acc->data, capacity * acc->cols * sizeof(double));
+
+            if(NULL == grown) {
+                free(acc->data);
+                acc->data = NULL;
+                return BAD_ALLOC;
+            }
+            profile_allocated((capacity - acc->capacity) * acc->cols *
+                              sizeof(double));
+            acc->data = grown;
+            acc->capacity = capacity;
+        }
+
+        if(NULL != (reason = loader_parse_row(p, end,
+                                              acc->data + acc->rows * acc->cols,
+                                              acc->cols, &next)))
+        {
+            if(NULL != error) {
+                error->line = acc->line;
+                error->reason = reason;
+            }
+            free(acc->data);
+            acc->data = NULL;
+            return BAD_INPUT;
+        }
+
+        /* Once the first row is known, most of the reallocations can be
+         * spared by estimating the amount of rows out of its length */
+        if(acc->rows == 0 && next - p > 0 && acc->expected_len > 0) {
+            size_t estimate = acc->expected_len / (size_t)(next - p) + 16;
+            double *grown;
+
+            if(estimate > acc->capacity &&
+               NULL != (grown = realloc(acc->data, estimate * acc->cols *
+                                                       sizeof(double))))
+            {
+                profile_allocated((estimate - acc->capacity) * acc->cols *
+                                  sizeof(double));
+                acc->data = grown;
+                acc->capacity = estimate;
+            }
+        }
+
+        acc->rows++;
+        p = next;
+    }
+
+    return 0;
+}
+
+static int loader_finish_rows(loader_rows_t *acc, matrix_t *output,
+                              loader_error_t *error) {
+    if(acc->rows == 0) {
+        if(NULL != error) {
+            error->line = acc->line;
+            error->reason = "no rows";
+        }
+        if(NULL != acc->data)
+            free(acc->data);
+        return BAD_INPUT;
+    }
+
+    /* Release the spare capacity */
+    if(acc->rows < acc->capacity) {
+        double *shrunk =
+            realloc(acc->data, acc->rows * acc->cols * sizeof(double));
+        acc->data = (NULL != shrunk) ? shrunk : acc->data;
+    }
+
+    output->data = acc->data;
+    output->rows = acc->rows;
+    output->cols = acc->cols;
+    output->len = acc->rows * acc->cols;
+    output->stride = acc->cols;
+
+    return 0;
+}
+
+static void loader_run_chunks(loader_chunk_t *chunks, size_t n_chunks) {
+    size_t i;
+
+    /* If a thread can't be created, its chunk is parsed by the calling
+     * thread instead */
+    for(i = 1; i < n_chunks; i++) {
+        chunks[i].started = (0 == pthread_create(&chunks[i].thread, NULL,
+                                                 loader_chunk_worker,
+                                                 &chunks[i]));
+    }
+    loader_chunk_worker(&chunks[0]);
+    for(i = 1; i < n_chunks; i++) {
+        if(chunks[i].started) {
+            pthread_join(chunks[i].thread, NULL);
+        } else {
+            loader_chunk_worker(&chunks[i]);
+        }
+    }
+}
+
+static void *loader_chunk_worker(void *arg) {
+    loader_chunk_t *chunk = (loader_chunk_t *)arg;
+    const char *p = chunk->begin, *end = chunk->end, *next, *reason;
+    size_t line = chunk->first_line, row = chunk->first_row;
+
+    /* Exactly the same lines are considered rows by both passes (and by the
+     * single-threaded parser): the ones that aren't blank */
+    while(p < end) {
+        line++;
+
+        p = loader_skip_blanks(p, end);
+        if(p == end)
+            break;
+        if(*p == '\n') {
+            p++;
+            continue;
+        }
+
+        if(chunk->counting) {
+            const char *eol = memchr(p, '\n', (size_t)(end - p));
+            next = (NULL != eol) ? eol + 1 : end;
+        } else if(NULL != (reason = loader_parse_row(
+                               p, end, chunk->data + row * chunk->cols,
+                               chunk->cols, &next)))
+        {
+            chunk->error.line = line;
+            chunk->error.reason = reason;
+            break;
+        }
+
+        row++;
+        p = next;
+    }
+
+    if(chunk->counting) {
+        chunk->lines = line - chunk->first_line;
+        chunk->rows = row - chunk->first_row;
+    }
+    return NULL;
+}
+
+static const char *loader_parse_row(const char *begin, const char *end,
+                                    double *row, size_t cols,
+                                    const char **next) {
+    const char *p = begin;
+    size_t j;
+
+    for(j = 0; j < cols; j++) {
+        p = loader_skip_blanks(p, end);
+        if(p == end || *p == ',' || *p == '\n')
+            return (j == 0 || *p == ',') ? "missing value" : "too few values";
+
+        if(NULL == (p = loader_parse_double(p, end, &row[j])))
+            return "invalid number";
+
+        p = loader_skip_blanks(p, end);
+        if(j + 1 < cols) {
+            if(p == end || *p == '\n')
+                return "too few values";
+            if(*p != ',')
+                return "invalid number";
+            p++;
+        }
+    }
+
+    if(p < end && *p == ',')
+        return "too many values";
+    if(p < end && *p != '\n')
+        return "invalid number";
+
+    *next = (p < end) ? p + 1 : p;
+    return NULL;
+}
+
+static size_t loader_count_cols(const char *begin, const char *end) {
+    size_t cols = 1;
+
+    for(; begin < end && *begin != '\n'; begin++) {
+        cols += (*begin == ',');
+    }
+
+    return cols;
+}
+
+static const char *loader_skip_blanks(const char *p, const char *end) {
+    while(p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        p++;
+    }
+    return p;
+}
+
+static const char *loader_parse_double_slow(const char *begin,
+                                            const char *end, double *output) {
+    char token[LOADER_TOKEN_MAX];
+    char *stop;
+    size_t len = 0;
+
+    /* The number ends at the first delimiter */
+    while(begin + len < end && begin[len] != ',' && begin[len] != '\n' &&
+          begin[len] != ' ' && begin[len] != '\t' && begin[len] != '\r')
+    {
+        if(len + 1 == LOADER_TOKEN_MAX)
+            return NULL;
+        token[len] = begin[len];
+        len++;
+    }
+    token[len] = '\0';
+
+    *output = strtod(token, &stop);
+    if(stop == token)
+        return NULL;
+
+    return begin + (stop - token);
+}
+/******************************************************************************/
+
+/********************************************* STATIC FUNCTION DEFINITIONS
+ * (RELATED TO THE BINARY FORMATS)
+ * **************************************************************/
+static int loader_map_file(const char *filename, loader_mapping_t *mapping) {
+    struct stat st;
+    void *addr;
+    int fd;
+
+    mapping->addr = NULL;
+    mapping->len = 0;
+
+    if(0 > (fd = open(filename, O_RDONLY)))
+        return BAD_INPUT;
+
+    if(0 != fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return BAD_INPUT;
+    }
+
+    /* An empty file can't be mapped */
+    if(st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(MAP_FAILED == addr)
+        return BAD_ALLOC;
+
+    mapping->addr = addr;
+    mapping->len = (size_t)st.st_size;
+    return 0;
+}
+
+static int loader_use_mapping(loader_mapping_t *mapping, size_t offset,
+                              size_t rows, size_t cols, bool swap,
+                              bool fortran, matrix_t *output,
+                              loader_error_t *error) {
+    const unsigned char *src;
+    size_t len = rows * cols;
+
+    if(rows == 0 || cols == 0)
+        return loader_reject(error, "no rows");
+    if(len / cols != rows || len > ((size_t)-1 - offset) / sizeof(double) ||
+       offset + len * sizeof(double) > mapping->len)
+        return loader_reject(error, "truncated data");
+
+    src = (const unsigned char *)mapping->addr + offset;
+
+    /* Zero-copy: the mapping holds the matrix as is */
+    if(!swap && !fortran && offset % sizeof(double) == 0) {
+        output->data = (double *)src;
+        output->rows = rows;
+        output->cols = cols;
+        output->len = len;
+        output->stride = cols;
+        return 0;
+    }
+
+    if(loader_copy_doubles(src, rows, cols, swap, fortran, output))
+        return BAD_ALLOC;
+
+    loader_unmap(mapping);
+    return 0;
+}
+
+static int loader_copy_doubles(const unsigned char *src, size_t rows,
+                               size_t cols, bool swap, bool fortran,
+                               matrix_t *output) {
+    size_t i, j, k;
+
+    if(matrix_new(rows, cols, output))
+        return BAD_ALLOC;
+
+    for(i = 0; i < rows; i++) {
+        for(j = 0; j < cols; j++) {
+            const unsigned char *value =
+                src + (fortran ? j * rows + i : i * cols + j) * sizeof(double);
+            unsigned char *dest =
+                (unsigned char *)(output->data + i * cols + j);
+
+            for(k = 0; k < sizeof(double); k++) {
+                dest[k] = value[swap ? sizeof(double) - 1 - k : k];
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int loader_decode_binary(loader_mapping_t *mapping, matrix_t *output,
+                                loader_error_t *error) {
+    size_t rows, cols;
+    bool swap;
+    int signal;
+
+    if((signal = loader_binary_record(mapping, 0, &rows, &cols, &swap, error)))
+        return signal;
+
+    return loader_use_mapping(mapping, LOADER_BINARY_HEADER, rows, cols, swap,
+                              false, output, error);
+}
+
+static int loader_binary_record(const loader_mapping_t *mapping, size_t offset,
+                                size_t *rows, size_t *cols, bool *swap,
+                                loader_error_t *error) {
+    const unsigned char *header;
+    bool little;
+
+    if(mapping->len < LOADER_BINARY_HEADER ||
+       offset > mapping->len - LOADER_BINARY_HEADER)
+        return loader_reject(error, "not a binary dataset");
+
+    header = (const unsigned char *)mapping->addr + offset;
+    if(0 != memcmp(header, LOADER_BINARY_MAGIC, sizeof(LOADER_BINARY_MAGIC)))
+        return loader_reject(error, "not a binary dataset");
+    if(header[8] != LOADER_BINARY_VERSION)
+        return loader_reject(error, "unsupported version");
+    if(header[9] != LOADER_DTYPE_DOUBLE)
+        return loader_reject(error, "unsupported type (only doubles)");
+    if(header[10] != 'L' && header[10] != 'B')
+        return loader_reject(error, "invalid byte order");
+
+    little = (header[10] == 'L');
+    if(loader_read_u64(header + 16, little, rows) ||
+       loader_read_u64(header + 24, little, cols))
+        return loader_reject(error, "dimensions too big");
+
+    *swap = (little != loader_native_little());
+    return 0;
+}
+
+static int loader_decode_npy(loader_mapping_t *mapping, matrix_t *output,
+                             loader_error_t *error) {
+    const unsigned char *bytes = (const unsigned char *)mapping->addr;
+    size_t prefix, header_len, dims[2] = {0, 1}, ndim = 0;
+    char *header, *p;
+    bool little, fortran;
+
+    if(mapping->len < LOADER_NPY_PREFIX_V2 ||
+       0 != memcmp(bytes, LOADER_NPY_MAGIC, LOADER_NPY_MAGIC_LEN))
+        return loader_reject(error, "not a NumPy array");
+
+    /* The length of the header is a little endian 16-bit integer in version
+     * 1, and a 32-bit integer in versions 2 and 3 */
+    if(bytes[6] == 1) {
+        prefix = LOADER_NPY_PREFIX_V1;
+        header_len = (size_t)bytes[8] | ((size_t)bytes[9] << 8);
+    } else if(bytes[6] == 2 || bytes[6] == 3) {
+        prefix = LOADER_NPY_PREFIX_V2;
+        header_len = (size_t)bytes[8] | ((size_t)bytes[9] << 8) |
+                     ((size_t)bytes[10] << 16) | ((size_t)bytes[11] << 24);
+    } else {
+        return loader_reject(error, "unsupported version");
+    }
+    if(header_len > mapping->len - prefix)
+        return loader_reject(error, "truncated header");
+
+    /* The header is a Python dict literal. A terminated copy of it is
+     * searched for the three keys. */
+    if(NULL == (header = malloc(header_len + 1)))
+        return BAD_ALLOC;
+    memcpy(header, bytes + prefix, header_len);
+    header[header_len] = '\0';
+
+    if(NULL != strstr(header, "'descr': '<f8'")) {
+        little = true;
+    } else if(NULL != strstr(header, "'descr': '>f8'")) {
+        little = false;
+    } else {
+        free(header);
+        return loader_reject(error, "unsupported type (only doubles)");
+    }
+
+    fortran = (NULL != strstr(header, "'fortran_order': True"));
+
+    if(NULL == (p = strstr(header, "'shape': ("))) {
+        free(header);
+        return loader_reject(error, "missing shape");
+    }
+    for(p += strlen("'shape': ("); *p != ')' && *p != '\0';) {
+        char *stop;
+        unsigned long dim = strtoul(p, &stop, 10);
+
+        if(stop == p || ndim == 2) {
+            free(header);
+            return loader_reject(error, "unsupported shape (1 or 2 dims)");
+        }
+        dims[ndim++] = (size_t)dim;
+
+        for(p = stop; *p == ',' || *p == ' ';) {
+            p++;
+        }
+    }
+    free(header);
+
+    if(ndim == 0)
+        return loader_reject(error, "unsupported shape (1 or 2 dims)");
+
+    return loader_use_mapping(mapping, prefix + header_len, dims[0], dims[1],
+                              little != loader_native_little(),
+                              fortran && ndim == 2, output, error);
+}
+
+static size_t loader_binary_header(matrix_t points, unsigned char *header) {
+    bool little = loader_native_little();
+
+    memset(header, 0, LOADER_BINARY_HEADER);
+    memcpy(header, LOADER_BINARY_MAGIC, sizeof(LOADER_BINARY_MAGIC));
+    header[8] = LOADER_BINARY_VERSION;
+    header[9] = LOADER_DTYPE_DOUBLE;
+    header[10] = little ? 'L' : 'B';
+    loader_write_u64(header + 16, little, points.rows);
+    loader_write_u64(header + 24, little, points.cols);
+
+    return LOADER_BINARY_HEADER;
+}
+
+static size_t loader_npy_header(matrix_t points, unsigned char *header) {
+    char *dict = (char *)header + LOADER_NPY_PREFIX_V1;
+    size_t dict_len, len;
+
+    /* The header is padded with spaces (and terminated by a newline) so that
+     * the data is aligned to 64 bytes, as NumPy does */
+    sprintf(dict,
+            "{'descr': '%cf8', 'fortran_order': False, 'shape': (%lu, %lu), }",
+            loader_native_little() ? '<' : '>', (unsigned long)points.rows,
+            (unsigned long)points.cols);
+    dict_len = strlen(dict);
+    len = (LOADER_NPY_PREFIX_V1 + dict_len + 1 + 63) / 64 * 64;
+    memset(dict + dict_len, ' ', len - LOADER_NPY_PREFIX_V1 - dict_len);
+    header[len - 1] = '\n';
+
+    memcpy(header, LOADER_NPY_MAGIC, LOADER_NPY_MAGIC_LEN);
+    header[6] = 1;
+    header[7] = 0;
+    header[8] = (unsigned char)((len - LOADER_NPY_PREFIX_V1) & 0xff);
+    header[9] = (unsigned char)((len - LOADER_NPY_PREFIX_V1) >> 8);
+
+    return len;
+}
+
+static int loader_write_doubles(int fd, matrix_t points) {
+    size_t i;
+    int signal = 0;
+
+    if(matrix_is_contiguous(points))
+        return writer_write_all(fd, points.data, points.len * sizeof(double));
+
+    for(i = 0; i < points.rows && 0 == signal; i++) {
+        signal = writer_write_all(fd, matrix_row(points, i),
+                                  points.cols * sizeof(double));
+    }
+    return signal;
+}
+
+static int loader_read_u64(const unsigned char *bytes, bool little,
+                           size_t *output) {
+    size_t value = 0;
+    int i;
+
+    /* From the most significant byte to the least significant one */
+    for(i = 0; i < 8; i++) {
+        if(value > ((size_t)-1 >> 8))
+            return BAD_INPUT;
+        value = (value << 8) | bytes[little ? 7 - i : i];
+    }
+
+    *output = value;
+    return 0;
+}
+
+static void loader_write_u64(unsigned char *bytes, bool little, size_t value) {
+    int i;
+
+    /* From the least significant byte to the most significant one */
+    for(i = 0; i < 8; i++) {
+        bytes[little ? i : 7 - i] = (unsigned char)(value & 0xff);
+        value = (value >> 4) >> 4; /* no undefined shift on 32-bit size_t */
+    }
+}
+
+static bool loader_native_little(void) {
+    unsigned int one = 1;
+    return *(unsigned char *)&one == 1;
+}
+
+static int loader_reject(loader_error_t *error, const char *reason) {
+    if(NULL != error) {
+        error->line = 1;
+        error->reason = reason;
+    }
+    return BAD_INPUT;
+}
+/******************************************************************************/
@@ -0,0 +1,131 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include "matrix.h"
+#include <stdlib.h>
+
+/* The longest number (in characters) that the loader accepts */
+#define LOADER_TOKEN_MAX 512
+
+/* The least amount of bytes of text that's worth a thread of its own */
+#define LOADER_CHUNK_MIN_BYTES (1 << 20)
+
+/* The initial size of the buffer of a streamed text (it grows to hold any
+ * line that's longer) */
+#define LOADER_STREAM_BUFFER (1 << 20)
+
+/* The binary format: a header of LOADER_BINARY_HEADER bytes, followed by the
+ * raw row-major doubles (hence aligned for a mapping of the file):
+ * 		bytes 0-7: the magic "SPKMBIN\0"
+ * 		byte 8: the version of the format (LOADER_BINARY_VERSION)
+ * 		byte 9: the type of the values ('d', for doubles)
+ * 		byte 10: the byte order of the numbers of the file ('L' or 'B')
+ * 		bytes 16-23: the amount of rows (an unsigned 64-bit integer)
+ * 		bytes 24-31: the amount of columns (an unsigned 64-bit integer)
+ * The rest of the bytes of the header are zeros. */
+#define LOADER_BINARY_MAGIC "SPKMBIN"
+#define LOADER_BINARY_VERSION 1
+#define LOADER_BINARY_HEADER 64
+#define LOADER_DTYPE_DOUBLE 'd'
+
+/* Define a structure that will hold a mapped file, whose contents are used in
+ * place */
+typedef struct loader_mapping_t {
+    void *addr;
+    size_t len;
+} loader_mapping_t;
+
+/* Define a structure that will describe the first malformed row of an input:
+ * its line (starting from 1) and the reason it was rejected. A <line> of 0
+ * means that no row was rejected (binary inputs report a <line> of 1 along
+ * with the reason they were rejected). */
+typedef struct loader_error_t {
+    size_t line;
+    const char *reason;
+} loader_error_t;
+
+/* Parses the given CSV text (<len> bytes long, not necessarily terminated by
+ * a '\0') into a newly allocated matrix, whose rows are stored contiguously,
+ * and stores it in <output>. The text is scanned once: every line that isn't
+ * blank is a row, and all of the rows must hold the same amount of comma
+ * separated values as the first one. Whitespace around the values, "\r\n"
+ * line endings and blank lines are accepted.
+ *
+ * Large texts are split into chunks of whole lines, parsed on up to
+ * <n_threads> threads (0 means one thread per online CPU, and each thread
+ * gets LOADER_CHUNK_MIN_BYTES at least). The rows of every chunk are counted
+ * first, so that each chunk is parsed directly into its place in the matrix
+ * (and the order of the rows is preserved).
+ *
+ * Returns 0 on success, BAD_ALLOC in case of an allocation failure, and
+ * BAD_INPUT in case of a malformed row (described in <error>, unless it's
+ * NULL) or of a text without rows. On failure, <output> holds a `data` field
+ * of NULL. */
+int loader_parse_csv(const char *text, size_t len, size_t n_threads,
+                     matrix_t *output, loader_error_t *error);
+
+/* Maps the given file into memory and parses it with loader_parse_csv (on one
+ * thread per online CPU). Returns BAD_INPUT in case the file can't be opened
+ * as well. */
+int loader_load_csv(const char *filename, matrix_t *output,
+                    loader_error_t *error);
+
+/* Parses the CSV text read from the file descriptor <fd> (e.g. a pipe) until
+ * its end, in a single pass: the text is read into a buffer, and its complete
+ * lines are parsed (as loader_parse_csv does, on one thread) into a growable
+ * matrix after every read. The amount of values per row is discovered from
+ * the first row, and the amount of rows once the text ends, hence the text is
+ * never rewound (nor kept in memory as a whole). Returns BAD_INPUT in case
+ * <fd> can't be read as well. */
+int loader_load_stream(int fd, matrix_t *output, loader_error_t *error);
+
+/* Loads the given file into <output>, according to its extension:
+ * 		0. "-": the text of stdin, parsed by loader_load_stream
+ * 		1. ".csv" or ".txt": text, parsed by loader_load_csv
+ * 		2. ".bin": the binary format described above
+ * 		3. ".npy": a NumPy array of doubles, of 1 or 2 dimensions
+ * The binary formats are mapped into memory, and if their doubles are already
+ * in the native byte order (and row-major), <output> points directly into the
+ * mapping (which is stored in <mapping>, and must be released with
+ * loader_unmap). Otherwise, <output> is allocated (freed with matrix_free) and
+ * the `addr` field of <mapping> is NULL.
+ * Returns BAD_INPUT in case of an unknown extension, an unreadable file or a
+ * malformed content (described in <error>, unless it's NULL). */
+int loader_load(const char *filename, matrix_t *output,
+                loader_mapping_t *mapping, loader_error_t *error);
+
+/* Releases the given mapping. If nothing is mapped (NULL), this function
+ * safely does nothing. */
+void loader_unmap(loader_mapping_t *mapping);
+
+/* Saves the given matrix into a file, in the binary format (".bin") or as a
+ * NumPy array (".npy"), according to the extension of <filename>: the header
+ * is followed by a single write of all of the doubles. Returns BAD_INPUT in
+ * case of another extension, and BAD_OUTPUT in case the file can't be
+ * written. */
+int loader_save(const char *filename, matrix_t points);
+
+/* Saves the given <count> matrices into a single file, as consecutive records
+ * of the binary format (each one is a header followed by its doubles, as
+ * loader_save writes a ".bin" file). Returns BAD_OUTPUT in case the file
+ * can't be written. */
+int loader_save_records(const char *filename, const matrix_t *matrices,
+                        size_t count);
+
+/* Loads the <count> consecutive records of the binary format that make up the
+ * given file (see loader_save_records) into <outputs>, which are newly
+ * allocated (and freed with matrix_free). Returns BAD_INPUT in case the file
+ * can't be read, or if it isn't made of exactly <count> valid records
+ * (described in <error>, unless it's NULL). On failure, every output holds a
+ * `data` field of NULL. */
+int loader_load_records(const char *filename, matrix_t *outputs, size_t count,
+                        loader_error_t *error);
+
+/* Parses a single number out of [begin, end) into <output>, and returns a
+ * pointer right past it (or NULL if there's no valid number there). Plain
+ * decimal numbers of up to 15 significant digits are converted directly (and
+ * exactly, just like strtod), while any other form falls back to strtod. */
+const char *loader_parse_double(const char *begin, const char *end,
+                                double *output);
+
+#endif /* LOADER_H */
@@ -1,22 +1,108 @@
+#define _POSIX_C_SOURCE 200112L
 #include "matrix.h"
+#include "arena.h"
+#include "disk.h"
+#include "profile.h"
+#include "writer.h"
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
 
-int matrix_new(size_t rows, size_t cols, matrix_t *output) {
-    size_t len = rows * cols;
-    double *data = calloc(len, sizeof(double));
-    if(NULL == data)
+/* The side of the tiles that matrix_mirror_upper copies at a time */
+#define MATRIX_MIRROR_TILE 64
+
+/* Allocates a matrix of <rows> rows, whose rows start <stride> doubles
+   apart, at an address aligned to MATRIX_ALIGN bytes: out of <arena>, mapped
+   from the scratch directory if it's <large> and the calling thread maps its
+   large matrices (see disk_thread_used), or out of the heap otherwise. It's
+   zero-initialized only if <zero> (a mapping always is). A <large> matrix is
+   held by the arena of the calling thread (see arena_hold), so that it's
+   accounted to the stage that allocates it. */
+static int matrix_alloc(size_t rows, size_t cols, size_t stride, bool zero,
+                        bool large, arena_t *arena, matrix_t *output) {
+    size_t size = rows * stride;
+    arena_t *holder;
+    void *data;
+
+    output->data = NULL;
+    if(stride != 0 && (size / stride != rows ||
+                       size > ((size_t)-1) / sizeof(double)))
+        return BAD_ALLOC;
+
+    /* A matrix without any elements still gets an (aligned) allocation */
+    size = (size ? size : 1) * sizeof(double);
+    if(NULL != arena) {
+        if(NULL == (data = arena_alloc(arena, size, zero)))
+            return BAD_ALLOC;
+    } else if(large && disk_thread_used()) {
+        if(disk_alloc(size, &data))
+            return BAD_ALLOC;
+        profile_allocated(size);
+    } else {
+        if(0 != posix_memalign(&data, MATRIX_ALIGN, size))
+            return BAD_ALLOC;
+        if(zero) {
+            memset(data, 0, size);
+        }
+        profile_allocated(size);
+    }
+
+    if(large && (NULL == (holder = arena_thread()) ||
+                 arena_hold(holder, data, size)))
+    {
+        if(!disk_free(data)) {
+            free(data);
+        }
         return BAD_ALLOC;
+    }
 
-    output->data = data;
+    output->data = (double *)data;
     output->rows = rows;
     output->cols = cols;
-    output->len = len;
+    output->len = rows * cols;
+    output->stride = stride;
 
     return 0;
 }
 
+/* Rounds the given amount of columns up to a multiple of MATRIX_ALIGN bytes */
+static size_t matrix_padded_stride(size_t cols) {
+    const size_t per_line = MATRIX_ALIGN / sizeof(double);
+
+    return (cols + per_line - 1) / per_line * per_line;
+}
+
+int matrix_new(size_t rows, size_t cols, matrix_t *output) {
+    return matrix_alloc(rows, cols, cols, true, false, NULL, output);
+}
+
+int matrix_new_padded(size_t rows, size_t cols, matrix_t *output) {
+    return matrix_alloc(rows, cols, matrix_padded_stride(cols), true, false,
+                        NULL, output);
+}
+
+int matrix_new_uninit(size_t rows, size_t cols, matrix_t *output) {
+    return matrix_alloc(rows, cols, cols, false, false, NULL, output);
+}
+
+int matrix_new_large(size_t rows, size_t cols, bool padded, bool zero,
+                     matrix_t *output) {
+    return matrix_alloc(rows, cols, padded ? matrix_padded_stride(cols) : cols,
+                        zero, true, NULL, output);
+}
+
+int matrix_new_scratch(size_t rows, size_t cols, bool padded,
+                       matrix_t *output) {
+    arena_t *arena = arena_thread();
+
+    if(NULL == arena) {
+        output->data = NULL;
+        return BAD_ALLOC;
+    }
+    return matrix_alloc(rows, cols, padded ? matrix_padded_stride(cols) : cols,
+                        false, false, arena, output);
+}
+
 int matrix_clone(matrix_t mat, matrix_t *output) {
 
     if(matrix_new(mat.rows, mat.cols, output))
@@ -29,12 +115,62 @@ int matrix_clone(matrix_t mat, matrix_t *output) {
 }
 
 int matrix_copy(matrix_t dest, matrix_t src) {
+    size_t i;
+
     if(!(dest.rows == src.rows && dest.cols == src.cols))
         return DIM_MISMATCH;
-    memcpy(dest.data, src.data, sizeof(double) * src.len);
+
+    /* Matrices of the same layout (e.g. two contiguous matrices, or two
+     * padded ones) are copied at once, and views row by row */
+    if(dest.stride == src.stride && src.rows > 0) {
+        memcpy(dest.data, src.data,
+               sizeof(double) * ((src.rows - 1) * src.stride + src.cols));
+        return 0;
+    }
+    for(i = 0; i < src.rows; i++) {
+        memcpy(matrix_row(dest, i), matrix_row(src, i),
+               sizeof(double) * src.cols);
+    }
     return 0;
 }
 
+matrix_t matrix_view_block(matrix_t mat, size_t i, size_t j, size_t rows,
+                           size_t cols) {
+    matrix_t view;
+
+    view.data = mat.data + i * mat.stride + j;
+    view.rows = rows;
+    view.cols = cols;
+    view.len = rows * cols;
+    view.stride = mat.stride;
+
+    return view;
+}
+
+matrix_t matrix_view_rows(matrix_t mat, size_t first, size_t count) {
+    return matrix_view_block(mat, first, 0, count, mat.cols);
+}
+
+matrix_t matrix_view_cols(matrix_t mat, size_t first, size_t count) {
+    return matrix_view_block(mat, 0, first, mat.rows, count);
+}
+
+void matrix_compact(matrix_t *mat) {
+    size_t i;
+
+    if(matrix_is_contiguous(*mat))
+        return;
+
+    /* Every row moves towards the start of the storage (the i-th row from
+       i * stride to i * cols), hence moving them in order never overwrites a
+       row that hasn't moved yet */
+    for(i = 1; i < mat->rows; i++) {
+        memmove(mat->data + i * mat->cols, mat->data + i * mat->stride,
+                sizeof(double) * mat->cols);
+    }
+    mat->stride = mat->cols;
+}
+
 int matrix_build_from_dpoints(dpoint_t *vectors, size_t num_vectors, size_t dim,
                               matrix_t *output) {
     size_t i, j;
@@ -51,56 +187,65 @@ int matrix_build_from_dpoints(dpoint_t *vectors, size_t num_vectors, size_t dim,
 }
 
 /* Calculates the index of the desired element for use with the matrix's
-   inner `data` field. This is mainly used for optimization.
+   inner `data` field, in the debug build.
 
    This function also performs a bounds check on the given values: in case
-   of failure, an error is printed to the console and the returned value
-   is the maximum for `size_t`. */
+   of failure, an error is printed into stderr and the program is aborted
+   (instead of accessing memory out of the matrix). */
 static size_t matrix_calc_index(matrix_t mat, size_t i, size_t j) {
     if(i >= mat.rows) {
-        printf("invalid index for matrix: the number of rows is %lu but the "
-               "index is %lu\n",
-               mat.rows, i);
-        return (size_t)-1;
+        fprintf(stderr,
+                "invalid index for matrix: the number of rows is %lu but the "
+                "index is %lu\n",
+                (unsigned long)mat.rows, (unsigned long)i);
+        abort();
     }
 
     if(j >= mat.cols) {
-        printf("invalid index for matrix: the number of cols is %lu but the "
-               "index is %lu\n",
-               mat.cols, j);
-        return (size_t)-1;
+        fprintf(stderr,
+                "invalid index for matrix: the number of cols is %lu but the "
+                "index is %lu\n",
+                (unsigned long)mat.cols, (unsigned long)j);
+        abort();
     }
 
-    return i * mat.cols + j;
+    return i * mat.stride + j;
 }
 
-double matrix_get(matrix_t mat, size_t i, size_t j) {
+double matrix_get_checked(matrix_t mat, size_t i, size_t j) {
     size_t index = matrix_calc_index(mat, i, j);
     return mat.data[index];
 }
 
-void matrix_set(matrix_t mat, size_t i, size_t j, double val) {
+void matrix_set_checked(matrix_t mat, size_t i, size_t j, double val) {
     size_t index = matrix_calc_index(mat, i, j);
     mat.data[index] = val;
 }
 
-void matrix_print_rows(matrix_t mat) {
-    size_t idx, row, col;
+int matrix_print_rows(matrix_t mat) {
+    /* Anything printed through stdio so far goes first */
+    fflush(stdout);
 
-    idx = 0;
-    for(row = 0; row < mat.rows; row++) {
-        for(col = 0; col < mat.cols; col++) {
-            printf("%.4f", mat.data[idx]);
-            if(col < mat.cols - 1)
-                printf(",");
-            idx++;
-        }
-        puts("");
+    return writer_matrix_rows(mat, 1);
+}
+
+void matrix_advise(matrix_t mat, bool sequential) {
+    disk_advise(mat.data, sequential);
+}
+
+void matrix_disown(matrix_t mat) {
+    arena_t *arena = arena_thread();
+
+    if(NULL != arena) {
+        arena_drop(arena, mat.data);
     }
 }
 
 void matrix_free(matrix_t mat) {
-    free(mat.data);
+    matrix_disown(mat);
+    if(!disk_free(mat.data)) {
+        free(mat.data);
+    }
 }
 
 void matrix_free_safe(matrix_t mat) {
@@ -151,3 +296,45 @@ matrix_ind_t matrix_ind_of_largest_offdiagonal(matrix_t sym_mat) {
     }
     return output;
 }
+
+void matrix_scan_offdiagonal(matrix_t sym_mat, double *sum, matrix_ind_t *loc) {
+    double current_max = -1;
+    size_t i, j;
+
+    *sum = 0.0;
+    for(i = 0; i < sym_mat.rows; i++) {
+        for(j = 0; j < sym_mat.cols; j++) {
+            double value = matrix_get(sym_mat, i, j);
+
+            *sum += (i != j) ? pow(value, 2) : 0;
+            if(j > i && fabs(value) > current_max) {
+                loc->i = i;
+                loc->j = j;
+                current_max = fabs(value);
+            }
+        }
+    }
+}
+
+void matrix_mirror_upper(matrix_t mat) {
+    size_t ti, tj, i, j;
+
+    /* Every tile of the lower triangle is copied out of its transposed tile
+     * of the upper one */
+    for(ti = 0; ti < mat.rows; ti += MATRIX_MIRROR_TILE) {
+        size_t i_end = (ti + MATRIX_MIRROR_TILE < mat.rows)
+                           ? ti + MATRIX_MIRROR_TILE
+                           : mat.rows;
+
+        for(tj = 0; tj <= ti; tj += MATRIX_MIRROR_TILE) {
+            for(i = ti; i < i_end; i++) {
+                size_t j_end =
+                    (tj + MATRIX_MIRROR_TILE < i) ? tj + MATRIX_MIRROR_TILE : i;
+
+                for(j = tj; j < j_end; j++) {
+                    matrix_set(mat, i, j, matrix_get(mat, j, i));
+                }
+            }
+        }
+    }
+}
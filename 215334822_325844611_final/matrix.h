@@ -4,12 +4,24 @@
 
 #define DIM_MISMATCH 1
 #define BAD_ALLOC 2
-
+#define BAD_INPUT 3
+#define BAD_OUTPUT 4
+
+/* The alignment (in bytes) of the storage of every allocated matrix, so that
+   vectorized kernels may use aligned loads on it */
+#define MATRIX_ALIGN 64
+
+/* Define a structure that will hold a matrix of doubles: its element (i, j)
+   is data[i * stride + j]. <len> is the amount of its elements (rows * cols).
+   A matrix is contiguous if its <stride> equals its <cols>, while a padded
+   matrix (see matrix_new_padded) or a view of another matrix (see
+   matrix_view_block) has a larger <stride>. */
 typedef struct matrix {
     double *data;
     size_t rows;
     size_t cols;
     size_t len;
+    size_t stride;
 } matrix_t;
 
 /* Define a structre the will hold the indices in the matrix of a value.
@@ -36,18 +48,80 @@ typedef struct {
  */
 
 /* Creates a new matrix with the given dimensions. The created matrix must be
-   freed with `matrix_free`. The created matrix is zero-initialized.
+   freed with `matrix_free`. The created matrix is zero-initialized,
+   contiguous, and aligned to MATRIX_ALIGN bytes.
 
    In case of allocation failure, the output matrix has a `data` field of
    `NULL`. */
 int matrix_new(size_t rows, size_t cols, matrix_t *output);
 
+/* The same as matrix_new, while padding every row up to a multiple of
+   MATRIX_ALIGN bytes (the padding is zeros), so that every row of the created
+   matrix is aligned as well. */
+int matrix_new_padded(size_t rows, size_t cols, matrix_t *output);
+
+/* The same as matrix_new, without zero-initializing the matrix (for a matrix
+   whose every element is written before it's read) */
+int matrix_new_uninit(size_t rows, size_t cols, matrix_t *output);
+
+/* Creates a matrix that may not fit in memory (an n x n matrix of the
+   datapoints), padded if <padded>, and zero-initialized only if <zero>. It's
+   mapped from a file of the scratch directory if the run of the calling
+   thread is out of core (see disk.h), and allocated just like matrix_new
+   otherwise. Either way, it's freed with `matrix_free`, and it's accounted to
+   the stage of the arena of the calling thread that creates it (see
+   arena_hold) until it's freed or disowned (see matrix_disown).
+
+   In case of allocation failure, the output matrix has a `data` field of
+   `NULL`. */
+int matrix_new_large(size_t rows, size_t cols, bool padded, bool zero,
+                     matrix_t *output);
+
+/* Creates a scratch matrix of a stage of a pipeline: it's allocated out of
+   the arena of the calling thread (see arena.h), padded if <padded>, and not
+   zero-initialized. It's NEVER freed with `matrix_free`: it's released along
+   with everything allocated after a mark of the arena that was taken before
+   it (see arena_mark and arena_release).
+
+   In case of allocation failure, the output matrix has a `data` field of
+   `NULL`. */
+int matrix_new_scratch(size_t rows, size_t cols, bool padded,
+                       matrix_t *output);
+
 /* Clones the given matrix into a newly allocated matrix.
 
    In case of allocation failure, the output matrix has a `data` field of
    `NULL`. */
 int matrix_clone(matrix_t mat, matrix_t *output);
 
+/*
+ * VIEWS
+ */
+
+/* Returns a view of the <rows> x <cols> block of <mat> whose first element is
+   (i, j): it shares the storage of <mat> (and its stride), hence it's never
+   freed by itself, and it's valid for as long as <mat> is. Every operation of
+   this file accepts views. */
+matrix_t matrix_view_block(matrix_t mat, size_t i, size_t j, size_t rows,
+                           size_t cols);
+
+/* Returns a view of <count> consecutive rows / columns of <mat>, starting
+   from the <first> one (see matrix_view_block) */
+matrix_t matrix_view_rows(matrix_t mat, size_t first, size_t count);
+matrix_t matrix_view_cols(matrix_t mat, size_t first, size_t count);
+
+/* Makes the given matrix contiguous in place, within its own storage (its
+   rows are moved towards its start). Pre-condition: <mat> owns its storage,
+   or it's a view that starts at the beginning of the storage (e.g. the
+   columns of a matrix starting from the first one). */
+void matrix_compact(matrix_t *mat);
+
+/* Whether the rows of the matrix are stored one right after the other */
+#define matrix_is_contiguous(mat) ((mat).stride == (mat).cols)
+
+/* A pointer to the first element of the i-th row of the matrix */
+#define matrix_row(mat, i) ((mat).data + (i) * (mat).stride)
+
 /* Copies data from one matrix into another.
    If the matrices are different in size, no change is made and
    DIM_MISMATCH is returned. */
@@ -60,14 +134,40 @@ int matrix_copy(matrix_t dest, matrix_t src);
 int matrix_build_from_dpoints(dpoint_t *vectors, size_t num_vectors, size_t dim,
                               matrix_t *output);
 
-/* Gets the desired element from the given matrix. */
-double matrix_get(matrix_t mat, size_t i, size_t j);
-
-/* Set the desired element from the given matrix. */
-void matrix_set(matrix_t mat, size_t i, size_t j, double val);
-
-/* Prints the given matrix's rows. */
-void matrix_print_rows(matrix_t mat);
+/* Gets / sets the desired element of the given matrix. These sit in the inner
+   loops of the goals, hence they're macros that index the matrix directly,
+   without any bounds check (and <mat> may be evaluated more than once).
+
+   A debug build (compiled with -DMATRIX_DEBUG, see comp.sh) maps them to
+   matrix_get_checked / matrix_set_checked instead. */
+#ifdef MATRIX_DEBUG
+#define matrix_get(mat, i, j) matrix_get_checked((mat), (i), (j))
+#define matrix_set(mat, i, j, val) matrix_set_checked((mat), (i), (j), (val))
+#else
+#define matrix_get(mat, i, j) ((mat).data[(i) * (mat).stride + (j)])
+#define matrix_set(mat, i, j, val) \
+    ((mat).data[(i) * (mat).stride + (j)] = (val))
+#endif
+
+/* The bounds checked versions of matrix_get / matrix_set: an index out of the
+   bounds of the matrix is reported into stderr, and aborts the program. */
+double matrix_get_checked(matrix_t mat, size_t i, size_t j);
+void matrix_set_checked(matrix_t mat, size_t i, size_t j, double val);
+
+/* Prints the given matrix's rows into stdout, as lines of comma separated
+   "%.4f" values (through a buffered writer, see writer.h). Returns 0 on
+   success, BAD_ALLOC or BAD_OUTPUT otherwise. */
+int matrix_print_rows(matrix_t mat);
+
+/* Advises how a large matrix (see matrix_new_large) is accessed from now on:
+   row by row if <sequential>, and otherwise in any order. It only matters to
+   a matrix that's mapped from the scratch directory (see disk_advise). */
+void matrix_advise(matrix_t mat, bool sequential);
+
+/* Stops accounting a large matrix (see matrix_new_large) to the arena of the
+   calling thread, e.g. once it's handed over to a caller that may free it on
+   another thread. Any other matrix is left as is. */
+void matrix_disown(matrix_t mat);
 
 /* Frees a given matrix that was allocated using any matrix method. */
 void matrix_free(matrix_t mat);
@@ -91,4 +191,14 @@ double matrix_sum_squared_off(matrix_t mat);
  * returned will and must be out of the higher half of the matrix. */
 matrix_ind_t matrix_ind_of_largest_offdiagonal(matrix_t sym_mat);
 
+/* The same as both matrix_sum_squared_off (into <sum>) and
+ * matrix_ind_of_largest_offdiagonal (into <loc>), with the same results, in a
+ * single pass over the matrix (row by row). */
+void matrix_scan_offdiagonal(matrix_t sym_mat, double *sum, matrix_ind_t *loc);
+
+/* Copies the upper triangle of the given square matrix into its lower
+ * triangle, so that it's symmetric. The copy goes by tiles, so that both
+ * triangles are accessed a few rows at a time. */
+void matrix_mirror_upper(matrix_t mat);
+
 #endif /* MATRIX_H */
@@ -0,0 +1,325 @@
+#include "model.h"
+#include "arena.h"
+#include "backend.h"
+#include "profile.h"
+#include <math.h>
+
+/********************************************* STATIC FUNCTION DECLARATIONS
+ * (MODEL)
+ * **************************************************************/
+/* Builds the projection of the model out of its degrees, eigen values and
+ * eigen vectors: projection[j][k] = u_k(j) / (sqrt(d_j) * (1 - lambda_k)),
+ * so that the Nystrom extension of every eigen vector to a new datapoint is
+ * the dot product of its weights with a column of the projection */
+static int model_build_projection(model_t *model);
+
+/* Checks that the loaded matrices of the model fit each other */
+static bool model_is_consistent(const model_t *model);
+
+/* Stores the weights of the given datapoint to the datapoints of the model in
+ * <weights> (an array of n elements), and returns its degree */
+static double model_weights(const model_t *model, const double *point,
+                            double *weights);
+
+/* Normalizes the given embedding of a datapoint of the given degree (see
+ * model_predict), and returns the index of its closest centroid */
+static size_t model_assign(const model_t *model, double *embedding,
+                           double degree);
+/******************************************************************************/
+
+/********************************************* GLOBAL FUNCTIONS OF THE MODEL
+ * **************************************************************/
+void model_init(model_t *model) {
+    model->K = 0;
+    model->points.data = NULL;
+    model->degrees.data = NULL;
+    model->eigen_values.data = NULL;
+    model->eigen_vectors.data = NULL;
+    model->centroids.data = NULL;
+    model->projection.data = NULL;
+}
+
+void model_free(model_t *model) {
+    matrix_free_safe(model->points);
+    matrix_free_safe(model->degrees);
+    matrix_free_safe(model->eigen_values);
+    matrix_free_safe(model->eigen_vectors);
+    matrix_free_safe(model->centroids);
+    matrix_free_safe(model->projection);
+    model_init(model);
+}
+
+int model_fit(spkmeans_ctx_t *ctx, kmeans_config_t config, model_t *model,
+              size_t **indices) {
+    jacobi_t spectrum;
+    matrix_t T;
+    profile_t *profile;
+    size_t k, *seeds = NULL;
+    int signal = BAD_ALLOC;
+
+    model_init(model);
+    if(NULL != indices) {
+        *indices = NULL;
+    }
+
+    /* The same restrictions as spkmeans_spk's (and the same planning) */
+    if(ctx->K >= ctx->num_data || ctx->K == 1)
+        return BAD_INPUT;
+    if(budget_plan("fit", ctx->num_data, ctx->dim, &ctx->plan))
+        return BAD_ALLOC;
+    profile = profile_begin();
+
+    /* The datapoints are kept by the model, since T replaces them in the
+     * context */
+    if(matrix_build_from_dpoints(ctx->datapoints, ctx->num_data, ctx->dim,
+                                 &model->points))
+        goto error;
+    if(matrix_new(ctx->num_data, 1, &model->degrees))
+        goto error;
+
+    if((signal = build_spectral_embedding(ctx, ctx->K, model->degrees.data,
+                                          &spectrum, &T)))
+        goto error;
+
+    /* Only the eigen values of the kept eigen vectors are needed, and the
+     * eigen vectors (a view of the storage of the jacobi algorithm) are kept
+     * contiguous */
+    model->K = T.cols;
+    if(matrix_clone(spectrum.eigen_vectors, &model->eigen_vectors) ||
+       matrix_new(model->K, 1, &model->eigen_values))
+    {
+        free(spectrum.eigen_values);
+        matrix_free(spectrum.eigen_vectors);
+        matrix_free(T);
+        signal = BAD_ALLOC;
+        goto error;
+    }
+    for(k = 0; k < model->K; k++) {
+        model->eigen_values.data[k] = spectrum.eigen_values[k].value;
+    }
+    free(spectrum.eigen_values);
+    matrix_free(spectrum.eigen_vectors);
+
+    if((signal = spkmeans_spk_cluster(ctx, T, config, &seeds,
+                                      &model->centroids)))
+        goto error;
+
+    if((signal = model_build_projection(model)))
+        goto error;
+
+    if(NULL != indices) {
+        *indices = seeds;
+    } else {
+        free(seeds);
+    }
+    profile_end(profile);
+    return 0;
+
+error:
+    if(NULL != seeds)
+        free(seeds);
+    model_free(model);
+    profile_end(profile);
+    return signal;
+}
+
+int model_predict(const model_t *model, matrix_t points, size_t *labels) {
+    const backend_t *backend = backend_current();
+    arena_t *arena = arena_thread();
+    arena_mark_t mark;
+    matrix_t weights, embeddings;
+    double *degrees;
+    size_t first, i;
+
+    if(points.cols != model->points.cols)
+        return DIM_MISMATCH;
+    if(NULL == arena)
+        return BAD_ALLOC;
+    mark = arena_mark(arena);
+
+    /* The datapoints are embedded a block at a time: the weights of the block
+     * to the datapoints of the model times the projection of the model (a
+     * single product of the backend) */
+    if(matrix_new_scratch(MODEL_PREDICT_BLOCK, model->points.rows, false,
+                          &weights) ||
+       matrix_new_scratch(MODEL_PREDICT_BLOCK, model->K, false,
+                          &embeddings) ||
+       NULL == (degrees = arena_alloc(
+                    arena, MODEL_PREDICT_BLOCK * sizeof(double), false)))
+    {
+        arena_release(arena, mark);
+        return BAD_ALLOC;
+    }
+
+    for(first = 0; first < points.rows; first += MODEL_PREDICT_BLOCK) {
+        size_t count = points.rows - first;
+
+        count = (count < MODEL_PREDICT_BLOCK) ? count : MODEL_PREDICT_BLOCK;
+        for(i = 0; i < count; i++) {
+            degrees[i] = model_weights(model, matrix_row(points, first + i),
+                                       matrix_row(weights, i));
+        }
+
+        backend->product(matrix_view_rows(weights, 0, count),
+                         model->projection,
+                         matrix_view_rows(embeddings, 0, count));
+
+        for(i = 0; i < count; i++) {
+            labels[first + i] =
+                model_assign(model, matrix_row(embeddings, i), degrees[i]);
+        }
+    }
+
+    arena_release(arena, mark);
+    return 0;
+}
+
+int model_save(const model_t *model, const char *filename) {
+    matrix_t records[MODEL_RECORDS];
+
+    records[0] = model->points;
+    records[1] = model->degrees;
+    records[2] = model->eigen_values;
+    records[3] = model->eigen_vectors;
+    records[4] = model->centroids;
+
+    return loader_save_records(filename, records, MODEL_RECORDS);
+}
+
+int model_load(const char *filename, model_t *model, loader_error_t *error) {
+    matrix_t records[MODEL_RECORDS];
+    int signal;
+
+    model_init(model);
+
+    if((signal = loader_load_records(filename, records, MODEL_RECORDS, error)))
+        return signal;
+
+    model->points = records[0];
+    model->degrees = records[1];
+    model->eigen_values = records[2];
+    model->eigen_vectors = records[3];
+    model->centroids = records[4];
+    model->K = model->eigen_values.rows;
+
+    if(!model_is_consistent(model)) {
+        model_free(model);
+        if(NULL != error) {
+            error->line = 1;
+            error->reason = "inconsistent model";
+        }
+        return BAD_INPUT;
+    }
+
+    if((signal = model_build_projection(model))) {
+        model_free(model);
+        return signal;
+    }
+
+    return 0;
+}
+/******************************************************************************/
+
+/********************************************* STATIC FUNCTION DEFINITIONS
+ * (RELATED TO THE MODEL)
+ * **************************************************************/
+static int model_build_projection(model_t *model) {
+    size_t j, k;
+
+    if(matrix_new(model->points.rows, model->K, &model->projection))
+        return BAD_ALLOC;
+
+    for(j = 0; j < model->projection.rows; j++) {
+        double degree = model->degrees.data[j];
+
+        /* A datapoint without any weight (or an eigen value of the similarity
+         * matrix that's 0) leaves its entries 0 */
+        if(degree <= 0)
+            continue;
+
+        for(k = 0; k < model->K; k++) {
+            double mu = 1 - model->eigen_values.data[k];
+
+            if(fabs(mu) < MODEL_EIGEN_EPSILON)
+                continue;
+            matrix_set(model->projection, j, k,
+                       matrix_get(model->eigen_vectors, j, k) /
+                           (sqrt(degree) * mu));
+        }
+    }
+
+    return 0;
+}
+
+static bool model_is_consistent(const model_t *model) {
+    size_t n = model->points.rows;
+
+    return model->K > 1 && model->K < n && model->degrees.rows == n &&
+           model->degrees.cols == 1 && model->eigen_values.cols == 1 &&
+           model->eigen_vectors.rows == n &&
+           model->eigen_vectors.cols == model->K &&
+           model->centroids.rows == model->K &&
+           model->centroids.cols == model->K;
+}
+
+static double model_weights(const model_t *model, const double *point,
+                            double *weights) {
+    const size_t n = model->points.rows, dim = model->points.cols;
+    double degree = 0;
+    size_t i, j;
+
+    /* The weights of the datapoint to the datapoints of the model, and its
+     * degree: O(n * dim) */
+    for(j = 0; j < n; j++) {
+        const double *other = matrix_row(model->points, j);
+        double sum = 0;
+
+        for(i = 0; i < dim; i++) {
+            double diff = point[i] - other[i];
+            sum += diff * diff;
+        }
+        weights[j] = exp(sqrt(sum) * (-0.5));
+        degree += weights[j];
+    }
+
+    return degree;
+}
+
+static size_t model_assign(const model_t *model, double *embedding,
+                           double degree) {
+    const size_t K = model->K;
+    double norm = 0, min_dist = 0;
+    size_t i, k, closest = 0;
+
+    /* Normalized just like the rows of T (a row of zeros is kept as is) */
+    if(degree > 0) {
+        for(k = 0; k < K; k++) {
+            embedding[k] /= sqrt(degree);
+            norm += embedding[k] * embedding[k];
+        }
+    }
+    if(0 == (norm = sqrt(norm))) {
+        norm = 1;
+    }
+    for(k = 0; k < K; k++) {
+        embedding[k] /= norm;
+    }
+
+    /* The closest centroid: O(K^2) */
+    for(i = 0; i < K; i++) {
+        const double *centroid = matrix_row(model->centroids, i);
+        double dist = 0;
+
+        for(k = 0; k < K; k++) {
+            double diff = embedding[k] - centroid[k];
+            dist += diff * diff;
+        }
+        if(i == 0 || dist < min_dist) {
+            min_dist = dist;
+            closest = i;
+        }
+    }
+
+    return closest;
+}
+/******************************************************************************/
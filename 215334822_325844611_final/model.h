@@ -0,0 +1,86 @@
+#ifndef MODEL_H
+#define MODEL_H
+
+#include "spkmeans.h"
+
+/* The amount of matrices that a saved model is made of (see model_save) */
+#define MODEL_RECORDS 5
+
+/* Below this absolute value, an eigen value of the normalized similarity
+ * matrix (1 minus an eigen value of the normalized graph laplacian) is
+ * treated as 0, and its eigen vector isn't extended to new datapoints */
+#define MODEL_EIGEN_EPSILON 1e-12
+
+/* The amount of datapoints that model_predict embeds at once (by a single
+ * product of the backend) */
+#define MODEL_PREDICT_BLOCK 64
+
+/* Define a structure that will hold a fitted spectral clustering model: the
+ * datapoints it was fitted on (<points>, n x dim), the degree of each of them
+ * (<degrees>, n x 1), the K first eigen values of the normalized graph
+ * laplacian (<eigen_values>, K x 1) along with their eigen vectors
+ * (<eigen_vectors>, n x K, before their rows are normalized), and the final
+ * centroids of the kmeans mechanism (<centroids>, K x K).
+ *
+ * <projection> (n x K) is derived from the rest of the model once it's
+ * fitted or loaded, so that a new datapoint is embedded by a single pass
+ * over the datapoints of the model (see model_predict). */
+typedef struct model_t {
+    size_t K;
+    matrix_t points;
+    matrix_t degrees;
+    matrix_t eigen_values;
+    matrix_t eigen_vectors;
+    matrix_t centroids;
+    matrix_t projection;
+} model_t;
+
+/* A function used to initialize an empty model (all of its matrices hold a
+ * `data` field of NULL) */
+void model_init(model_t *model);
+
+/* A function used to free all of the memory owned by the given model. The
+ * model is empty afterwards. */
+void model_free(model_t *model);
+
+/* A function that fits a model on the datapoints of the context: the same
+ * spectral clustering that spkmeans_spk performs (which replaces the
+ * datapoints of the context with the rows of T), while keeping what's needed
+ * to assign new datapoints later on. If <indices> isn't NULL, the initial
+ * centroids indices are stored in it (a newly allocated array of model->K
+ * elements). Returns the same signals as spkmeans_spk. */
+int model_fit(spkmeans_ctx_t *ctx, kmeans_config_t config, model_t *model,
+              size_t **indices);
+
+/* A function that assigns each row of <points> to a cluster of the model, and
+ * stores its index in <labels> (an array of points.rows elements).
+ *
+ * Every datapoint x is embedded by the Nystrom extension of the eigen vectors
+ * of the model: its weight w_j = exp(-||x - x_j|| / 2) to each datapoint of
+ * the model (as in the weighted adjacency matrix) and its degree
+ * d = sum_j(w_j) give
+ * 		u_k(x) = sum_j(w_j * u_k(j) / sqrt(d * d_j)) / (1 - lambda_k)
+ * for every one of the K eigen vectors u_k (with their eigen values lambda_k
+ * of the normalized graph laplacian). The embedding is normalized just like
+ * the rows of T, and the closest centroid is picked (on ties, the lowest
+ * index). This takes O(n * dim + n * K + K^2) per datapoint, whose O(n * K)
+ * part is a product of the backend (see backend_t) for every
+ * MODEL_PREDICT_BLOCK datapoints.
+ *
+ * Returns 0 on success, DIM_MISMATCH in case the datapoints don't have the
+ * dimension of the model, and BAD_ALLOC in case of an allocation failure. */
+int model_predict(const model_t *model, matrix_t points, size_t *labels);
+
+/* A function that saves the model into the given file, as MODEL_RECORDS
+ * consecutive records of the binary format (see loader_save_records): its
+ * points, degrees, eigen values, eigen vectors and centroids, in this order.
+ * Returns 0 on success, and BAD_OUTPUT in case the file can't be written. */
+int model_save(const model_t *model, const char *filename);
+
+/* A function that loads a model saved by model_save into <model>. Returns 0
+ * on success, BAD_INPUT in case the file can't be read or doesn't hold a
+ * consistent model (described in <error>, unless it's NULL), and BAD_ALLOC in
+ * case of an allocation failure. */
+int model_load(const char *filename, model_t *model, loader_error_t *error);
+
+#endif /* MODEL_H */
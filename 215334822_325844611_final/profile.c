@@ -0,0 +1,264 @@
+#define _POSIX_C_SOURCE 200112L
+#include "profile.h"
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+/********************************************* STATIC FUNCTION DECLARATIONS
+ * (PROFILE)
+ * **************************************************************/
+/* Returns the wall time, in seconds */
+static double profile_now(void);
+
+/* Returns the profile of the calling thread (allocating it on the first
+ * call), or NULL if the profiling is disabled or in case of an allocation
+ * failure */
+static profile_t *profile_of_thread(void);
+
+/* Empties the given profile (of any phase but PROFILE_NO_PHASE, and of its
+ * counters), and makes its run open */
+static void profile_clear(profile_t *profile);
+
+/* Accounts the time since the active phase became active to it */
+static void profile_account(profile_t *profile);
+
+/* Reports the given profile (see profile_init), and keeps it as the last
+ * one */
+static void profile_report(const profile_t *profile);
+
+/* Whether the profiling is enabled, and where the runs are reported into
+ * (NULL for stderr) */
+static bool enabled = false;
+static const char *target = NULL;
+
+/* The profile of the last run that ended, guarded by <last_lock> */
+static profile_t last;
+static bool has_last = false;
+static pthread_mutex_t last_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* The key of the profile of every thread, and its destructor */
+static pthread_key_t profile_key;
+static pthread_once_t profile_key_once = PTHREAD_ONCE_INIT;
+static void profile_make_key(void);
+/******************************************************************************/
+
+/********************************************* GLOBAL FUNCTIONS OF THE PROFILE
+ * **************************************************************/
+void profile_init(void) {
+    const char *value = getenv(PROFILE_ENV);
+
+    enabled = (NULL != value && '\0' != *value && strcmp(value, "0") != 0);
+    target = NULL;
+    if(enabled && strcmp(value, "1") != 0 && strcmp(value, "stderr") != 0) {
+        target = value;
+    }
+}
+
+bool profile_enabled(void) {
+    return enabled;
+}
+
+profile_t *profile_begin(void) {
+    profile_t *profile = profile_of_thread();
+
+    if(NULL == profile)
+        return NULL;
+
+    /* A run that was opened by profile_open (or an outer begun run) goes on */
+    if(0 == profile->depth && !profile->open) {
+        profile_clear(profile);
+    }
+    profile->depth++;
+    return profile;
+}
+
+void profile_end(profile_t *profile) {
+    if(NULL == profile || 0 == profile->depth)
+        return;
+
+    if(0 == --profile->depth) {
+        profile_account(profile);
+        profile_report(profile);
+        profile->open = false;
+    }
+}
+
+profile_t *profile_open(void) {
+    profile_t *profile = profile_of_thread();
+
+    /* Within a begun run, this is a part of it */
+    if(NULL != profile && 0 == profile->depth) {
+        profile_clear(profile);
+    }
+    return profile;
+}
+
+profile_t *profile_thread(void) {
+    profile_t *profile;
+
+    if(!enabled || 0 != pthread_once(&profile_key_once, profile_make_key))
+        return NULL;
+
+    profile = pthread_getspecific(profile_key);
+    return (NULL != profile && profile->open) ? profile : NULL;
+}
+
+size_t profile_phase(profile_t *profile, const char *name) {
+    size_t previous, i;
+
+    if(NULL == profile)
+        return 0;
+
+    previous = profile->phase;
+    for(i = 0; i < profile->n_phases; i++) {
+        if(strcmp(profile->phases[i].name, name) == 0)
+            break;
+    }
+    if(i == profile->n_phases) {
+        if(profile->n_phases < PROFILE_MAX_PHASES) {
+            profile->phases[i].name = name;
+            profile->phases[i].seconds = 0.0;
+            profile->phases[i].bytes = 0;
+            profile->n_phases++;
+        } else {
+            i = PROFILE_MAX_PHASES - 1;
+        }
+    }
+
+    profile_phase_restore(profile, i);
+    return previous;
+}
+
+void profile_phase_restore(profile_t *profile, size_t phase) {
+    if(NULL == profile)
+        return;
+
+    profile_account(profile);
+    profile->phase = phase;
+}
+
+void profile_allocated(size_t bytes) {
+    profile_t *profile;
+
+    if(!enabled || NULL == (profile = profile_thread()))
+        return;
+
+    profile->phases[profile->phase].bytes += bytes;
+}
+
+int profile_last(profile_t *output) {
+    int signal = BAD_INPUT;
+
+    pthread_mutex_lock(&last_lock);
+    if(has_last) {
+        *output = last;
+        signal = 0;
+    }
+    pthread_mutex_unlock(&last_lock);
+
+    return signal;
+}
+
+int profile_write_json(FILE *file, const profile_t *profile) {
+    size_t i, iterations = profile->kmeans_iterations;
+    double total = 0.0;
+
+    fprintf(file, "{\"phases\": {");
+    for(i = 0; i < profile->n_phases; i++) {
+        const profile_phase_t *phase = &profile->phases[i];
+
+        fprintf(file, "%s\"%s\": {\"seconds\": %.6f, \"bytes\": %lu}",
+                (i == 0) ? "" : ", ", phase->name, phase->seconds,
+                (unsigned long)phase->bytes);
+        total += phase->seconds;
+    }
+    fprintf(file,
+            "}, \"seconds\": %.6f, \"jacobi\": {\"rotations\": %lu, "
+            "\"off_norm\": %.6e}, \"kmeans\": {\"iterations\": %lu, "
+            "\"reassigned\": [",
+            total, (unsigned long)profile->jacobi_rotations,
+            profile->jacobi_off_norm, (unsigned long)iterations);
+
+    iterations = (iterations > PROFILE_MAX_ITERATIONS) ? PROFILE_MAX_ITERATIONS
+                                                       : iterations;
+    for(i = 0; i < iterations; i++) {
+        fprintf(file, (i == 0) ? "%lu" : ", %lu",
+                (unsigned long)profile->reassigned[i]);
+    }
+    fprintf(file, "]}}\n");
+
+    return ferror(file) ? BAD_OUTPUT : 0;
+}
+/******************************************************************************/
+
+/********************************************* STATIC FUNCTION DEFINITIONS
+ * (RELATED TO THE PROFILE)
+ * **************************************************************/
+static double profile_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static profile_t *profile_of_thread(void) {
+    profile_t *profile;
+
+    if(!enabled || 0 != pthread_once(&profile_key_once, profile_make_key))
+        return NULL;
+
+    if(NULL == (profile = pthread_getspecific(profile_key))) {
+        if(NULL == (profile = malloc(sizeof(*profile))))
+            return NULL;
+        profile->depth = 0;
+        profile->open = false;
+        if(0 != pthread_setspecific(profile_key, profile)) {
+            free(profile);
+            return NULL;
+        }
+    }
+
+    return profile;
+}
+
+static void profile_clear(profile_t *profile) {
+    profile->phases[0].name = PROFILE_NO_PHASE;
+    profile->phases[0].seconds = 0.0;
+    profile->phases[0].bytes = 0;
+    profile->n_phases = 1;
+    profile->phase = 0;
+    profile->since = profile_now();
+    profile->open = true;
+    profile->jacobi_rotations = 0;
+    profile->jacobi_off_norm = 0.0;
+    profile->kmeans_iterations = 0;
+}
+
+static void profile_account(profile_t *profile) {
+    double now = profile_now();
+
+    profile->phases[profile->phase].seconds += now - profile->since;
+    profile->since = now;
+}
+
+static void profile_report(const profile_t *profile) {
+    FILE *file = stderr;
+
+    pthread_mutex_lock(&last_lock);
+    last = *profile;
+    has_last = true;
+
+    if(NULL != target && NULL == (file = fopen(target, "w"))) {
+        fprintf(stderr, "%s: can't write the profile\n", target);
+    } else {
+        profile_write_json(file, profile);
+        if(stderr != file) {
+            fclose(file);
+        }
+    }
+    pthread_mutex_unlock(&last_lock);
+}
+
+static void profile_make_key(void) {
+    pthread_key_create(&profile_key, free);
+}
+/******************************************************************************/
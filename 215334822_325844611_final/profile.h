@@ -0,0 +1,109 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "matrix.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The environment variable that enables the profiling (see profile_init) */
+#define PROFILE_ENV "SPKMEANS_PROFILE"
+
+/* The most phases a profile keeps accounts of (any further phase is accounted
+ * to the last one) */
+#define PROFILE_MAX_PHASES 16
+
+/* The phase that's active before any phase is begun */
+#define PROFILE_NO_PHASE "other"
+
+/* The most iterations of the kmeans mechanism whose reassignments are kept */
+#define PROFILE_MAX_ITERATIONS 1024
+
+/* Define a structure that will hold the accounts of a phase of a run: the
+ * wall time it was active for, and the bytes that were allocated while it was
+ * active (the matrices and the scratch of the arena) */
+typedef struct profile_phase_t {
+    const char *name;
+    double seconds;
+    size_t bytes;
+} profile_phase_t;
+
+/* Define a structure that will hold the profile of a single run (a goal, an
+ * spk clustering, a model fit or a kmeans clustering, along with the loading
+ * of its datapoints) on a single thread. The time of a run is accounted to
+ * the phase that's active at the time (see profile_phase), hence the phases
+ * add up to the whole run. The counters are those of the last Jacobi
+ * algorithm and the last kmeans mechanism of the run:
+ * 		jacobi_rotations: the rotations that were applied (0 if the eigen
+ * 			solver isn't Jacobi's algorithm, see backend.h).
+ * 		jacobi_off_norm: the Frobenius norm of the off-diagonal elements of
+ * 			the last matrix of the algorithm.
+ * 		kmeans_iterations: the iterations of the run that was kept.
+ * 		reassigned: the amount of datapoints whose set changed on each of
+ * 			those iterations (the first PROFILE_MAX_ITERATIONS of them), which
+ * 			includes all of them on the first iteration of Lloyd's algorithm
+ * 			(and only the sampled ones of mini-batches). */
+typedef struct profile_t {
+    profile_phase_t phases[PROFILE_MAX_PHASES];
+    size_t n_phases;
+    size_t phase; /* the index of the active phase */
+    double since; /* when the active phase became active */
+    size_t depth; /* the nesting of profile_begin */
+    bool open;
+    size_t jacobi_rotations;
+    double jacobi_off_norm;
+    size_t kmeans_iterations;
+    size_t reassigned[PROFILE_MAX_ITERATIONS];
+} profile_t;
+
+/* Enables the profiling according to the PROFILE_ENV environment variable:
+ * unset, empty or "0" leaves it disabled, "1" or "stderr" reports every run
+ * into stderr (as a line of JSON), and any other value is the name of a file
+ * that the JSON of every run is written into (the last run overwrites it).
+ * Either way, the profile of the last run is kept (see profile_last). While
+ * the profiling is disabled, every function of this module costs a single
+ * check. */
+void profile_init(void);
+
+/* Returns whether the profiling is enabled (see profile_init) */
+bool profile_enabled(void);
+
+/* Begins a run on the calling thread, and returns the profile of the thread
+ * (or NULL, if the profiling is disabled or in case of an allocation
+ * failure). A run that's begun while another one is open (e.g. a kmeans
+ * clustering within an spk clustering, or a goal after its datapoints were
+ * loaded, see profile_open) is a part of it. Every profile_begin is matched by
+ * a profile_end (which safely does nothing if <profile> is NULL). The
+ * outermost one reports the run, and keeps its profile as the last one. */
+profile_t *profile_begin(void);
+void profile_end(profile_t *profile);
+
+/* Opens a new run on the calling thread, unless it's within a begun run (the
+ * loading of datapoints opens a run, that the next run of the thread is a
+ * part of). Returns the same as profile_begin. */
+profile_t *profile_open(void);
+
+/* Returns the profile of the open run of the calling thread, or NULL if
+ * there's none (or the profiling is disabled) */
+profile_t *profile_thread(void);
+
+/* Makes <name> (a string that outlives the profile) the active phase of the
+ * profile, and returns the index of the phase that was active (to be
+ * restored by profile_phase_restore). If <profile> is NULL, these functions
+ * safely do nothing. */
+size_t profile_phase(profile_t *profile, const char *name);
+void profile_phase_restore(profile_t *profile, size_t phase);
+
+/* Accounts <bytes> allocated bytes to the active phase of the open run of
+ * the calling thread (if there's any) */
+void profile_allocated(size_t bytes);
+
+/* Stores the profile of the last run that ended (on any thread) in <output>.
+ * Returns 0 on success, and BAD_INPUT in case no run ended yet (or the
+ * profiling is disabled). */
+int profile_last(profile_t *output);
+
+/* Writes the given profile into <file>, as a single line of JSON. Returns 0
+ * on success, and BAD_OUTPUT in case it can't be written. */
+int profile_write_json(FILE *file, const profile_t *profile);
+
+#endif /* PROFILE_H */
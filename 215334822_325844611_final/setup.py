@@ -1,6 +1,16 @@
 from setuptools import setup, find_packages, Extension
+import os
 import sysconfig
 
+# The debug build (SPKMEANS_DEBUG=1) bounds checks every access of the matrix
+# accessors (see matrix.h), as comp.sh does
+debug = os.environ.get('SPKMEANS_DEBUG', '0') not in ('', '0')
+
+# The BLAS build (SPKMEANS_BLAS=1) adds the blas and lapack backends (see
+# backend.h), linked against SPKMEANS_BLAS_LIBS (OpenBLAS by default)
+blas = os.environ.get('SPKMEANS_BLAS', '0') not in ('', '0')
+blas_libs = os.environ.get('SPKMEANS_BLAS_LIBS', '-lopenblas').split()
+
 setup(
     name='spkmeans',
     version='0.0.1',
@@ -11,9 +21,19 @@ setup(
             Extension(
                 'spkmeans',
                 ['spkmeansmodule.c', 'spkmeans.c', 'spkmeans_goals.c',
-                    'matrix.c', 'graph.c', 'eigen.c'],
+                    'matrix.c', 'graph.c', 'eigen.c', 'kmeanspp.c',
+                    'distance.c', 'loader.c', 'writer.c', 'jobs.c',
+                    'model.c', 'arena.c', 'backend.c', 'isa.c', 'profile.c', 'budget.c',
+                    'disk.c'],
                 depends=['spkmeans.h', 'spkmeans_goals.h',
-                         'matrix.h', 'graph.h', 'eigen.h'],
+                         'matrix.h', 'graph.h', 'eigen.h', 'kmeanspp.h',
+                         'distance.h', 'loader.h', 'writer.h', 'jobs.h',
+                         'model.h', 'arena.h', 'backend.h', 'isa.h', 'profile.h', 'budget.h',
+                         'disk.h'],
+                define_macros=([('MATRIX_DEBUG', None)] if debug else []) +
+                              ([('SPKMEANS_BLAS', None)] if blas else []),
+                extra_compile_args=['-g'] if debug else [],
+                extra_link_args=blas_libs if blas else [],
             ),
     ]
 )
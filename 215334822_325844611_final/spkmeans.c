@@ -1,373 +1,1244 @@
-#include "spkmeans.h"
-
-/******************************************************************************/
-
-static int handle_goal(matrix_t *output);
-static void kmeans(size_t *initial_centroids_indices);
-
-static const char *get_filename_ext(const char *filename);
-static void collect_data(const char *filename);
-static void initialize_sets(size_t *initial_centroids_indices);
-static void get_num_and_dim(FILE *file);
-static void parse_datapoint(FILE *file, dpoint_t *dpoint);
-static void assign_to_closest(dpoint_t *dpoint);
-static double sqdist(dpoint_t p1, dpoint_t p2);
-static void add_to_set(set_t *set, dpoint_t dpoint);
-static int update_centroid(set_t *set);
-static void parse_args(int argc, char **argv, char **infile);
-
-/**************************** AUXILIARY FUNCTIONS
- * *********************************/
-void assert_input(bool condition) {
-    if(!condition) {
-        printf("Invalid Input!");
-        free_program();
-        exit(1);
-    }
-}
-
-void assert_other(bool condition) {
-    if(!condition) {
-        printf("An Error Has Occurred");
-        free_program();
-        exit(1);
-    }
-}
-/*****************************************************************************/
-
-/*************************** VARIABLES
- * *****************************************/
-char *goal = "no goal yet";
-size_t K = 0;
-
-size_t dim = 0;
-size_t num_data = 0;
-dpoint_t *datapoints = NULL;
-
-set_t *sets = NULL;
-/*****************************************************************************/
-
-/********************** USED BY THE CPython INTERFACE
- * ******************************/
-int spkmeans_pass_goal_info_and_run(char *infile, matrix_t *output) {
-    collect_data(infile);
-    return handle_goal(output);
-}
-
-void spkmeans_pass_kmeans_info_and_run(size_t *initial_centroids_indices) {
-    kmeans(initial_centroids_indices);
-
-    if(initial_centroids_indices != NULL) {
-        free(initial_centroids_indices);
-    }
-}
-/*****************************************************************************/
-
-/*************************** 2 SEPARATE MAIN MECHANISMS
- * ************************************/
-
-static int handle_goal(matrix_t *output) {
-    int signal;
-
-    /* Build the output corresponding to the wanted goal */
-    if(strcmp(goal, "wam") == 0) {
-        if((signal = build_weighted_adjacency_matrix(output)))
-            goto error;
-    }
-    if(strcmp(goal, "ddg") == 0) {
-        if((signal = build_diagonal_degree_matrix(output)))
-            goto error;
-    }
-    if(strcmp(goal, "lnorm") == 0) {
-        if((signal = build_normalized_laplacian(output)))
-            goto error;
-    }
-    if(strcmp(goal, "jacobi") == 0) {
-        if((signal = build_jacobi_output(output)))
-            goto error;
-    }
-    if(strcmp(goal, "spk") == 0)
-    { /* available only for the CPython interface */
-        if((signal = build_T_of_spectral_kmeans(K, output)))
-            goto error;
-    }
-
-    return 0;
-
-error:
-
-    /* This mechanism is the last endpoint which uses the datapoints, hence we
-     * can free the resources responsively */
-    if(NULL != datapoints) {
-        size_t i;
-        for(i = 0; i < num_data; i++) {
-            free_datapoint(datapoints[i]);
-        }
-        free(datapoints);
-    }
-
-    return signal;
-}
-
-static void kmeans(size_t *initial_centroids_indices) {
-    size_t i, iter, updated_centroids;
-
-    initialize_sets(initial_centroids_indices);
-
-    for(iter = 0; iter < MAX_ITER; iter++) {
-        for(i = 0; i < num_data; i++) {
-            assign_to_closest(&datapoints[i]);
-        }
-
-        updated_centroids = 0;
-        for(i = 0; i < K; i++) {
-            updated_centroids += update_centroid(&sets[i]);
-        }
-
-        if(updated_centroids == 0) { /* Convergence */
-            break;
-        }
-    }
-}
-/*****************************************************************************/
-
-/****************************** MAIN FUNCTION
- * ************************************/
-int main(int argc, char **argv) {
-    char *infile;
-    int signal;
-    matrix_t output;
-
-    /* Parse args and collect data from file */
-    parse_args(argc, argv, &infile);
-    collect_data(infile);
-
-    /* Power the wanted goal */
-    if((signal = handle_goal(&output))) {
-        assert_other(false);
-    }
-
-    /* Print and free */
-    matrix_print_rows(output);
-    matrix_free_safe(output);
-    free_program();
-
-    return 0;
-}
-/*****************************************************************************/
-
-/***************************** KMEANS++ MECHANISM **************************/
-/* Assigns the given datapoint to the closest set that it can find, using the
- * sqdist function. */
-static void assign_to_closest(dpoint_t *dpoint) {
-    size_t i, min_idx = 0;
-    double min_dist = -1.0;
-
-    for(i = 0; i < K; i++) {
-        double dist = sqdist(sets[i].current_centroid, *dpoint);
-
-        if((min_dist < 0.0) || (dist < min_dist)) {
-            min_idx = i;
-            min_dist = dist;
-        }
-    }
-
-    add_to_set(&sets[min_idx], *dpoint);
-    dpoint->current_set = min_idx;
-}
-
-/* Updates the centroid of the given set using its stored `sum` and `count`
- * properties, while also resetting them to 0 for the next iteration. */
-static int update_centroid(set_t *set) {
-    double dist;
-    size_t i;
-
-    for(i = 0; i < dim; i++) {
-        set->sum.data[i] /= (double)set->count;
-    }
-
-    dist = sqrt(sqdist(set->sum, set->current_centroid));
-
-    for(i = 0; i < dim; i++) {
-        set->current_centroid.data[i] = set->sum.data[i];
-        set->sum.data[i] = 0.0;
-    }
-
-    set->count = 0;
-
-    return (dist >= EPSILON) ? 1 /* If this set's centroid changed, return 1 */
-                             : 0;
-}
-
-/* Calculates the squared distance between two given datapoints. */
-static double sqdist(dpoint_t p1, dpoint_t p2) {
-    double dot = 0;
-    size_t i;
-
-    for(i = 0; i < dim; i++) {
-        double temp = p1.data[i] - p2.data[i];
-        dot += temp * temp;
-    }
-
-    return dot;
-}
-
-/* Adds the given datapoint to the provided set, taking into account both the
- * `sum` and `count` properties. */
-static void add_to_set(set_t *set, dpoint_t dpoint) {
-    size_t i;
-
-    set->count += 1;
-    for(i = 0; i < dim; i++) {
-        set->sum.data[i] += dpoint.data[i];
-    }
-}
-
-/* Initializes all of the sets, both allocating memory for the `sum` and
- * `current_centroid` properties and copying the data from the relevant
- * datapoint. */
-static void initialize_sets(size_t *initial_centroids_indices) {
-    size_t i, j;
-
-    sets = calloc(K, sizeof(*sets));
-    assert_other(NULL != sets);
-
-    for(i = 0; i < K; i++) {
-        /* count is already zero. We just need to allocate the centroid and sum
-           datapoints. */
-        init_datapoint(&sets[i].sum);
-        init_datapoint(&sets[i].current_centroid);
-
-        /* Copy initial current_centroid from i-th datapoint */
-        for(j = 0; j < dim; j++) {
-            sets[i].current_centroid.data[j] =
-                datapoints[initial_centroids_indices[i]].data[j];
-        }
-    }
-}
-
-/* Given a file name, it returns the file extension of the file */
-const char *get_filename_ext(const char *filename) {
-    const char *dot = strrchr(filename, '.');
-    if(!dot || dot == filename)
-        return "";
-    return dot + 1;
-}
-
-/* Given an input filename, gathers all of the datapoints stored in that file,
- * while also figuring out what `dim` and `num_data` are supposed to be. */
-static void collect_data(const char *filename) {
-    FILE *input;
-    size_t i;
-
-    /* Asserting that the file extension is either .csv or .txt */
-    const char *file_ext = get_filename_ext(filename);
-    assert_input((strcmp(file_ext, "csv") == 0) ||
-                 (strcmp(file_ext, "txt") == 0));
-
-    /* Extracting the data from the input file */
-    input = fopen(filename, "r");
-
-    assert_input(NULL != input);
-    get_num_and_dim(input);
-
-    datapoints = calloc(num_data, sizeof(*datapoints));
-    assert_other(NULL != datapoints);
-
-    for(i = 0; i < num_data; i++) {
-        parse_datapoint(input, &datapoints[i]);
-    }
-
-    fclose(input);
-}
-
-/* Parses a single datapoint from the given file, assuming that `dim` has
- * already been figured out. */
-static void parse_datapoint(FILE *file, dpoint_t *dpoint) {
-    size_t i;
-
-    init_datapoint(dpoint);
-
-    for(i = 0; i < dim; i++) {
-        /* The following ',' is okay, because even if it isn't found parsing
-           will be successful. */
-        fscanf(file, "%lf,", &dpoint->data[i]);
-    }
-
-    /* Get rid of extra whitespace. */
-    fscanf(file, "\n");
-}
-
-/* Determines `num_data` and `dim` from the current file by inspecting line
- * structure and amount. */
-static void get_num_and_dim(FILE *file) {
-    int c;
-
-    dim = 1; /* Starting with 1 because the amount of numbers is always 1 more
-            than the amount of commas. */
-    num_data = 0;
-
-    rewind(file);
-    while(EOF != (c = fgetc(file))) {
-        if(c == '\n') {
-            num_data++;
-        } else if(c == ',' && num_data == 0) {
-            dim++;
-        }
-    }
-    rewind(file);
-}
-
-/* Parses the arguments given to the program into K, MAX_ITER, input_file and
- * output_file. */
-static void parse_args(int argc, char **argv, char **infile) {
-
-    assert_input(argc == 3);
-
-    goal = argv[1];
-    assert_input(!(strcmp(goal, "wam") && strcmp(goal, "ddg") &&
-                   strcmp(goal, "lnorm") && strcmp(goal, "jacobi")));
-
-    *infile = argv[2];
-}
-
-/* Initializes a single datapoint - allocates enough space for it and sets all
- * the values to zero. */
-void init_datapoint(dpoint_t *dpoint) {
-    assert_other(dim > 0);
-
-    dpoint->data = calloc(dim, sizeof(*dpoint->data));
-    assert_other(NULL != dpoint->data);
-
-    dpoint->current_set = (size_t)-1;
-}
-
-/* Frees the given datapoint. If it's already been freed or not yet allocated,
- * this function safely does nothing. */
-void free_datapoint(dpoint_t dpoint) {
-    if(NULL != dpoint.data) {
-        free(dpoint.data);
-    }
-}
-
-/* Frees all of the memory allocated by the program. If a certain variable
- * hasn't been allocated yet, this function does not attempt to free it. */
-void free_program() {
-    size_t i = 0;
-
-    if(NULL != sets) {
-        for(i = 0; i < K; i++) {
-            free_datapoint(sets[i].current_centroid);
-            free_datapoint(sets[i].sum);
-        }
-        free(sets);
-    }
-
-    if(NULL != datapoints) {
-        for(i = 0; i < num_data; i++) {
-            free_datapoint(datapoints[i]);
-        }
-        free(datapoints);
-    }
-}
-/*****************************************************************************/
+#define _POSIX_C_SOURCE 200112L
+#include "arena.h"
+#include "backend.h"
+#include "disk.h"
+#include "isa.h"
+#include "profile.h"
+#include "spkmeans.h"
+#include "writer.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/******************************************************************************/
+
+/* Define a structure that will hold the state of a single kmeans run. A run
+ * only reads the datapoints of its context, hence several runs may be
+ * performed concurrently. */
+typedef struct kmeans_run_t {
+    const spkmeans_ctx_t *ctx;
+    size_t *initial_centroids_indices; /* NULL means seeding with kmeans++ */
+    matrix_t points; /* the datapoints as a single matrix (shared) */
+    const double *point_norms; /* shared, NULL unless using blocked kernel */
+    matrix_t centered;     /* the datapoints minus <center> (shared), and */
+    const double *center;  /* their mean, for the blocked kernel */
+    matrix_t centroids;    /* packed centroids (centered as well), for the */
+    double *centroid_norms; /* blocked kernel */
+    double *gaps;
+    kmeans_config_t config;
+    set_t *sets;
+    size_t *labels; /* the current set of every datapoint */
+    size_t *reassigned; /* NULL unless profiling (see profile.h) */
+    kmeans_report_t report;
+    int signal;
+} kmeans_run_t;
+
+/* Define a structure that will hold the share of the runs of a single
+ * thread */
+typedef struct kmeans_worker_t {
+    kmeans_run_t *runs;
+    size_t first;
+    size_t stride;
+    size_t n_runs;
+    pthread_t thread;
+    bool started;
+} kmeans_worker_t;
+
+static int handle_goal(spkmeans_ctx_t *ctx, matrix_t *output);
+static int kmeans(spkmeans_ctx_t *ctx, size_t *initial_centroids_indices,
+                  kmeans_config_t config, kmeans_report_t *reports,
+                  size_t *best);
+static int kmeans_run_all(kmeans_run_t *runs, size_t n_runs,
+                          size_t n_threads);
+static void *kmeans_worker(void *arg);
+static int kmeans_run(kmeans_run_t *run);
+static int kmeans_lloyd(kmeans_run_t *run);
+static int kmeans_minibatch(kmeans_run_t *run);
+static int kmeans_inertia(kmeans_run_t *run);
+static int kmeans_center(const spkmeans_ctx_t *ctx, matrix_t *centered,
+                         double **center, double **norms);
+static int kmeans_assign_blocked(kmeans_run_t *run);
+
+static const char *get_filename_ext(const char *filename);
+static int collect_data(spkmeans_ctx_t *ctx, const char *filename);
+static int initialize_sets(const spkmeans_ctx_t *ctx, set_t **output,
+                           size_t *initial_centroids_indices);
+static void free_sets(set_t *run_sets, size_t K);
+static void assign_to_closest(const spkmeans_ctx_t *ctx, set_t *run_sets,
+                              dpoint_t dpoint, size_t *label);
+static size_t find_closest(const spkmeans_ctx_t *ctx, set_t *run_sets,
+                           dpoint_t dpoint, double *min_dist);
+static void move_centroid(set_t *set, dpoint_t dpoint, size_t dim);
+static double sqdist(dpoint_t p1, dpoint_t p2, size_t dim);
+static void add_to_set(set_t *set, dpoint_t dpoint, size_t dim);
+static int update_centroid(set_t *set, size_t dim, double tol);
+#ifndef SPKMEANS_NO_MAIN
+static int parse_args(spkmeans_ctx_t *ctx, int argc, char **argv,
+                      char **infile, char **outfile);
+static int run_spk(spkmeans_ctx_t *ctx, const char *infile,
+                   const char *outfile);
+#endif
+
+/**************************** AUXILIARY FUNCTIONS
+ * *********************************/
+const char *spkmeans_strerror(int signal) {
+    return (signal == BAD_INPUT) ? "Invalid Input!" : "An Error Has Occurred";
+}
+
+void spkmeans_ctx_init(spkmeans_ctx_t *ctx) {
+    ctx->goal = "no goal yet";
+    ctx->K = 0;
+    ctx->dim = 0;
+    ctx->num_data = 0;
+    ctx->datapoints = NULL;
+    ctx->points.data = NULL;
+    ctx->mapping.addr = NULL;
+    ctx->mapping.len = 0;
+    ctx->borrowed_points = false;
+    ctx->sets = NULL;
+    ctx->error.line = 0;
+    ctx->error.reason = NULL;
+    budget_plan_init(&ctx->plan);
+}
+/*****************************************************************************/
+
+/********************** USED BY THE CPython INTERFACE
+ * ******************************/
+int spkmeans_pass_goal_info_and_run(spkmeans_ctx_t *ctx, const char *infile,
+                                    matrix_t *output) {
+    profile_t *profile;
+    int signal;
+
+    /* A new run, that the loading of the datapoints is a part of */
+    profile_open();
+    profile = profile_begin();
+    if(0 == (signal = spkmeans_load(ctx, infile))) {
+        signal = handle_goal(ctx, output);
+    }
+    profile_end(profile);
+
+    return signal;
+}
+
+int spkmeans_pass_goal_points_and_run(spkmeans_ctx_t *ctx, matrix_t points,
+                                      bool borrowed, matrix_t *output) {
+    profile_t *profile;
+    int signal;
+
+    /* A new run, that the loading of the datapoints is a part of */
+    profile_open();
+    profile = profile_begin();
+    if(0 == (signal = spkmeans_load_points(ctx, points, borrowed))) {
+        signal = handle_goal(ctx, output);
+    }
+    profile_end(profile);
+
+    return signal;
+}
+
+int spkmeans_load(spkmeans_ctx_t *ctx, const char *infile) {
+    profile_t *profile = profile_open();
+    size_t phase;
+    int signal;
+
+    /* A context may be reused: drop the datapoints of its previous job */
+    spkmeans_ctx_free(ctx);
+    ctx->error.line = 0;
+    ctx->error.reason = NULL;
+    budget_plan_init(&ctx->plan);
+
+    phase = profile_phase(profile, "parse");
+    signal = collect_data(ctx, infile);
+    profile_phase_restore(profile, phase);
+
+    return signal;
+}
+
+int spkmeans_load_points(spkmeans_ctx_t *ctx, matrix_t points, bool borrowed) {
+    profile_t *profile = profile_open();
+    size_t phase;
+    int signal;
+
+    spkmeans_ctx_free(ctx);
+    ctx->error.line = 0;
+    ctx->error.reason = NULL;
+    budget_plan_init(&ctx->plan);
+
+    phase = profile_phase(profile, "load");
+    signal = spkmeans_use_points(ctx, points, borrowed);
+    profile_phase_restore(profile, phase);
+
+    return signal;
+}
+
+int spkmeans_convert(spkmeans_ctx_t *ctx, const char *infile,
+                     const char *outfile) {
+    int signal;
+
+    if((signal = spkmeans_load(ctx, infile)))
+        return signal;
+    return loader_save(outfile, ctx->points);
+}
+
+int spkmeans_spk(spkmeans_ctx_t *ctx, kmeans_config_t config,
+                 size_t **indices, matrix_t *centroids) {
+    profile_t *profile;
+    matrix_t T;
+    int signal;
+
+    *indices = NULL;
+    centroids->data = NULL;
+
+    /* K must be less than the amount of datapoints, and not 1 (0 means the
+     * eigengap heuristic) */
+    if(ctx->K >= ctx->num_data || ctx->K == 1)
+        return BAD_INPUT;
+    if(budget_plan("spk", ctx->num_data, ctx->dim, &ctx->plan))
+        return BAD_ALLOC;
+
+    profile = profile_begin();
+    if(0 == (signal = build_T_of_spectral_kmeans(ctx, ctx->K, &T))) {
+        signal = spkmeans_spk_cluster(ctx, T, config, indices, centroids);
+    }
+    profile_end(profile);
+
+    return signal;
+}
+
+int spkmeans_spk_cluster(spkmeans_ctx_t *ctx, matrix_t T,
+                         kmeans_config_t config, size_t **indices,
+                         matrix_t *centroids) {
+    size_t i;
+    int signal;
+
+    *indices = NULL;
+    centroids->data = NULL;
+
+    /* The eigengap heuristic may find a single cluster, which can't be
+     * clustered any further */
+    if(T.cols == 1) {
+        matrix_free(T);
+        return DIM_MISMATCH;
+    }
+
+    /* The rows of T become the datapoints of the kmeans mechanism (in place,
+     * without copying them) */
+    spkmeans_ctx_free(ctx);
+    ctx->K = T.cols;
+    if((signal = spkmeans_use_points(ctx, T, false)))
+        return signal;
+
+    /* Seed the initial centroids with kmeans++, and cluster */
+    if(NULL == (*indices = calloc(ctx->K, sizeof(**indices))))
+        return BAD_ALLOC;
+    if((signal = kmeanspp_init(ctx->points, ctx->K, config.seed, *indices)))
+        goto error;
+    if((signal = spkmeans_pass_kmeans_info_and_run(ctx, *indices, config,
+                                                   NULL, NULL)))
+        goto error;
+
+    if((signal = matrix_new(ctx->K, ctx->dim, centroids)))
+        goto error;
+    for(i = 0; i < ctx->K; i++) {
+        memcpy(matrix_row(*centroids, i),
+               ctx->sets[i].current_centroid.data, ctx->dim * sizeof(double));
+    }
+
+    return 0;
+
+error:
+    free(*indices);
+    *indices = NULL;
+    return signal;
+}
+
+int spkmeans_write_output(matrix_t output, const char *outfile) {
+    const char *ext;
+    int fd, signal;
+
+    if(NULL == outfile)
+        return matrix_print_rows(output);
+
+    ext = strrchr(outfile, '.');
+    if(NULL != ext && (strcmp(ext, ".bin") == 0 || strcmp(ext, ".npy") == 0))
+        return loader_save(outfile, output);
+
+    if(NULL == ext || (strcmp(ext, ".csv") != 0 && strcmp(ext, ".txt") != 0))
+        return BAD_INPUT;
+
+    if(0 > (fd = open(outfile, O_WRONLY | O_CREAT | O_TRUNC, 0666)))
+        return BAD_OUTPUT;
+
+    signal = writer_matrix_rows(output, fd);
+    if(0 != close(fd) && 0 == signal) {
+        signal = BAD_OUTPUT;
+    }
+    return signal;
+}
+
+int spkmeans_pass_kmeans_info_and_run(spkmeans_ctx_t *ctx,
+                                      size_t *initial_centroids_indices,
+                                      kmeans_config_t config,
+                                      kmeans_report_t *reports, size_t *best) {
+    profile_t *profile;
+    size_t i;
+    int signal;
+
+    /* The initial centroids must be actual datapoints */
+    if(ctx->K == 0 || ctx->K > ctx->num_data || ctx->dim == 0)
+        return BAD_INPUT;
+    for(i = 0; i < ctx->K; i++) {
+        if(initial_centroids_indices[i] >= ctx->num_data)
+            return BAD_INPUT;
+    }
+
+    profile = profile_begin();
+    signal = kmeans(ctx, initial_centroids_indices, config, reports, best);
+    profile_end(profile);
+
+    return signal;
+}
+/*****************************************************************************/
+
+/*************************** 2 SEPARATE MAIN MECHANISMS
+ * ************************************/
+
+static int handle_goal(spkmeans_ctx_t *ctx, matrix_t *output) {
+    const char *goal = ctx->goal;
+    int signal = BAD_INPUT;
+
+    /* Plan the goal within the memory budget before anything is allocated */
+    if(budget_plan(goal, ctx->num_data, ctx->dim, &ctx->plan))
+        return BAD_ALLOC;
+
+    /* Build the output corresponding to the wanted goal */
+    if(strcmp(goal, "wam") == 0)
+        signal = build_weighted_adjacency_matrix(ctx, output);
+    else if(strcmp(goal, "ddg") == 0)
+        signal = build_diagonal_degree_matrix(ctx, output);
+    else if(strcmp(goal, "lnorm") == 0)
+        signal = build_normalized_laplacian(ctx, output);
+    else if(strcmp(goal, "jacobi") == 0)
+        signal = build_jacobi_output(ctx, output);
+    else if(strcmp(goal, "spk") == 0) { /* only for the CPython interface */
+        /* K must be less than the amount of datapoints, and not 1 (0 means
+         * the eigengap heuristic) */
+        if(ctx->K >= ctx->num_data || ctx->K == 1)
+            return BAD_INPUT;
+        signal = build_T_of_spectral_kmeans(ctx, ctx->K, output);
+    }
+
+    /* The output is handed over to the caller (who may free it on another
+     * thread, e.g. the output of a job of the pool) */
+    if(0 == signal) {
+        matrix_disown(*output);
+    }
+    return signal;
+}
+
+static int kmeans(spkmeans_ctx_t *ctx, size_t *initial_centroids_indices,
+                  kmeans_config_t config, kmeans_report_t *reports,
+                  size_t *best) {
+    kmeans_run_t *runs;
+    matrix_t points, centered;
+    profile_t *profile = profile_thread();
+    double *point_norms = NULL, *center = NULL;
+    bool blocked = (ctx->K >= KMEANS_BLOCKED_MIN_K), own_points = false;
+    size_t i, best_run = 0, phase, profiled;
+    int signal = 0;
+
+    points.data = NULL;
+    centered.data = NULL;
+    if(config.n_init == 0) {
+        config.n_init = 1;
+    }
+
+    runs = calloc(config.n_init, sizeof(*runs));
+    if(NULL == runs)
+        return BAD_ALLOC;
+    phase = profile_phase(profile, "kmeans");
+
+    /* While profiling, every run counts the datapoints it reassigns on each
+     * of its (first PROFILE_MAX_ITERATIONS) iterations */
+    profiled = (config.max_iter < PROFILE_MAX_ITERATIONS)
+                   ? config.max_iter
+                   : PROFILE_MAX_ITERATIONS;
+    for(i = 0; NULL != profile && i < config.n_init && 0 == signal; i++) {
+        runs[i].reassigned = calloc(profiled + 1, sizeof(size_t));
+        if(NULL == runs[i].reassigned) {
+            signal = BAD_ALLOC;
+        }
+    }
+
+    /* Seeding the extra runs with kmeans++ needs the datapoints as a single
+     * contiguous matrix. It's only read by the runs, hence shared. */
+    if(0 != signal || config.n_init == 1) {
+        /* Nothing else is needed */
+    } else if(NULL != ctx->points.data) {
+        points = ctx->points;
+    } else {
+        signal = matrix_build_from_dpoints(ctx->datapoints, ctx->num_data,
+                                           ctx->dim, &points);
+        own_points = true;
+    }
+
+    /* So does the blocked distance kernel, centered around the mean of the
+     * datapoints (see distance_margin), along with the norms of its rows */
+    if(0 == signal && blocked) {
+        signal = kmeans_center(ctx, &centered, &center, &point_norms);
+    }
+
+    if(0 == signal) {
+        for(i = 0; i < config.n_init; i++) {
+            runs[i].ctx = ctx;
+            runs[i].initial_centroids_indices =
+                (i == 0) ? initial_centroids_indices : NULL;
+            runs[i].points = points;
+            runs[i].point_norms = point_norms;
+            runs[i].centered = centered;
+            runs[i].center = center;
+            runs[i].config = config;
+            runs[i].config.seed = config.seed + i;
+        }
+
+        signal = kmeans_run_all(runs, config.n_init, config.n_threads);
+    }
+
+    if(0 == signal) {
+        /* Keep the run with the lowest inertia (the first one on ties) */
+        for(i = 0; i < config.n_init; i++) {
+            if(runs[i].report.inertia < runs[best_run].report.inertia) {
+                best_run = i;
+            }
+            if(NULL != reports) {
+                reports[i] = runs[i].report;
+            }
+        }
+
+        free_sets(ctx->sets, ctx->K);
+        ctx->sets = runs[best_run].sets;
+        runs[best_run].sets = NULL;
+        if(NULL != best) {
+            *best = best_run;
+        }
+
+        if(NULL != profile) {
+            profile->kmeans_iterations = runs[best_run].report.iterations;
+            memcpy(profile->reassigned, runs[best_run].reassigned,
+                   profiled * sizeof(size_t));
+        }
+    }
+
+    /* Free-ing the rest of the runs */
+    for(i = 0; i < config.n_init; i++) {
+        free_sets(runs[i].sets, ctx->K);
+        if(NULL != runs[i].labels) {
+            free(runs[i].labels);
+        }
+        if(NULL != runs[i].reassigned) {
+            free(runs[i].reassigned);
+        }
+        matrix_free_safe(runs[i].centroids);
+        if(NULL != runs[i].centroid_norms) {
+            free(runs[i].centroid_norms);
+        }
+        if(NULL != runs[i].gaps) {
+            free(runs[i].gaps);
+        }
+    }
+    free(runs);
+    if(own_points) {
+        matrix_free_safe(points);
+    }
+    matrix_free_safe(centered);
+    if(NULL != center) {
+        free(center);
+    }
+    if(NULL != point_norms) {
+        free(point_norms);
+    }
+    profile_phase_restore(profile, phase);
+
+    return signal;
+}
+
+/* Performs all of the given runs, spreading them over up to <n_threads>
+ * threads (the calling thread included). Returns the first error signal of
+ * the runs, if there's any. */
+static int kmeans_run_all(kmeans_run_t *runs, size_t n_runs,
+                          size_t n_threads) {
+    kmeans_worker_t *workers = NULL;
+    size_t i;
+    int signal = 0;
+
+    if(n_threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = (cpus > 0) ? (size_t)cpus : 1;
+    }
+    if(n_threads > n_runs) {
+        n_threads = n_runs;
+    }
+
+    workers = calloc(n_threads, sizeof(*workers));
+    if(NULL == workers)
+        return BAD_ALLOC;
+
+    /* Worker i handles the runs i, i + n_threads, i + 2 * n_threads, ... */
+    for(i = 0; i < n_threads; i++) {
+        workers[i].runs = runs;
+        workers[i].first = i;
+        workers[i].stride = n_threads;
+        workers[i].n_runs = n_runs;
+    }
+
+    /* If a thread can't be created, its runs are performed by the calling
+     * thread instead */
+    for(i = 1; i < n_threads; i++) {
+        workers[i].started = (0 == pthread_create(&workers[i].thread, NULL,
+                                                  kmeans_worker, &workers[i]));
+    }
+    kmeans_worker(&workers[0]);
+    for(i = 1; i < n_threads; i++) {
+        if(workers[i].started) {
+            pthread_join(workers[i].thread, NULL);
+        } else {
+            kmeans_worker(&workers[i]);
+        }
+    }
+
+    for(i = 0; i < n_runs && 0 == signal; i++) {
+        signal = runs[i].signal;
+    }
+
+    free(workers);
+    return signal;
+}
+
+/* The entry point of a kmeans thread */
+static void *kmeans_worker(void *arg) {
+    kmeans_worker_t *worker = (kmeans_worker_t *)arg;
+    size_t i;
+
+    for(i = worker->first; i < worker->n_runs; i += worker->stride) {
+        worker->runs[i].signal = kmeans_run(&worker->runs[i]);
+    }
+
+    return NULL;
+}
+
+/* Performs a single kmeans run: seeds it (if it has no initial centroids),
+ * iterates until convergence, and reports its inertia. Doesn't exit on
+ * errors, since it may run on a separate thread - returns a signal instead. */
+static int kmeans_run(kmeans_run_t *run) {
+    const spkmeans_ctx_t *ctx = run->ctx;
+    size_t *indices = run->initial_centroids_indices, K = ctx->K;
+    int signal;
+
+    run->report.seed = run->config.seed;
+
+    run->labels = calloc(ctx->num_data, sizeof(*run->labels));
+    if(NULL == run->labels)
+        return BAD_ALLOC;
+
+    /* While profiling, no datapoint is in any set at first (hence the first
+     * assignment of every datapoint counts as a reassignment) */
+    if(NULL != run->reassigned) {
+        memset(run->labels, 0xff, ctx->num_data * sizeof(*run->labels));
+    }
+
+    /* The blocked distance kernel works on a packed copy of the centroids */
+    if(NULL != run->point_norms) {
+        if(matrix_new(K, ctx->dim, &run->centroids))
+            return BAD_ALLOC;
+        if(NULL == (run->centroid_norms = malloc(K * sizeof(double))))
+            return BAD_ALLOC;
+        if(NULL == (run->gaps = malloc(ctx->num_data * sizeof(double))))
+            return BAD_ALLOC;
+    }
+
+    /* Runs without given initial centroids are seeded by kmeans++ */
+    if(NULL == indices) {
+        if(NULL == (indices = calloc(K, sizeof(*indices))))
+            return BAD_ALLOC;
+
+        if(0 == (signal = kmeanspp_init(run->points, K, run->config.seed,
+                                        indices))) {
+            signal = initialize_sets(ctx, &run->sets, indices);
+        }
+        free(indices);
+    } else {
+        signal = initialize_sets(ctx, &run->sets, indices);
+    }
+
+    if(signal)
+        return signal;
+
+    if(run->config.batch_size == 0 ||
+       run->config.batch_size >= ctx->num_data) {
+        signal = kmeans_lloyd(run);
+    } else {
+        signal = kmeans_minibatch(run);
+    }
+
+    if(signal)
+        return signal;
+
+    return kmeans_inertia(run);
+}
+
+/* Full passes over all of the datapoints */
+static int kmeans_lloyd(kmeans_run_t *run) {
+    const spkmeans_ctx_t *ctx = run->ctx;
+    size_t i, iter, updated_centroids, *previous = NULL;
+    int signal;
+
+    /* While profiling, the labels of the previous iteration are kept for
+     * counting the reassignments */
+    if(NULL != run->reassigned &&
+       NULL == (previous = malloc(ctx->num_data * sizeof(*previous))))
+        return BAD_ALLOC;
+
+    for(iter = 0; iter < run->config.max_iter; iter++) {
+        if(NULL != previous) {
+            memcpy(previous, run->labels, ctx->num_data * sizeof(*previous));
+        }
+
+        if(NULL != run->point_norms) {
+            if((signal = kmeans_assign_blocked(run))) {
+                if(NULL != previous)
+                    free(previous);
+                return signal;
+            }
+        } else {
+            for(i = 0; i < ctx->num_data; i++) {
+                assign_to_closest(ctx, run->sets, ctx->datapoints[i],
+                                  &run->labels[i]);
+            }
+        }
+
+        if(NULL != previous && iter < PROFILE_MAX_ITERATIONS) {
+            for(i = 0; i < ctx->num_data; i++) {
+                run->reassigned[iter] += (previous[i] != run->labels[i]);
+            }
+        }
+
+        updated_centroids = 0;
+        for(i = 0; i < ctx->K; i++) {
+            updated_centroids +=
+                update_centroid(&run->sets[i], ctx->dim, run->config.tol);
+        }
+
+        if(updated_centroids == 0) { /* Convergence */
+            iter++;
+            break;
+        }
+    }
+
+    run->report.iterations = iter;
+    if(NULL != previous) {
+        free(previous);
+    }
+    return 0;
+}
+
+/* Mini-batch iterations (Sculley, "Web-Scale K-Means Clustering"): every
+ * iteration samples <batch_size> datapoints, assigns them to their closest
+ * centroids, and then moves each centroid towards its sampled datapoints with
+ * a learning rate of 1 / (amount of datapoints it has been moved towards so
+ * far). Only the sampled datapoints are touched on each iteration. */
+static int kmeans_minibatch(kmeans_run_t *run) {
+    const spkmeans_ctx_t *ctx = run->ctx;
+    set_t *run_sets = run->sets;
+    size_t i, iter, *batch, K = ctx->K, dim = ctx->dim;
+    rng_t rng;
+
+    batch = calloc(run->config.batch_size, sizeof(*batch));
+    if(NULL == batch)
+        return BAD_ALLOC;
+
+    rng_seed(&rng, run->config.seed);
+
+    for(iter = 0; iter < run->config.max_iter; iter++) {
+        double max_shift = 0.0;
+
+        /* Sample the batch and cache the closest centroid of each datapoint
+         * before any of the centroids move */
+        for(i = 0; i < run->config.batch_size; i++) {
+            size_t label;
+
+            batch[i] = rng_next_interval(&rng, ctx->num_data - 1);
+            label =
+                find_closest(ctx, run_sets, ctx->datapoints[batch[i]], NULL);
+            if(NULL != run->reassigned && iter < PROFILE_MAX_ITERATIONS) {
+                run->reassigned[iter] += (label != run->labels[batch[i]]);
+            }
+            run->labels[batch[i]] = label;
+        }
+
+        /* Move the centroids. The `sum` of each set holds its centroid from
+         * the beginning of the iteration, for the convergence criterion */
+        for(i = 0; i < K; i++) {
+            memcpy(run_sets[i].sum.data, run_sets[i].current_centroid.data,
+                   dim * sizeof(double));
+        }
+        for(i = 0; i < run->config.batch_size; i++) {
+            move_centroid(&run_sets[run->labels[batch[i]]],
+                          ctx->datapoints[batch[i]], dim);
+        }
+        for(i = 0; i < K; i++) {
+            double shift = sqrt(
+                sqdist(run_sets[i].sum, run_sets[i].current_centroid, dim));
+            max_shift = (shift > max_shift) ? shift : max_shift;
+        }
+
+        if(max_shift < run->config.tol) { /* Convergence */
+            iter++;
+            break;
+        }
+    }
+
+    run->report.iterations = iter;
+
+    /* Leave the sets as the Lloyd mechanism does: zeroed sums */
+    for(i = 0; i < K; i++) {
+        memset(run_sets[i].sum.data, 0, dim * sizeof(double));
+        run_sets[i].count = 0;
+    }
+
+    free(batch);
+    return 0;
+}
+
+/* Centers the datapoints of the given context around their mean, into
+ * <centered> (a new matrix), and stores the mean in <center> and the norms of
+ * the rows of <centered> in <norms> (new arrays). Returns BAD_ALLOC in case of
+ * an allocation failure (whatever was allocated is left to the caller). */
+static int kmeans_center(const spkmeans_ctx_t *ctx, matrix_t *centered,
+                         double **center, double **norms) {
+    size_t i, k, dim = ctx->dim;
+
+    if(NULL == (*center = calloc(dim, sizeof(double))) ||
+       NULL == (*norms = malloc(ctx->num_data * sizeof(double))) ||
+       matrix_new_uninit(ctx->num_data, dim, centered))
+        return BAD_ALLOC;
+
+    for(i = 0; i < ctx->num_data; i++) {
+        isa_kernels()->add(*center, ctx->datapoints[i].data, dim);
+    }
+    for(k = 0; k < dim; k++) {
+        (*center)[k] /= (double)ctx->num_data;
+    }
+
+    for(i = 0; i < ctx->num_data; i++) {
+        double *row = matrix_row(*centered, i);
+
+        for(k = 0; k < dim; k++) {
+            row[k] = ctx->datapoints[i].data[k] - (*center)[k];
+        }
+    }
+    distance_row_norms(*centered, *norms);
+
+    return 0;
+}
+
+/* Assigns all of the datapoints to their closest sets at once, using the
+ * blocked distance kernel over a packed copy of the current centroids. This
+ * replaces K separate sqdist calls per datapoint when K is large. The
+ * datapoints whose closest centroid isn't certain (see distance_margin) are
+ * assigned by sqdist, so that the assignment is exactly the one of sqdist. */
+static int kmeans_assign_blocked(kmeans_run_t *run) {
+    const spkmeans_ctx_t *ctx = run->ctx;
+    double max_norm = 0.0;
+    size_t i, k, dim = ctx->dim;
+    int signal;
+
+    for(i = 0; i < ctx->K; i++) {
+        double *row = matrix_row(run->centroids, i);
+
+        for(k = 0; k < dim; k++) {
+            row[k] = run->sets[i].current_centroid.data[k] - run->center[k];
+        }
+    }
+    distance_row_norms(run->centroids, run->centroid_norms);
+    for(i = 0; i < ctx->K; i++) {
+        max_norm = (run->centroid_norms[i] > max_norm) ? run->centroid_norms[i]
+                                                       : max_norm;
+    }
+
+    if((signal = distance_argmin(run->centered, run->point_norms,
+                                 run->centroids, run->centroid_norms,
+                                 run->labels, NULL, run->gaps)))
+        return signal;
+
+    for(i = 0; i < ctx->num_data; i++) {
+        if(run->gaps[i] <=
+           distance_margin(dim, run->point_norms[i], max_norm)) {
+            run->labels[i] =
+                find_closest(ctx, run->sets, ctx->datapoints[i], NULL);
+        }
+        add_to_set(&run->sets[run->labels[i]], ctx->datapoints[i], dim);
+    }
+
+    return 0;
+}
+
+/* Stores the sum of the squared distances of all of the datapoints from
+ * their closest centroids in the report of the run */
+static int kmeans_inertia(kmeans_run_t *run) {
+    const spkmeans_ctx_t *ctx = run->ctx;
+    double inertia = 0.0;
+    size_t i, dim = ctx->dim;
+    int signal;
+
+    if(NULL != run->point_norms) {
+        /* Find the closest centroids with the blocked kernel, but measure the
+         * distances directly (the norm expansion loses precision) */
+        if((signal = kmeans_assign_blocked(run)))
+            return signal;
+
+        for(i = 0; i < ctx->num_data; i++) {
+            inertia += sqdist(ctx->datapoints[i],
+                              run->sets[run->labels[i]].current_centroid, dim);
+        }
+
+        for(i = 0; i < ctx->K; i++) { /* undo the sums of kmeans_assign_blocked */
+            memset(run->sets[i].sum.data, 0, dim * sizeof(double));
+            run->sets[i].count = 0;
+        }
+
+        run->report.inertia = inertia;
+        return 0;
+    }
+
+    for(i = 0; i < ctx->num_data; i++) {
+        double dist;
+        find_closest(ctx, run->sets, ctx->datapoints[i], &dist);
+        inertia += dist;
+    }
+
+    run->report.inertia = inertia;
+    return 0;
+}
+
+kmeans_config_t kmeans_default_config(void) {
+    kmeans_config_t config;
+
+    config.batch_size = 0;
+    config.max_iter = MAX_ITER;
+    config.tol = EPSILON;
+    config.seed = KMEANSPP_DEFAULT_SEED;
+    config.n_init = 1;
+    config.n_threads = 0;
+
+    return config;
+}
+/*****************************************************************************/
+
+/****************************** MAIN FUNCTION
+ * ************************************/
+/* Programs that link this file into a main of their own (e.g. the benchmark,
+ * see comp.sh) are built with SPKMEANS_NO_MAIN defined */
+#ifndef SPKMEANS_NO_MAIN
+int main(int argc, char **argv) {
+    spkmeans_ctx_t ctx;
+    char *infile = NULL, *outfile = NULL;
+    int signal;
+    matrix_t output;
+
+    spkmeans_ctx_init(&ctx);
+
+    /* The linear algebra backend is named by the environment (see
+     * backend_init) */
+    if((signal = backend_init())) {
+        fprintf(stderr, "%s: unknown backend\n", getenv(BACKEND_ENV));
+        goto error;
+    }
+
+    /* So are the instruction set of the kernels, unless it's detected (see
+     * isa_init) */
+    if((signal = isa_init())) {
+        fprintf(stderr,
+                "%s: unknown or unsupported instruction set (up to %s)\n",
+                getenv(ISA_ENV), isa_name(isa_detect()));
+        goto error;
+    }
+
+    /* And so is the profiling of the runs (see profile_init), the memory
+     * budget of the goals (see budget_init) and their scratch directory (see
+     * disk_init) */
+    profile_init();
+    if((signal = budget_init())) {
+        fprintf(stderr, "%s: malformed memory budget\n", getenv(BUDGET_ENV));
+        goto error;
+    }
+    if((signal = disk_init())) {
+        fprintf(stderr, "%s: not a writable scratch directory\n",
+                getenv(DISK_ENV));
+        goto error;
+    }
+
+    /* Parse args, and either convert the input file into a binary dataset or
+     * collect data from it and power the wanted goal */
+    if((signal = parse_args(&ctx, argc, argv, &infile, &outfile)))
+        goto error;
+
+    if(strcmp(ctx.goal, "convert") == 0) {
+        if((signal = spkmeans_convert(&ctx, infile, outfile)))
+            goto error;
+
+        spkmeans_ctx_free(&ctx);
+        arena_thread_free();
+        return 0;
+    }
+
+    if(strcmp(ctx.goal, "spk") == 0) {
+        if((signal = run_spk(&ctx, infile, outfile)))
+            goto error;
+
+        spkmeans_ctx_free(&ctx);
+        arena_thread_free();
+        return 0;
+    }
+
+    if((signal = spkmeans_pass_goal_info_and_run(&ctx, infile, &output)))
+        goto error;
+
+    /* Print (or write into the output file) and free */
+    signal = spkmeans_write_output(output, outfile);
+    matrix_free_safe(output);
+    if(signal)
+        goto error;
+    spkmeans_ctx_free(&ctx);
+    arena_thread_free();
+
+    return 0;
+
+error:
+    printf("%s", spkmeans_strerror(signal));
+    if(0 != ctx.error.line) {
+        fprintf(stderr, "%s:%lu: %s\n", infile, ctx.error.line,
+                ctx.error.reason);
+    }
+    if(budget_exceeded(&ctx.plan)) {
+        budget_report(stderr, &ctx.plan);
+    }
+    spkmeans_ctx_free(&ctx);
+    arena_thread_free();
+    return 1;
+}
+#endif
+/*****************************************************************************/
+
+/***************************** KMEANS++ MECHANISM **************************/
+/* Assigns the given datapoint to the closest set that it can find (out of
+ * <run_sets>), using the sqdist function. The index of the set is stored in
+ * <label>. */
+static void assign_to_closest(const spkmeans_ctx_t *ctx, set_t *run_sets,
+                              dpoint_t dpoint, size_t *label) {
+    size_t min_idx = find_closest(ctx, run_sets, dpoint, NULL);
+
+    add_to_set(&run_sets[min_idx], dpoint, ctx->dim);
+    *label = min_idx;
+}
+
+/* Returns the index of the set (out of <run_sets>) whose centroid is the
+ * closest to the given datapoint. If <min_dist> isn't NULL, the squared
+ * distance from that centroid is stored in it. */
+static size_t find_closest(const spkmeans_ctx_t *ctx, set_t *run_sets,
+                           dpoint_t dpoint, double *min_dist) {
+    size_t i, min_idx = 0;
+    double best_dist = -1.0;
+
+    for(i = 0; i < ctx->K; i++) {
+        double dist = sqdist(run_sets[i].current_centroid, dpoint, ctx->dim);
+
+        if((best_dist < 0.0) || (dist < best_dist)) {
+            min_idx = i;
+            best_dist = dist;
+        }
+    }
+
+    if(NULL != min_dist) {
+        *min_dist = best_dist;
+    }
+
+    return min_idx;
+}
+
+/* Moves the centroid of the given set towards the given datapoint, with a
+ * learning rate of 1 / count (count includes the given datapoint). This keeps
+ * the centroid equal to the mean of all of the datapoints it was moved
+ * towards. */
+static void move_centroid(set_t *set, dpoint_t dpoint, size_t dim) {
+    double eta;
+
+    set->count += 1;
+    eta = 1.0 / (double)set->count;
+
+    isa_kernels()->move(set->current_centroid.data, dpoint.data, eta, dim);
+}
+
+/* Updates the centroid of the given set using its stored `sum` and `count`
+ * properties, while also resetting them to 0 for the next iteration. */
+static int update_centroid(set_t *set, size_t dim, double tol) {
+    double dist;
+    size_t i;
+
+    /* An empty set keeps its centroid (more likely to happen with a large K) */
+    if(set->count == 0)
+        return 0;
+
+    for(i = 0; i < dim; i++) {
+        set->sum.data[i] /= (double)set->count;
+    }
+
+    dist = sqrt(sqdist(set->sum, set->current_centroid, dim));
+
+    for(i = 0; i < dim; i++) {
+        set->current_centroid.data[i] = set->sum.data[i];
+        set->sum.data[i] = 0.0;
+    }
+
+    set->count = 0;
+
+    return (dist >= tol) ? 1 /* If this set's centroid changed, return 1 */
+                             : 0;
+}
+
+/* Calculates the squared distance between two given datapoints. */
+static double sqdist(dpoint_t p1, dpoint_t p2, size_t dim) {
+    double dot = 0;
+    size_t i;
+
+    for(i = 0; i < dim; i++) {
+        double temp = p1.data[i] - p2.data[i];
+        dot += temp * temp;
+    }
+
+    return dot;
+}
+
+/* Adds the given datapoint to the provided set, taking into account both the
+ * `sum` and `count` properties. */
+static void add_to_set(set_t *set, dpoint_t dpoint, size_t dim) {
+    set->count += 1;
+    isa_kernels()->add(set->sum.data, dpoint.data, dim);
+}
+
+/* Initializes all of the sets of a run, both allocating memory for the `sum`
+ * and `current_centroid` properties and copying the data from the relevant
+ * datapoint. The sets are stored in <output>, which must be freed with
+ * free_sets (even on failure). Returns BAD_ALLOC on allocation failure. */
+static int initialize_sets(const spkmeans_ctx_t *ctx, set_t **output,
+                           size_t *initial_centroids_indices) {
+    set_t *new_sets;
+    size_t i, j, dim = ctx->dim;
+
+    *output = new_sets = calloc(ctx->K, sizeof(*new_sets));
+    if(NULL == new_sets)
+        return BAD_ALLOC;
+
+    for(i = 0; i < ctx->K; i++) {
+        /* count is already zero. We just need to allocate the centroid and sum
+           datapoints. */
+        new_sets[i].sum.data = calloc(dim, sizeof(double));
+        new_sets[i].current_centroid.data = calloc(dim, sizeof(double));
+        if(NULL == new_sets[i].sum.data ||
+           NULL == new_sets[i].current_centroid.data)
+            return BAD_ALLOC;
+
+        /* Copy initial current_centroid from i-th datapoint */
+        for(j = 0; j < dim; j++) {
+            new_sets[i].current_centroid.data[j] =
+                ctx->datapoints[initial_centroids_indices[i]].data[j];
+        }
+    }
+
+    return 0;
+}
+
+/* Frees the given <K> sets. If they haven't been allocated yet (NULL), this
+ * function safely does nothing. */
+static void free_sets(set_t *run_sets, size_t K) {
+    size_t i;
+
+    if(NULL == run_sets)
+        return;
+
+    for(i = 0; i < K; i++) {
+        free_datapoint(run_sets[i].current_centroid);
+        free_datapoint(run_sets[i].sum);
+    }
+    free(run_sets);
+}
+
+/* Given a file name, it returns the file extension of the file */
+static const char *get_filename_ext(const char *filename) {
+    const char *dot = strrchr(filename, '.');
+    if(!dot || dot == filename)
+        return "";
+    return dot + 1;
+}
+
+/* Given an input filename, gathers all of the datapoints stored in that file
+ * into the context (as views of a single contiguous matrix), while also
+ * figuring out what `dim` and `num_data` are supposed to be. Returns
+ * BAD_INPUT in case the file can't be used, and BAD_ALLOC in case of an
+ * allocation failure. */
+static int collect_data(spkmeans_ctx_t *ctx, const char *filename) {
+    matrix_t points;
+    int signal;
+
+    /* Asserting that the file extension is one of .csv, .txt (text), .bin or
+     * .npy (binary), unless the text is read from stdin ("-") */
+    const char *file_ext = get_filename_ext(filename);
+    if((strcmp(filename, "-") != 0) && (strcmp(file_ext, "csv") != 0) &&
+       (strcmp(file_ext, "txt") != 0) && (strcmp(file_ext, "bin") != 0) &&
+       (strcmp(file_ext, "npy") != 0))
+        return BAD_INPUT;
+
+    /* Extracting the data from the input file (binary datasets are used in
+     * place) */
+    if((signal = loader_load(filename, &points, &ctx->mapping, &ctx->error)))
+        return signal;
+
+    return spkmeans_use_points(ctx, points, false);
+}
+
+int spkmeans_use_points(spkmeans_ctx_t *ctx, matrix_t points, bool borrowed) {
+    size_t i;
+
+    ctx->points = points;
+    ctx->borrowed_points = borrowed;
+    ctx->num_data = points.rows;
+    ctx->dim = points.cols;
+
+    ctx->datapoints = calloc(ctx->num_data, sizeof(*ctx->datapoints));
+    if(NULL == ctx->datapoints)
+        return BAD_ALLOC;
+
+    for(i = 0; i < ctx->num_data; i++) {
+        ctx->datapoints[i].data = matrix_row(ctx->points, i);
+        ctx->datapoints[i].current_set = (size_t)-1;
+    }
+
+    return 0;
+}
+
+#ifndef SPKMEANS_NO_MAIN
+/* Parses the arguments given to the program into the goal of the context,
+ * the input file and the output file (mandatory for the "convert" goal, and
+ * optional for the other goals, whose output is printed by default). The
+ * "spk" goal takes K (a non-negative integer, 0 for the eigengap heuristic)
+ * before the input file. Returns BAD_INPUT in case they're invalid. */
+static int parse_args(spkmeans_ctx_t *ctx, int argc, char **argv,
+                      char **infile, char **outfile) {
+
+    if(argc < 3)
+        return BAD_INPUT;
+
+    ctx->goal = argv[1];
+    if(strcmp(ctx->goal, "spk") == 0) {
+        size_t len = strlen(argv[2]);
+
+        if((argc != 4 && argc != 5) || len == 0 ||
+           strspn(argv[2], "0123456789") != len)
+            return BAD_INPUT;
+        ctx->K = strtoul(argv[2], NULL, 10);
+
+        /* The rest of the arguments are shifted by K */
+        argc--;
+        argv++;
+        if(argc == 4) {
+            *outfile = argv[3];
+        }
+    } else if(strcmp(ctx->goal, "convert") == 0) {
+        if(argc != 4)
+            return BAD_INPUT;
+        *outfile = argv[3];
+    } else if((argc != 3 && argc != 4) ||
+              (strcmp(ctx->goal, "wam") && strcmp(ctx->goal, "ddg") &&
+               strcmp(ctx->goal, "lnorm") && strcmp(ctx->goal, "jacobi"))) {
+        return BAD_INPUT;
+    } else if(argc == 4) {
+        *outfile = argv[3];
+    }
+
+    *infile = argv[2];
+    return 0;
+}
+
+/* Performs the "spk" goal of the program: clusters the datapoints of <infile>
+ * with spkmeans_spk, prints the initial centroids indices as a line of comma
+ * separated integers, and then prints the final centroids (or writes them
+ * into <outfile>, if it isn't NULL). */
+static int run_spk(spkmeans_ctx_t *ctx, const char *infile,
+                   const char *outfile) {
+    matrix_t centroids;
+    size_t i, *indices;
+    int signal;
+
+    if((signal = spkmeans_load(ctx, infile)))
+        return signal;
+    if((signal = spkmeans_spk(ctx, kmeans_default_config(), &indices,
+                              &centroids)))
+        return signal;
+
+    for(i = 0; i < ctx->K; i++) {
+        printf((i + 1 < ctx->K) ? "%lu," : "%lu\n", (unsigned long)indices[i]);
+    }
+
+    signal = spkmeans_write_output(centroids, outfile);
+    matrix_free(centroids);
+    free(indices);
+    return signal;
+}
+#endif
+
+/* Initializes a single datapoint - allocates enough space for it and sets all
+ * the values to zero. */
+int init_datapoint(dpoint_t *dpoint, size_t dim) {
+    dpoint->current_set = (size_t)-1;
+
+    if(dim == 0 || NULL == (dpoint->data = calloc(dim, sizeof(*dpoint->data))))
+        return BAD_ALLOC;
+
+    return 0;
+}
+
+/* Frees the given datapoint. If it's already been freed or not yet allocated,
+ * this function safely does nothing. */
+void free_datapoint(dpoint_t dpoint) {
+    if(NULL != dpoint.data) {
+        free(dpoint.data);
+    }
+}
+
+/* Frees all of the memory owned by the context. If a certain member hasn't
+ * been allocated yet, this function does not attempt to free it. */
+void spkmeans_ctx_free(spkmeans_ctx_t *ctx) {
+    size_t i = 0;
+
+    free_sets(ctx->sets, ctx->K);
+    ctx->sets = NULL;
+
+    /* Datapoints that are views of <points> don't own their coordinates */
+    if(NULL != ctx->datapoints) {
+        for(i = 0; i < ctx->num_data && NULL == ctx->points.data; i++) {
+            free_datapoint(ctx->datapoints[i]);
+        }
+        free(ctx->datapoints);
+        ctx->datapoints = NULL;
+    }
+
+    /* The points are either a view of the mapped file, borrowed, or
+     * allocated */
+    if(NULL != ctx->mapping.addr) {
+        loader_unmap(&ctx->mapping);
+    } else if(!ctx->borrowed_points) {
+        matrix_free_safe(ctx->points);
+    }
+    ctx->points.data = NULL;
+    ctx->borrowed_points = false;
+}
+/*****************************************************************************/
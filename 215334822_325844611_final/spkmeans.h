@@ -1,12 +1,23 @@
 #ifndef SPKMEANS_H
 #define SPKMEANS_H
 
+#include "budget.h"
+#include "distance.h"
+#include "kmeanspp.h"
+#include "loader.h"
 #include "spkmeans_goals.h"
 #include <string.h>
 
 #define MAX_ITER 100
 #define EPSILON 0.00001
 
+/* Default size of a mini-batch. A batch size of 0 selects full Lloyd passes */
+#define MINIBATCH_DEFAULT_SIZE 1024
+
+/* From this amount of centroids on, the Lloyd iterations assign the
+ * datapoints through the blocked distance kernel (see distance.h) */
+#define KMEANS_BLOCKED_MIN_K 32
+
 typedef int make_iso_compilers_happy;
 
 typedef struct {
@@ -15,47 +26,184 @@ typedef struct {
     int count;
 } set_t;
 
-/***************************** EXTERNAL VARIABLES *************************/
-extern char *goal;
-extern size_t K;
+/* Define a structure that will hold the configuration of the kmeans
+ * mechanism. A <batch_size> of 0 (or one that covers all of the datapoints)
+ * runs the regular Lloyd iterations over all of the datapoints. Otherwise,
+ * every iteration samples <batch_size> datapoints (using <seed>) and moves
+ * their centroids with per-centroid learning rates (mini-batch kmeans).
+ * The mechanism converges once no centroid moved by <tol> or more during an
+ * iteration, or after <max_iter> iterations.
+ *
+ * <n_init> independent runs are performed, on up to <n_threads> threads (0
+ * means one thread per online CPU). The first run starts from the given
+ * initial centroids, and the i-th run is seeded by kmeans++ with seed + i.
+ * The run with the lowest inertia is the one that's kept. */
+typedef struct kmeans_config_t {
+    size_t batch_size;
+    size_t max_iter;
+    double tol;
+    unsigned long seed;
+    size_t n_init;
+    size_t n_threads;
+} kmeans_config_t;
 
-extern size_t dim;
-extern size_t num_data;
-extern dpoint_t *datapoints;
-extern set_t *sets;
-/*************************************************************************/
+/* Define a structure that will hold the report of a single kmeans run: the
+ * seed it used, the amount of iterations it took, and its inertia (the sum of
+ * squared distances of the datapoints from their closest centroids) */
+typedef struct kmeans_report_t {
+    unsigned long seed;
+    size_t iterations;
+    double inertia;
+} kmeans_report_t;
+
+/* Define a structure that will hold the whole state of a single job: the
+ * wanted goal, the amount of clusters, the datapoints (along with their amount
+ * and dimension) and the sets of the kmeans mechanism. Every entry point only
+ * works on the context it's given, hence several jobs (each with its own
+ * context) may run concurrently in a single process. A context is initialized
+ * with spkmeans_ctx_init and freed with spkmeans_ctx_free.
+ *
+ * Datapoints loaded from a file are stored contiguously in <points>, and the
+ * datapoints are views of its rows (otherwise, <points> holds a `data` field
+ * of NULL and each datapoint owns its coordinates). If the file is a binary
+ * dataset used in place, <points> is a view of <mapping>. If <points> is
+ * borrowed from the caller (e.g. a Python buffer), it isn't freed along with
+ * the context. In case the file has a malformed row, it's described in
+ * <error>. The <plan> of the last goal (see budget.h) is kept, so that a goal
+ * that didn't fit the memory budget can be reported. */
+typedef struct spkmeans_ctx_t {
+    const char *goal;
+    size_t K;
+    size_t dim;
+    size_t num_data;
+    dpoint_t *datapoints;
+    matrix_t points;
+    loader_mapping_t mapping;
+    bool borrowed_points;
+    set_t *sets;
+    loader_error_t error;
+    budget_plan_t plan;
+} spkmeans_ctx_t;
 
 /**************************** MECHANISM'S INTERFACES
  * ************************************/
 /* A function to pass data about the vectors into the main mechanism of this
  *file, produced by the spkmeansmodule.c interface. That includes:
- * 		1. the filename of the datapoints (C has a parsing function that handles
- *parsing of datapoints from a file)
- * 		2. output (a pointer to a variable of type matrix_t that the caller
- *wishes to store the T matrix at) a. in case output == NULL, print the matrix
- *outputted by the wanted goal b. in case output != NULL, store the matrix
- *outputted by the wanted goal into the output variable */
-int spkmeans_pass_goal_info_and_run(char *infile, matrix_t *output);
-
-/* A function that passes the initial centroids indices into the Kmeans
- * mechanism */
-void spkmeans_pass_kmeans_info_and_run(size_t *initial_centroids_indices);
+ * 		1. ctx (the context of the job: its goal and K must be set)
+ * 		2. the filename of the datapoints (C has a parsing function that handles
+ *parsing of datapoints from a file). They're stored in the context.
+ * 		3. output (a pointer to a variable of type matrix_t that the caller
+ *wishes to store the matrix outputted by the wanted goal at)
+ * Returns 0 on success, BAD_INPUT in case of an invalid input (file or goal),
+ * and BAD_ALLOC in case of an allocation failure (or in case the goal doesn't
+ * fit the memory budget, see budget_plan). */
+int spkmeans_pass_goal_info_and_run(spkmeans_ctx_t *ctx, const char *infile,
+                                    matrix_t *output);
+
+/* The same as spkmeans_pass_goal_info_and_run, for datapoints that are
+ * already in memory: the rows of <points> (see spkmeans_use_points, which
+ * decides who owns them according to <borrowed>). Returns 0 on success,
+ * BAD_INPUT in case of an invalid goal, and BAD_ALLOC in case of an
+ * allocation failure. */
+int spkmeans_pass_goal_points_and_run(spkmeans_ctx_t *ctx, matrix_t points,
+                                      bool borrowed, matrix_t *output);
+
+/* A function that stores the given matrix as the datapoints of the context:
+ * its rows become the datapoints (as views), and its dimensions become
+ * `num_data` and `dim`. The matrix is owned by the context from now on,
+ * unless it's <borrowed> (then it must outlive the context's use of it).
+ * Returns BAD_ALLOC in case of an allocation failure. */
+int spkmeans_use_points(spkmeans_ctx_t *ctx, matrix_t points, bool borrowed);
+
+/* A function that passes the initial centroids indices and the configuration
+ * of the Kmeans mechanism (see kmeans_default_config) into the Kmeans
+ * mechanism, which clusters the datapoints of <ctx> into ctx->K sets (stored
+ * in ctx->sets). The indices are still owned by the caller. If <reports> isn't
+ * NULL, it must hold <config.n_init> elements, and the report of each run is
+ * stored in it. The index of the run whose centroids were kept (the one with
+ * the lowest inertia) is stored in <best> (unless it's NULL).
+ * Returns 0 on success, or the error signal of the mechanism. */
+int spkmeans_pass_kmeans_info_and_run(spkmeans_ctx_t *ctx,
+                                      size_t *initial_centroids_indices,
+                                      kmeans_config_t config,
+                                      kmeans_report_t *reports, size_t *best);
+
+/* A function that loads the datapoints of <infile> into the context (see
+ * spkmeans_pass_goal_info_and_run), instead of any datapoints it held.
+ * Returns 0 on success, BAD_INPUT in case the file can't be used, and
+ * BAD_ALLOC in case of an allocation failure. */
+int spkmeans_load(spkmeans_ctx_t *ctx, const char *infile);
+
+/* The same as spkmeans_load, for datapoints that are already in memory (see
+ * spkmeans_use_points) */
+int spkmeans_load_points(spkmeans_ctx_t *ctx, matrix_t points, bool borrowed);
+
+/* A function that performs the whole spectral clustering of the datapoints
+ * of the context, in C: the matrix T of the ctx->K first eigenvectors of the
+ * normalized graph laplacian (a ctx->K of 0 means the eigengap heuristic) is
+ * built, its rows replace the datapoints of the context (in place), the
+ * initial centroids are picked by kmeans++ (with <config.seed>), and the
+ * Kmeans mechanism clusters them according to <config>. The initial
+ * centroids indices are stored in a newly allocated array of ctx->K elements
+ * (the amount of clusters that was eventually used), stored in <indices>,
+ * and the final centroids are stored in <centroids>.
+ * Returns 0 on success, BAD_INPUT in case K isn't less than the amount of
+ * datapoints or is 1, DIM_MISMATCH in case the heuristic finds a single
+ * cluster, and BAD_ALLOC in case of an allocation failure. */
+int spkmeans_spk(spkmeans_ctx_t *ctx, kmeans_config_t config,
+                 size_t **indices, matrix_t *centroids);
+
+/* The second half of spkmeans_spk: the rows of the given T (which is owned by
+ * the context from now on) replace the datapoints of the context, and are
+ * seeded and clustered into T.cols sets. Returns the same signals. */
+int spkmeans_spk_cluster(spkmeans_ctx_t *ctx, matrix_t T,
+                         kmeans_config_t config, size_t **indices,
+                         matrix_t *centroids);
+
+/* A function that loads the datapoints of <infile> into the context and saves
+ * them into <outfile>, in the binary format or as a NumPy array (according to
+ * its extension, see loader_save). Returns 0 on success, BAD_INPUT in case
+ * one of the files can't be used, BAD_OUTPUT in case <outfile> can't be
+ * written, and BAD_ALLOC in case of an allocation failure. */
+int spkmeans_convert(spkmeans_ctx_t *ctx, const char *infile,
+                     const char *outfile);
+
+/* A function that writes the output of a goal (or any other matrix, e.g. the
+ * final centroids) according to the extension of <outfile>:
+ * 		1. NULL: printed into stdout as text (see matrix_print_rows)
+ * 		2. ".csv" or ".txt": the same text, written into the file
+ * 		3. ".bin" or ".npy": the raw doubles (see loader_save)
+ * Returns 0 on success, BAD_INPUT in case of another extension, BAD_OUTPUT in
+ * case the output can't be written, and BAD_ALLOC in case of an allocation
+ * failure. */
+int spkmeans_write_output(matrix_t output, const char *outfile);
+
+/* Returns the default configuration of the Kmeans mechanism: a single run of
+ * full Lloyd iterations, MAX_ITER iterations at most, and a tolerance of
+ * EPSILON */
+kmeans_config_t kmeans_default_config(void);
 /*************************************************************************/
 
 /**************************** AUXILIARY FUNCTIONS
  * ************************************/
-/* A function used to assert a certain condition and print out "An error has
- * occurred" in case the condition isn't met */
-void assert_other(bool condition);
+/* A function used to initialize an empty context (no goal, no datapoints) */
+void spkmeans_ctx_init(spkmeans_ctx_t *ctx);
+
+/* A function used to free all of the memory owned by the given context (its
+ * datapoints and sets). The goal and K are kept, and the context may be
+ * reused. */
+void spkmeans_ctx_free(spkmeans_ctx_t *ctx);
 
-/* A function used to initialize a datapoint (i.e., allocate an array to it) */
-void init_datapoint(dpoint_t *dpoint);
+/* Returns the message matching the given error signal: "Invalid Input!" for
+ * BAD_INPUT, and "An Error Has Occurred" for any other error */
+const char *spkmeans_strerror(int signal);
+
+/* A function used to initialize a datapoint of <dim> coordinates (i.e.,
+ * allocate an array to it). Returns BAD_ALLOC on allocation failure. */
+int init_datapoint(dpoint_t *dpoint, size_t dim);
 
 /* A function used to free a datapoint */
 void free_datapoint(dpoint_t);
-
-/* A function used to free the program of the kmeans algorithm */
-void free_program(void);
 /*************************************************************************/
 
 #endif
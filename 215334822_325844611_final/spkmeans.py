@@ -1,5 +1,5 @@
 import sys
-from typing import List
+from typing import List, Optional
 import numpy as np
 import pandas as pd
 import spkmeans
@@ -7,38 +7,20 @@ import matplotlib.pyplot as plt
 import time
 
 
-def main(K: int, goal: str, infile: str) -> None:
+def main(K: int, goal: str, infile: str,
+         outfile: Optional[str] = None) -> None:
     output: List[List[float]]
 
 # In case that we desire a normalized spectral clustering:
     if goal == "spk":
-        with open(infile) as tmpFile:
-            num_data = len(tmpFile.readlines())
-
-    # We want K to be less or equal to num_data, and not equal to 1
-        assert_valid_input(K < num_data)
-        assert_valid_input(K != 1)
-
-    # Fetch the matrix of points produced from the eigen vectors of the
-    # normalized graph laplacian matrix of the given vectors
-        T_points = spkmeans.goal(K, goal, infile)
-
-        # Make sure that the amount of centroids isn't 1
-        # (this can be determined by <T_points>)
-        assert_generic(len(T_points[0]) != 1)
-
-    # Initialize centroids picked by the Kmeans++ algorithm
-        initial_centroids_indices = initialize_centroids(
-            len(T_points[0]), T_points)
-
-    # Perform the kmeans clustering algorith on the
-        output = spkmeans.kmeans_fit(
-            T_points,
-            len(T_points),
-            len(T_points[0]),
-            initial_centroids_indices,
-            len(initial_centroids_indices)
-        )
+    # The extension performs the whole clustering in a single call: it builds
+    # the matrix of points produced from the eigen vectors of the normalized
+    # graph laplacian matrix of the given vectors, picks the initial centroids
+    # (by the Kmeans++ algorithm) out of its rows, and performs the kmeans
+    # clustering algorithm on them. It verifies that K is less than the amount
+    # of datapoints, not equal to 1, and that the amount of centroids isn't 1
+        initial_centroids_indices, output = spkmeans.spk(K, infile,
+                                                         outfile=outfile)
 
         # print the initial centroids indices
         print(",".join([str(ele) for ele in initial_centroids_indices]))
@@ -46,48 +28,12 @@ def main(K: int, goal: str, infile: str) -> None:
     else:  # In any other case that isn't a normalized spectral clustering -
         # just perform the desired operation
         # corresponding to the "goal" parameter
-        output = spkmeans.goal(K, goal, infile)
+        output = spkmeans.goal(K, goal, infile, outfile)
 
-    # print the output of the goal
-    print("\n".join([",".join(["{:.4f}".format(num)
-          for num in line]) for line in output]))
-
-
-def initialize_centroids(K: int,
-                         datapoints: List[List[float]]) -> List[List[float]]:
-    """
-    Given a list of datapoints and an amount of centroids we wish to output 'K',
-    weightedly pick the initial centroids for the kmeans process we'll perform
-    later. This function will return their indices inside the given set of
-    datapoints.
-    """
-    np.random.seed(0)
-    index_range = list(range(len(datapoints)))
-    centroids_indices = list()
-    centroids_indices.append(int(np.random.choice(index_range)))
-
-    for i in range(1, K):
-        distance_list = [
-            min([
-                calc_distance(dp, datapoints[prev_obs])
-                for prev_obs in centroids_indices
-            ]) for dp in datapoints
-        ]
-        sum_dist = sum(distance_list)
-        probability_list = [dist/sum_dist for dist in distance_list]
-        centroids_indices.append(
-            int(np.random.choice(index_range, p=probability_list)))
-
-    return centroids_indices
-
-
-def calc_distance(u1: List[float], u2: List[float]) -> float:
-    """
-    Given two same length vectors, calculate the euclidean norm of their
-    distance, and return it as the value
-    """
-    assert(len(u1) == len(u2))
-    return sum([(u1[ind] - u2[ind]) ** 2 for ind in range(len(u1))])
+    # print the output of the goal (each value formatted as "{:.4f}"), unless
+    # it has already been written into the output file
+    if outfile is None:
+        spkmeans.print_matrix(output)
 
 
 def assert_valid_input(cond: bool):
@@ -126,7 +72,7 @@ def check_positive_numstr(string: str):
 # Argument validation also happens here.
 if __name__ == "__main__":
     num_args = len(sys.argv)
-    assert_valid_input(num_args == 4)
+    assert_valid_input(num_args in (4, 5))
 
     # We want K to be both numeric and positive.
     K, valid = check_positive_numstr(sys.argv[1])
@@ -137,9 +83,24 @@ if __name__ == "__main__":
     assert_valid_input(goal in ['wam', 'ddg', 'lnorm', 'jacobi', 'spk'])
 
     # The document specified that filenames must end with .txt or .csv, so we
-    # verify this here.
+    # verify this here. Binary datasets (.bin, produced by the "convert" goal
+    # of the C program) and NumPy arrays (.npy) are accepted as well, and so
+    # is "-", for a text streamed through stdin.
     infile = sys.argv[3]
-    assert_valid_input(infile.endswith((".txt", ".csv")))
-
-    # call the main mechanism
-    main(K, goal, infile)
+    assert_valid_input(infile == "-" or
+                       infile.endswith((".txt", ".csv", ".bin", ".npy")))
+
+    # An optional output file gets the result instead of stdout: as text
+    # (.txt, .csv), or as the raw doubles (.bin, .npy) for large results
+    outfile = sys.argv[4] if num_args == 5 else None
+    assert_valid_input(outfile is None or
+                       outfile.endswith((".txt", ".csv", ".bin", ".npy")))
+
+    # call the main mechanism. The extension raises a ValueError on an invalid
+    # input, and another exception on any other error
+    try:
+        main(K, goal, infile, outfile)
+    except ValueError:
+        assert_valid_input(False)
+    except Exception:
+        assert_generic(False)
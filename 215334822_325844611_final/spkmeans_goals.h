@@ -8,27 +8,44 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-extern void assert_other(bool condition);
+/* The context of a job (see spkmeans.h). The goals read its datapoints. */
+struct spkmeans_ctx_t;
 
 /* A function to print the weighted adjacency matrix out of the given vectors.
  * Store the output into <output> */
-int build_weighted_adjacency_matrix(matrix_t *output);
+int build_weighted_adjacency_matrix(const struct spkmeans_ctx_t *ctx,
+                                    matrix_t *output);
 
 /* A function to print the diagonal degree matrix of the given vectors. Store
  * the output into <output> */
-int build_diagonal_degree_matrix(matrix_t *output);
+int build_diagonal_degree_matrix(const struct spkmeans_ctx_t *ctx,
+                                 matrix_t *output);
 
 /* A function to print the normalized graph laplacian matrix of the given
  * vectors. Store the output into <output> */
-int build_normalized_laplacian(matrix_t *output);
+int build_normalized_laplacian(const struct spkmeans_ctx_t *ctx,
+                               matrix_t *output);
 
 /* A function to print the eigen values and eigen vectors of the given input.
- * Store the output into <output> */
-int build_jacobi_output(matrix_t *output);
+ * Store the output into <output>. Returns BAD_INPUT if the given vectors don't
+ * form a square matrix */
+int build_jacobi_output(const struct spkmeans_ctx_t *ctx,
+                        matrix_t *output);
 
 /* A function to perform the whole algorithm of the spectral clustering
  * algorithm. It returns the spectral datapoints for kmeans++ as a matrix. Store
  * the output into <output> */
-int build_T_of_spectral_kmeans(size_t K, matrix_t *output);
+int build_T_of_spectral_kmeans(const struct spkmeans_ctx_t *ctx, size_t K,
+                               matrix_t *output);
+
+/* The same as build_T_of_spectral_kmeans, while keeping the parts of the
+ * spectral decomposition that T is built out of: the degree of every
+ * datapoint is stored in <degrees> (an array of ctx->num_data elements), and
+ * the output of the jacobi algorithm (the K first eigen vectors, before their
+ * rows are normalized, along with all of the sorted eigen values) is stored
+ * in <spectrum>, which must be freed by the caller. Either may be NULL. */
+int build_spectral_embedding(const struct spkmeans_ctx_t *ctx, size_t K,
+                             double *degrees, jacobi_t *spectrum,
+                             matrix_t *output);
 
 #endif
@@ -1,169 +1,997 @@
 #define PY_SSIZE_T_CLEAN
+#include "arena.h"
+#include "backend.h"
+#include "disk.h"
+#include "isa.h"
+#include "jobs.h"
+#include "kmeanspp.h"
+#include "model.h"
+#include "profile.h"
 #include "spkmeans.h"
+#include "writer.h"
 #include <Python.h>
 
 #define PY_ERROR -1
 
+/* Define the Matrix type: a result of the extension, which owns its matrix_t
+ * and exposes it through the buffer protocol (as a C-contiguous 2-dimensional
+ * buffer of doubles), so that e.g. np.asarray uses it without copying. It's
+ * a sequence of its rows as well (each row is built as a list of floats), for
+ * compatibility with the lists of lists that the extension used to return. */
+typedef struct MatrixObject {
+    PyObject_HEAD
+    matrix_t mat;
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+} MatrixObject;
+
+/* The Matrix type, created (from matrixSpec) when the module is imported */
+static PyTypeObject *MatrixType = NULL;
+
+static void Matrix_dealloc(MatrixObject *self);
+static int Matrix_getbuffer(MatrixObject *self, Py_buffer *view, int flags);
+static Py_ssize_t Matrix_length(MatrixObject *self);
+static PyObject *Matrix_item(MatrixObject *self, Py_ssize_t i);
+static PyObject *Matrix_tolist(MatrixObject *self, PyObject *unused);
+static PyObject *Matrix_shape(MatrixObject *self, void *closure);
+
+/* Define a structure that will hold the state of a goal submitted to the pool
+ * of the module. It's shared by its Job object and by the task that performs
+ * it (without the GIL), and freed by whichever of them lets go of it last.
+ * The task owns everything but <refs> until <done> is set. */
+typedef struct goal_job_t {
+    spkmeans_ctx_t ctx;
+    char *goal;
+    char *infile; /* NULL for datapoints given in memory */
+    matrix_t points;
+    matrix_t output;
+    int signal;
+    jobs_event_t done;
+    int refs; /* protected by the lock of <done> */
+} goal_job_t;
+
+/* Define the Job type: the future of a submitted goal. The Matrix of its
+ * result is built by the first call of result(). */
+typedef struct JobObject {
+    PyObject_HEAD
+    goal_job_t *job;
+    PyObject *result;
+} JobObject;
+
+/* The Job type, and the pool that performs the submitted goals (started by
+ * the first submission, and stopped when the interpreter exits) */
+static PyTypeObject *JobType = NULL;
+static jobs_pool_t goalPool;
+static bool goalPoolStarted = false;
+
+static void Job_dealloc(JobObject *self);
+static PyObject *Job_result(JobObject *self, PyObject *args, PyObject *kwargs);
+static PyObject *Job_done(JobObject *self, PyObject *unused);
+static PyObject *jobResult(JobObject *self, double timeout);
+static void goalJobRun(void *arg);
+static void goalJobRelease(goal_job_t *job);
+static char *copyString(const char *string);
+static void stopGoalPool(void);
+
+/* Define the Model type: a fitted spectral clustering model (see model.h),
+ * which assigns new datapoints to its clusters, and may be saved and loaded
+ * back */
+typedef struct ModelObject {
+    PyObject_HEAD
+    model_t model;
+} ModelObject;
+
+/* The Model type, created (from modelSpec) when the module is imported */
+static PyTypeObject *ModelType = NULL;
+
+static void Model_dealloc(ModelObject *self);
+static PyObject *Model_predict(ModelObject *self, PyObject *args);
+static PyObject *Model_save(ModelObject *self, PyObject *args);
+static PyObject *Model_K(ModelObject *self, void *closure);
+static PyObject *Model_centroids(ModelObject *self, void *closure);
+static PyObject *modelToObject(model_t *model);
+
+/* Define a structure that will hold the counts of the kmeans algorithm (see
+ * kmeans_config_t) as they're parsed out of the keyword arguments: signed, so
+ * that negative values are told apart (see pyToConfig) */
+typedef struct py_counts_t {
+    Py_ssize_t batch_size;
+    Py_ssize_t max_iter;
+    Py_ssize_t n_init;
+    Py_ssize_t n_threads;
+} py_counts_t;
+
 /**************************************************************************/
 static PyObject *run_goal(PyObject *self, PyObject *args);
-static PyObject *kmeans_fit(PyObject *self, PyObject *args);
+static PyObject *kmeans_fit(PyObject *self, PyObject *args, PyObject *kwargs);
+static PyObject *kmeanspp(PyObject *self, PyObject *args);
+static PyObject *spk(PyObject *self, PyObject *args, PyObject *kwargs);
+static PyObject *fit(PyObject *self, PyObject *args, PyObject *kwargs);
+static PyObject *load_model(PyObject *self, PyObject *args);
+static PyObject *convert(PyObject *self, PyObject *args);
+static PyObject *print_matrix(PyObject *self, PyObject *args);
+static PyObject *submit(PyObject *self, PyObject *args);
+static PyObject *wait_jobs(PyObject *self, PyObject *args);
+static PyObject *memory_stats(PyObject *self, PyObject *args);
+static PyObject *backend(PyObject *self, PyObject *args);
+static PyObject *isa(PyObject *self, PyObject *args);
+static PyObject *last_profile(PyObject *self, PyObject *args);
+static PyObject *memory_plan(PyObject *self, PyObject *args);
 
 static int matrixToList(const matrix_t mat, PyObject **output);
-static int listToArray_D(PyObject *list, size_t length, double **output);
+static int matrixToObject(matrix_t *mat, PyObject **output);
+static int pyToMatrix(PyObject *obj, size_t *rows, size_t *cols,
+                      matrix_t *output, Py_buffer *view);
+static int isDoubleFormat(const char *format);
 static int listToArray_L(PyObject *list, size_t length, size_t **output);
-static int py_kmeans_parse_args(PyObject *);
+static int listToMatrix(PyObject *list, size_t rows, size_t cols,
+                        matrix_t *output);
+static int py_kmeans_parse_args(PyObject *, PyObject *, spkmeans_ctx_t *,
+                                Py_buffer *, size_t **, kmeans_config_t *,
+                                int *, const char **);
+static py_counts_t pyCountsOf(kmeans_config_t config);
+static int pyToConfig(py_counts_t counts, kmeans_config_t *config);
+static int pyToSize(Py_ssize_t value, const char *name, size_t *output);
+static int reportsToList(const kmeans_report_t *reports, size_t length,
+                         PyObject **output);
+static PyObject *raiseSignal(int signal);
+static PyObject *raiseGoalSignal(int signal, const char *infile,
+                                 loader_error_t error,
+                                 const budget_plan_t *plan);
 
 /**************************************************************************/
 
-/**************************************************************************/
-static double **datapoints_arg = NULL;
-static size_t *initial_centroids_indices = NULL;
-/**************************************************************************/
-
 /************************* configuring the C API
  * ****************************************************/
 static PyObject *run_goal(PyObject *self, PyObject *args) {
-    char *infile;
-    matrix_t output;
-    PyObject *py_output = NULL;
+    spkmeans_ctx_t ctx;
+    const char *infile = NULL, *outfile = NULL;
+    matrix_t output, points;
+    Py_buffer view;
+    PyObject *data_py, *py_output = NULL;
+    size_t rows = 0, cols = 0;
+    Py_ssize_t K;
+    int signal;
 
     output.data = NULL;
+    view.obj = NULL;
 
-    /* Fetch the string of the infile */
-    if(!PyArg_ParseTuple(args, "lss", &K, &goal, &infile))
-        goto error;
+    /* Every call works on a context of its own */
+    spkmeans_ctx_init(&ctx);
+
+    /* Fetch the infile (or the datapoints themselves) and the optional
+     * outfile */
+    if(!PyArg_ParseTuple(args, "nsO|z", &K, &ctx.goal, &data_py, &outfile))
+        return NULL;
+    if((signal = pyToSize(K, "K", &ctx.K)))
+        return raiseSignal(signal);
+
+    /* The datapoints are either parsed out of the infile, or given as a
+     * buffer of doubles (used in place) or as a list of lists */
+    if(PyUnicode_Check(data_py)) {
+        if(NULL == (infile = PyUnicode_AsUTF8(data_py)))
+            return NULL;
+    } else if((signal = pyToMatrix(data_py, &rows, &cols, &points, &view)))
+        return raiseSignal(signal);
 
-    /* Perform the wanted goal's operation and return the result (if there's
-     * any) */
-    if(spkmeans_pass_goal_info_and_run(infile, &output))
+    /* Perform the wanted goal's operation (and write its result into the
+     * outfile, if there's one) without holding the GIL */
+    Py_BEGIN_ALLOW_THREADS
+    if(NULL != infile) {
+        signal = spkmeans_pass_goal_info_and_run(&ctx, infile, &output);
+    } else {
+        signal = spkmeans_pass_goal_points_and_run(&ctx, points,
+                                                   NULL != view.obj, &output);
+    }
+    if(0 == signal && NULL != outfile) {
+        signal = spkmeans_write_output(output, outfile);
+    }
+    Py_END_ALLOW_THREADS
+    if(signal)
         goto error;
 
-    /* Build the matrix that was created by the goal */
-    if(matrixToList(output, &py_output))
+    /* Return the matrix that was created by the goal (if it wasn't written
+     * into the outfile) */
+    if(NULL != outfile) {
+        Py_INCREF(Py_None);
+        py_output = Py_None;
+    } else if((signal = matrixToObject(&output, &py_output)))
         goto error;
 
     /* Free and return */
-    matrix_free(output);
-    free_program();
-    
+    matrix_free_safe(output);
+    spkmeans_ctx_free(&ctx);
+    PyBuffer_Release(&view);
+
     return py_output;
 
 error:
     matrix_free_safe(output);
-    free_program();
-    Py_XDECREF(py_output);
-    assert_other(false);
-    return NULL;
+    spkmeans_ctx_free(&ctx);
+    PyBuffer_Release(&view);
+    return raiseGoalSignal(signal, infile, ctx.error, &ctx.plan);
 }
 
-static PyObject *kmeans_fit(PyObject *self, PyObject *args) {
-    PyObject *py_output;
+static PyObject *spk(PyObject *self, PyObject *args, PyObject *kwargs) {
+    static char *kwlist[] = {"K",        "datapoints", "outfile", "batch_size",
+                             "max_iter", "tol",        "seed",    "n_init",
+                             "n_threads", NULL};
+    PyObject *data_py, *py_indices = NULL, *py_centroids = NULL;
+    spkmeans_ctx_t ctx;
+    kmeans_config_t config = kmeans_default_config();
+    py_counts_t counts = pyCountsOf(config);
+    const char *infile = NULL, *outfile = NULL;
+    size_t *indices = NULL, rows = 0, cols = 0, i;
+    matrix_t points, centroids;
+    Py_buffer view;
+    Py_ssize_t K;
+    int signal;
+
+    centroids.data = NULL;
+    view.obj = NULL;
+
+    /* Every call works on a context of its own */
+    spkmeans_ctx_init(&ctx);
+    ctx.goal = "spk";
+
+    /* Fetching Arguments from Python */
+    if(!PyArg_ParseTupleAndKeywords(
+           args, kwargs, "nO|znndknn", kwlist, &K, &data_py, &outfile,
+           &counts.batch_size, &counts.max_iter, &config.tol, &config.seed,
+           &counts.n_init, &counts.n_threads))
+        return NULL;
+    if((signal = pyToSize(K, "K", &ctx.K)) ||
+       (signal = pyToConfig(counts, &config)))
+        return raiseSignal(signal);
+
+    /* The datapoints are either parsed out of the infile, or given as a
+     * buffer of doubles (used in place) or as a list of lists */
+    if(PyUnicode_Check(data_py)) {
+        if(NULL == (infile = PyUnicode_AsUTF8(data_py)))
+            return NULL;
+    } else if((signal = pyToMatrix(data_py, &rows, &cols, &points, &view)))
+        return raiseSignal(signal);
+
+    /* The whole clustering runs in C, without holding the GIL (T never
+     * leaves the context) */
+    Py_BEGIN_ALLOW_THREADS
+    if(NULL != infile) {
+        signal = spkmeans_load(&ctx, infile);
+    } else {
+        signal = spkmeans_load_points(&ctx, points, NULL != view.obj);
+    }
+    if(0 == signal) {
+        signal = spkmeans_spk(&ctx, config, &indices, &centroids);
+    }
+    if(0 == signal && NULL != outfile) {
+        signal = spkmeans_write_output(centroids, outfile);
+    }
+    Py_END_ALLOW_THREADS
+    if(signal)
+        goto error;
+
+    /* Building the list of the initial centroids indices */
+    signal = PY_ERROR;
+    if(NULL == (py_indices = PyList_New(ctx.K)))
+        goto error;
+    for(i = 0; i < ctx.K; i++) {
+        PyObject *pyindex = PyLong_FromSize_t(indices[i]);
+        if(NULL == pyindex)
+            goto error;
+        PyList_SET_ITEM(py_indices, (Py_ssize_t)i, pyindex);
+    }
+
+    /* Return the centroids along with the indices (unless they were written
+     * into the outfile) */
+    if(NULL != outfile) {
+        Py_INCREF(Py_None);
+        py_centroids = Py_None;
+    } else if((signal = matrixToObject(&centroids, &py_centroids)))
+        goto error;
+
+    free(indices);
+    spkmeans_ctx_free(&ctx);
+    PyBuffer_Release(&view);
+    return Py_BuildValue("(NN)", py_indices, py_centroids);
+
+error:
+    Py_XDECREF(py_indices);
+    matrix_free_safe(centroids);
+    if(NULL != indices)
+        free(indices);
+    spkmeans_ctx_free(&ctx);
+    PyBuffer_Release(&view);
+    return raiseGoalSignal(signal, infile, ctx.error, &ctx.plan);
+}
+
+static PyObject *fit(PyObject *self, PyObject *args, PyObject *kwargs) {
+    static char *kwlist[] = {"K",      "datapoints", "batch_size", "max_iter",
+                             "tol",    "seed",       "n_init",     "n_threads",
+                             NULL};
+    PyObject *data_py;
+    spkmeans_ctx_t ctx;
+    kmeans_config_t config = kmeans_default_config();
+    py_counts_t counts = pyCountsOf(config);
+    const char *infile = NULL;
+    size_t rows = 0, cols = 0;
+    matrix_t points;
+    model_t model;
+    Py_buffer view;
+    Py_ssize_t K;
+    int signal;
+
+    view.obj = NULL;
+
+    spkmeans_ctx_init(&ctx);
+    ctx.goal = "spk";
+
+    /* Fetching Arguments from Python */
+    if(!PyArg_ParseTupleAndKeywords(
+           args, kwargs, "nO|nndknn", kwlist, &K, &data_py,
+           &counts.batch_size, &counts.max_iter, &config.tol, &config.seed,
+           &counts.n_init, &counts.n_threads))
+        return NULL;
+    if((signal = pyToSize(K, "K", &ctx.K)) ||
+       (signal = pyToConfig(counts, &config)))
+        return raiseSignal(signal);
+
+    /* The datapoints are given as spk takes them */
+    if(PyUnicode_Check(data_py)) {
+        if(NULL == (infile = PyUnicode_AsUTF8(data_py)))
+            return NULL;
+    } else if((signal = pyToMatrix(data_py, &rows, &cols, &points, &view)))
+        return raiseSignal(signal);
+
+    /* The model keeps a copy of the datapoints, hence a buffer isn't needed
+     * once it's fitted */
+    Py_BEGIN_ALLOW_THREADS
+    if(NULL != infile) {
+        signal = spkmeans_load(&ctx, infile);
+    } else {
+        signal = spkmeans_load_points(&ctx, points, NULL != view.obj);
+    }
+    if(0 == signal) {
+        signal = model_fit(&ctx, config, &model, NULL);
+    }
+    spkmeans_ctx_free(&ctx);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+
+    if(signal)
+        return raiseGoalSignal(signal, infile, ctx.error, &ctx.plan);
+
+    return modelToObject(&model);
+}
+
+static PyObject *load_model(PyObject *self, PyObject *args) {
+    const char *filename;
+    loader_error_t error;
+    model_t model;
+    int signal;
+
+    /* Fetching Arguments from Python */
+    if(!PyArg_ParseTuple(args, "s", &filename))
+        return NULL;
+
+    error.line = 0;
+    error.reason = NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    signal = model_load(filename, &model, &error);
+    Py_END_ALLOW_THREADS
+
+    if(signal)
+        return raiseGoalSignal(signal, filename, error, NULL);
+
+    return modelToObject(&model);
+}
+
+static PyObject *kmeans_fit(PyObject *self, PyObject *args, PyObject *kwargs) {
+    PyObject *py_output = NULL, *py_runs = NULL;
+    spkmeans_ctx_t ctx;
+    Py_buffer view;
+    const char *outfile = NULL;
+    size_t *initial_centroids_indices = NULL;
     matrix_t centroids_mat;
+    kmeans_config_t config;
+    kmeans_report_t *reports = NULL;
+    int return_runs = 0, signal;
     size_t i, j;
 
     centroids_mat.data = NULL; // in case of an error, `centroids_mat`'s data
                                // field is freed if it's not null
 
+    /* Every call works on a context of its own */
+    spkmeans_ctx_init(&ctx);
+    view.obj = NULL;
+
     /* parsing the given lists as arrays (If an error has been captured
      * a PyExc has been set, and we return NULL */
-    assert_other(0 == py_kmeans_parse_args(args));
-
-    /* building the returned centroids' list */
-    spkmeans_pass_kmeans_info_and_run(initial_centroids_indices);
+    if((signal = py_kmeans_parse_args(args, kwargs, &ctx, &view,
+                                      &initial_centroids_indices, &config,
+                                      &return_runs, &outfile)))
+        goto error;
 
-    /* Creating the matrix that will hold the centroids */
-    if(matrix_new(K, dim, &centroids_mat))
+    /* one report per run */
+    if(config.n_init == 0) {
+        config.n_init = 1;
+    }
+    reports = calloc(config.n_init, sizeof(*reports));
+    if(NULL == reports) {
+        signal = BAD_ALLOC;
         goto error;
+    }
 
-    /* Building the matrix that will hold the centroids */
-    for(i = 0; i < K; i++) {
-        for(j = 0; j < dim; j++) {
-            matrix_set(centroids_mat, i, j, sets[i].current_centroid.data[j]);
+    /* Run the mechanism and build the matrix that will hold the centroids
+     * (writing it into the outfile, if there's one) without holding the GIL */
+    Py_BEGIN_ALLOW_THREADS
+    signal = spkmeans_pass_kmeans_info_and_run(
+        &ctx, initial_centroids_indices, config, reports, NULL);
+    if(0 == signal) {
+        signal = matrix_new(ctx.K, ctx.dim, &centroids_mat);
+    }
+    if(0 == signal) {
+        for(i = 0; i < ctx.K; i++) {
+            for(j = 0; j < ctx.dim; j++) {
+                matrix_set(centroids_mat, i, j,
+                           ctx.sets[i].current_centroid.data[j]);
+            }
         }
     }
+    if(0 == signal && NULL != outfile) {
+        signal = spkmeans_write_output(centroids_mat, outfile);
+    }
+    Py_END_ALLOW_THREADS
+    if(signal)
+        goto error;
 
-    /* Build the matrix that was created by the centroids */
-    if(matrixToList(centroids_mat, &py_output))
+    /* Return the centroids (if they weren't written into the outfile) */
+    if(NULL != outfile) {
+        Py_INCREF(Py_None);
+        py_output = Py_None;
+    } else if((signal = matrixToObject(&centroids_mat, &py_output)))
         goto error;
 
+    /* If asked, return the report of every run along with the centroids */
+    if(return_runs) {
+        if((signal = reportsToList(reports, config.n_init, &py_runs)))
+            goto error;
+        if(NULL == (py_output = Py_BuildValue("(NN)", py_output, py_runs))) {
+            signal = PY_ERROR;
+            goto error;
+        }
+    }
+
     /* Free and return */
-    matrix_free(centroids_mat);
-    free_program();
-    
+    matrix_free_safe(centroids_mat);
+    free(reports);
+    free(initial_centroids_indices);
+    spkmeans_ctx_free(&ctx);
+    PyBuffer_Release(&view);
+
     return py_output;
 
 error:
     matrix_free_safe(centroids_mat);
-    free_program();
-    assert_other(false);
-    return NULL;
+    if(NULL != reports)
+        free(reports);
+    if(NULL != initial_centroids_indices)
+        free(initial_centroids_indices);
+    spkmeans_ctx_free(&ctx);
+    PyBuffer_Release(&view);
+    return raiseSignal(signal);
 }
-/**************************************************************************/
-
-/***************************** Generic C API Functions
- * ***************************/
 
-/* This parses the given Python arguments into C-represented Objects + manage
- * Reference counts of Py args Returns 0 on success, and 1 on failure */
-static int py_kmeans_parse_args(PyObject *args) {
-    size_t i;
-    PyObject *datapoints_py = NULL;
-    PyObject *initial_centroids_indices_py = NULL;
+static PyObject *kmeanspp(PyObject *self, PyObject *args) {
+    PyObject *datapoints_py, *py_output = NULL;
+    size_t rows, cols, num_centroids, i, *indices = NULL;
+    Py_ssize_t rows_py, cols_py, num_centroids_py;
+    unsigned long seed;
+    matrix_t points;
+    Py_buffer view;
     int signal;
 
+    points.data = NULL;
+    view.obj = NULL;
+
     /* Fetching Arguments from Python */
-    if(!PyArg_ParseTuple(args, "OllOl", &datapoints_py, &num_data, &dim,
-                         &initial_centroids_indices_py, &K))
-    {
-        signal = PY_ERROR;
-    }
+    if(!PyArg_ParseTuple(args, "Onnnk", &datapoints_py, &rows_py, &cols_py,
+                         &num_centroids_py, &seed))
+        return NULL;
+    if((signal = pyToSize(rows_py, "num_data", &rows)) ||
+       (signal = pyToSize(cols_py, "dim", &cols)) ||
+       (signal = pyToSize(num_centroids_py, "K", &num_centroids)))
+        return raiseSignal(signal);
 
-    /* Parsing the datapoints: creating the datapoints array */
-    datapoints = calloc(num_data, sizeof(dpoint_t));
-    if(NULL == datapoints) {
+    /* Parsing the datapoints into a single contiguous matrix */
+    if((signal = pyToMatrix(datapoints_py, &rows, &cols, &points, &view)))
+        goto error;
+
+    indices = calloc(num_centroids ? num_centroids : 1, sizeof(*indices));
+    if(NULL == indices) {
         signal = BAD_ALLOC;
         goto error;
     }
 
-    /* Building the datapoints array: inserting inner lists */
-    for(i = 0; i < num_data; i++) {
-        PyObject *tmpItem;
+    /* Picking the initial centroids (without holding the GIL) */
+    Py_BEGIN_ALLOW_THREADS
+    signal = kmeanspp_init(points, num_centroids, seed, indices);
+    Py_END_ALLOW_THREADS
+    if(signal)
+        goto error;
 
-        /* Extracting inner object of the given list */
-        if(NULL == (tmpItem = PyList_GetItem(datapoints_py, i))) {
-            signal = PY_ERROR;
+    /* Building the list of the picked indices */
+    signal = PY_ERROR;
+    if(NULL == (py_output = PyList_New(num_centroids)))
+        goto error;
+    for(i = 0; i < num_centroids; i++) {
+        PyObject *pyindex = PyLong_FromSize_t(indices[i]);
+        if(NULL == pyindex)
             goto error;
+        PyList_SET_ITEM(py_output, (Py_ssize_t)i, pyindex);
+    }
+
+    /* Free and return */
+    if(NULL == view.obj)
+        matrix_free(points);
+    PyBuffer_Release(&view);
+    free(indices);
+
+    return py_output;
+
+error:
+    if(NULL == view.obj)
+        matrix_free_safe(points);
+    PyBuffer_Release(&view);
+    if(NULL != indices)
+        free(indices);
+    Py_XDECREF(py_output);
+    return raiseSignal(signal);
+}
+
+static PyObject *convert(PyObject *self, PyObject *args) {
+    spkmeans_ctx_t ctx;
+    const char *infile, *outfile;
+    int signal;
+
+    /* Fetching Arguments from Python */
+    if(!PyArg_ParseTuple(args, "ss", &infile, &outfile))
+        return NULL;
+
+    spkmeans_ctx_init(&ctx);
+
+    /* Load the input file and save it in the wanted format (without holding
+     * the GIL) */
+    Py_BEGIN_ALLOW_THREADS
+    signal = spkmeans_convert(&ctx, infile, outfile);
+    spkmeans_ctx_free(&ctx);
+    Py_END_ALLOW_THREADS
+
+    if(signal)
+        return raiseSignal(signal);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *print_matrix(PyObject *self, PyObject *args) {
+    PyObject *matrix_py, *sys_stdout, *flushed;
+    matrix_t mat;
+    Py_buffer view;
+    size_t rows = 0, cols = 0;
+    int fd = 1, signal;
+
+    mat.data = NULL;
+    view.obj = NULL;
+
+    /* Fetching Arguments from Python */
+    if(!PyArg_ParseTuple(args, "O|i", &matrix_py, &fd))
+        return NULL;
+
+    /* Parsing the rows into a single contiguous matrix (or using the buffer
+     * in place) */
+    if((signal = pyToMatrix(matrix_py, &rows, &cols, &mat, &view)))
+        return raiseSignal(signal);
+
+    /* Anything printed by Python so far goes first */
+    sys_stdout = PySys_GetObject("stdout"); /* borrowed */
+    if(NULL != sys_stdout && sys_stdout != Py_None) {
+        if(NULL == (flushed = PyObject_CallMethod(sys_stdout, "flush", NULL))) {
+            signal = PY_ERROR;
+            goto done;
         }
+        Py_DECREF(flushed);
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    signal = writer_matrix_rows(mat, fd);
+    Py_END_ALLOW_THREADS
+
+done:
+    if(NULL == view.obj)
+        matrix_free(mat);
+    PyBuffer_Release(&view);
+
+    if(signal)
+        return raiseSignal(signal);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *submit(PyObject *self, PyObject *args) {
+    goal_job_t *job;
+    JobObject *obj;
+    PyObject *data_py;
+    const char *goal;
+    matrix_t points;
+    Py_buffer view;
+    Py_ssize_t K_py;
+    size_t K, rows = 0, cols = 0;
+    int signal;
+
+    /* Fetching Arguments from Python */
+    if(!PyArg_ParseTuple(args, "nsO", &K_py, &goal, &data_py))
+        return NULL;
+    if((signal = pyToSize(K_py, "K", &K)))
+        return raiseSignal(signal);
+
+    /* The pool is started by the first submission */
+    if(!goalPoolStarted) {
+        if((signal = jobs_pool_init(&goalPool, 0)))
+            return raiseSignal(signal);
+        goalPoolStarted = true;
+        Py_AtExit(stopGoalPool);
+    }
 
-        /* Parsing the list into an array of doubles and storing it as a
-         * datapoints in the datapoints array */
-        if((signal = listToArray_D(tmpItem, dim, &datapoints[i].data)))
+    /* The job holds copies of its arguments, as it outlives this call */
+    if(NULL == (job = calloc(1, sizeof(*job))))
+        return raiseSignal(BAD_ALLOC);
+    spkmeans_ctx_init(&job->ctx);
+    job->ctx.K = K;
+    job->points.data = NULL;
+    job->output.data = NULL;
+    job->refs = 1; /* the Job object (the task holds another reference) */
+    jobs_event_init(&job->done);
+
+    signal = BAD_ALLOC;
+    if(NULL == (job->goal = copyString(goal)))
+        goto error;
+    job->ctx.goal = job->goal;
+
+    /* Either an input file, or datapoints (a buffer is copied, since the job
+     * may outlive it) */
+    if(PyUnicode_Check(data_py)) {
+        const char *infile = PyUnicode_AsUTF8(data_py);
+
+        if(NULL == infile) {
+            signal = PY_ERROR;
             goto error;
+        }
+        if(NULL == (job->infile = copyString(infile)))
+            goto error;
+    } else {
+        if((signal = pyToMatrix(data_py, &rows, &cols, &points, &view)))
+            goto error;
+
+        if(NULL != view.obj) {
+            signal = matrix_clone(points, &job->points);
+            PyBuffer_Release(&view);
+            if(signal)
+                goto error;
+        } else {
+            job->points = points;
+        }
+    }
+
+    job->refs = 2;
+    if(jobs_pool_submit(&goalPool, goalJobRun, job)) {
+        job->refs = 1;
+        signal = BAD_ALLOC;
+        goto error;
     }
 
-    /* Parsing the initial centroids indices array: extracting the list from
-     * python into the array */
-    if((signal = listToArray_L(initial_centroids_indices_py, K,
-                               &initial_centroids_indices)))
-        goto error;
+    if(NULL == (obj = PyObject_New(JobObject, JobType))) {
+        goalJobRelease(job);
+        return NULL;
+    }
+    obj->job = job;
+    obj->result = NULL;
+
+    return (PyObject *)obj;
+
+error:
+    goalJobRelease(job);
+    return raiseSignal(signal);
+}
+
+static PyObject *wait_jobs(PyObject *self, PyObject *args) {
+    PyObject *jobs_py, *jobs_fast, *py_output;
+    Py_ssize_t i, n;
+
+    /* Fetching Arguments from Python */
+    if(!PyArg_ParseTuple(args, "O", &jobs_py))
+        return NULL;
+
+    if(NULL == (jobs_fast = PySequence_Fast(jobs_py, "Expected a list of Jobs")))
+        return NULL;
+    n = PySequence_Fast_GET_SIZE(jobs_fast);
+
+    if(NULL == (py_output = PyList_New(n))) {
+        Py_DECREF(jobs_fast);
+        return NULL;
+    }
+
+    /* Wait for the jobs in order: by the time the last one is done, the
+     * others had all the time they needed */
+    for(i = 0; i < n; i++) {
+        PyObject *item = PySequence_Fast_GET_ITEM(jobs_fast, i), *result;
+
+        if(Py_TYPE(item) != JobType) {
+            PyErr_SetString(PyExc_TypeError, "Expected a list of Jobs");
+            result = NULL;
+        } else {
+            result = jobResult((JobObject *)item, -1);
+        }
+
+        if(NULL == result) {
+            Py_DECREF(py_output);
+            Py_DECREF(jobs_fast);
+            return NULL;
+        }
+        PyList_SET_ITEM(py_output, i, result);
+    }
+
+    Py_DECREF(jobs_fast);
+    return py_output;
+}
+
+static PyObject *memory_stats(PyObject *self, PyObject *args) {
+    PyObject *stages, *py_output;
+    arena_t *arena;
+    int reset = 0;
+    size_t i;
+
+    /* Fetching Arguments from Python */
+    if(!PyArg_ParseTuple(args, "|p", &reset))
+        return NULL;
+
+    if(NULL == (arena = arena_thread()))
+        return PyErr_NoMemory();
+
+    if(NULL == (stages = PyDict_New()))
+        return NULL;
+    for(i = 0; i < arena->n_stages; i++) {
+        PyObject *stage = Py_BuildValue("{s:n,s:n}", "current",
+                                        (Py_ssize_t)arena->stages[i].current,
+                                        "peak",
+                                        (Py_ssize_t)arena->stages[i].peak);
+
+        if(NULL == stage ||
+           PyDict_SetItemString(stages, arena->stages[i].name, stage))
+        {
+            Py_XDECREF(stage);
+            Py_DECREF(stages);
+            return NULL;
+        }
+        Py_DECREF(stage);
+    }
+
+    py_output = Py_BuildValue("{s:n,s:n,s:n,s:N}", "current",
+                              (Py_ssize_t)arena->current, "peak",
+                              (Py_ssize_t)arena->peak, "reserved",
+                              (Py_ssize_t)arena->reserved, "stages", stages);
+    if(reset) {
+        arena_reset_stats(arena);
+    }
+
+    return py_output;
+}
+
+static PyObject *backend(PyObject *self, PyObject *args) {
+    const char *name = NULL;
+
+    /* Fetching Arguments from Python */
+    if(!PyArg_ParseTuple(args, "|z", &name))
+        return NULL;
+
+    if(NULL != name && backend_select(name)) {
+        PyErr_Format(PyExc_ValueError, "Unknown backend: '%s'", name);
+        return NULL;
+    }
+
+    return PyUnicode_FromString(backend_current()->name);
+}
+
+static PyObject *isa(PyObject *self, PyObject *args) {
+    const isa_kernels_t *kernels = isa_kernels();
+
+    return Py_BuildValue("{s:s,s:s,s:O}", "level", kernels->name, "detected",
+                         isa_name(isa_detect()), "forced",
+                         isa_forced() ? Py_True : Py_False);
+}
+
+static PyObject *memory_plan(PyObject *self, PyObject *args) {
+    const char *goal;
+    Py_ssize_t num_data, dim;
+    PyObject *limit;
+    budget_plan_t plan;
+    int signal;
+
+    /* Fetching Arguments from Python */
+    if(!PyArg_ParseTuple(args, "snn", &goal, &num_data, &dim))
+        return NULL;
+    if(num_data < 0 || dim < 0)
+        return raiseSignal(BAD_INPUT);
+
+    signal = budget_plan(goal, (size_t)num_data, (size_t)dim, &plan);
+
+    if(0 == plan.limit) {
+        Py_INCREF(Py_None);
+        limit = Py_None;
+    } else if(NULL == (limit = PyLong_FromSize_t(plan.limit))) {
+        return NULL;
+    }
+
+    return Py_BuildValue("{s:n,s:N,s:O,s:s,s:O}", "estimate",
+                         (Py_ssize_t)plan.estimate, "budget", limit, "fits",
+                         (0 == signal) ? Py_True : Py_False, "eigen",
+                         plan.jacobi_only ? "jacobi" : plan.backend->name,
+                         "out_of_core",
+                         plan.out_of_core ? Py_True : Py_False);
+}
+
+static PyObject *last_profile(PyObject *self, PyObject *args) {
+    PyObject *phases, *reassigned;
+    profile_t profile;
+    size_t i, iterations;
+    double total = 0.0;
+
+    if(profile_last(&profile))
+        Py_RETURN_NONE;
+
+    if(NULL == (phases = PyDict_New()))
+        return NULL;
+    for(i = 0; i < profile.n_phases; i++) {
+        PyObject *phase = Py_BuildValue("{s:d,s:n}", "seconds",
+                                        profile.phases[i].seconds, "bytes",
+                                        (Py_ssize_t)profile.phases[i].bytes);
+
+        if(NULL == phase ||
+           PyDict_SetItemString(phases, profile.phases[i].name, phase))
+        {
+            Py_XDECREF(phase);
+            Py_DECREF(phases);
+            return NULL;
+        }
+        Py_DECREF(phase);
+        total += profile.phases[i].seconds;
+    }
+
+    iterations = (profile.kmeans_iterations > PROFILE_MAX_ITERATIONS)
+                     ? PROFILE_MAX_ITERATIONS
+                     : profile.kmeans_iterations;
+    if(NULL == (reassigned = PyList_New((Py_ssize_t)iterations))) {
+        Py_DECREF(phases);
+        return NULL;
+    }
+    for(i = 0; i < iterations; i++) {
+        PyObject *count = PyLong_FromSize_t(profile.reassigned[i]);
+
+        if(NULL == count) {
+            Py_DECREF(phases);
+            Py_DECREF(reassigned);
+            return NULL;
+        }
+        PyList_SET_ITEM(reassigned, i, count); /* steals the reference */
+    }
+
+    return Py_BuildValue(
+        "{s:N,s:d,s:{s:n,s:d},s:{s:n,s:N}}", "phases", phases, "seconds",
+        total, "jacobi", "rotations", (Py_ssize_t)profile.jacobi_rotations,
+        "off_norm", profile.jacobi_off_norm, "kmeans", "iterations",
+        (Py_ssize_t)profile.kmeans_iterations, "reassigned", reassigned);
+}
+/**************************************************************************/
+
+/***************************** Generic C API Functions
+ * ***************************/
+
+/* This parses the given Python arguments into C-represented Objects + manage
+ * Reference counts of Py args. The datapoints (along with their amount and
+ * dimension, and K) are stored in <ctx> (a buffer of doubles is used in place,
+ * and held by <view>, which the caller releases after freeing the context),
+ * and the initial centroids indices in
+ * a newly allocated array stored in <initial_centroids_indices>.
+ * The optional keyword arguments (batch_size, max_iter, tol, seed, n_init,
+ * n_threads) are stored into <config>, return_runs into <return_runs> and
+ * outfile into <outfile> (NULL unless given).
+ * Returns 0 on success, and an error signal on failure. Whatever was already
+ * parsed is left to the caller to free (even on failure). */
+static int py_kmeans_parse_args(PyObject *args, PyObject *kwargs,
+                                spkmeans_ctx_t *ctx, Py_buffer *view,
+                                size_t **initial_centroids_indices,
+                                kmeans_config_t *config, int *return_runs,
+                                const char **outfile) {
+    static char *kwlist[] = {"datapoints", "num_data", "dim",
+                             "initial_centroids_indices", "K", "batch_size",
+                             "max_iter", "tol", "seed", "n_init", "n_threads",
+                             "return_runs", "outfile", NULL};
+    size_t num_data;
+    Py_ssize_t num_data_py, dim_py, K_py;
+    PyObject *datapoints_py = NULL;
+    PyObject *initial_centroids_indices_py = NULL;
+    matrix_t points;
+    py_counts_t counts;
+    int signal;
+
+    *config = kmeans_default_config();
+    counts = pyCountsOf(*config);
+
+    /* Fetching Arguments from Python (borrowed references) */
+    if(!PyArg_ParseTupleAndKeywords(
+           args, kwargs, "OnnOn|nndknnpz", kwlist, &datapoints_py,
+           &num_data_py, &dim_py, &initial_centroids_indices_py, &K_py,
+           &counts.batch_size, &counts.max_iter, &config->tol, &config->seed,
+           &counts.n_init, &counts.n_threads, return_runs, outfile))
+        return PY_ERROR;
+    if((signal = pyToSize(num_data_py, "num_data", &num_data)) ||
+       (signal = pyToSize(dim_py, "dim", &ctx->dim)) ||
+       (signal = pyToSize(K_py, "K", &ctx->K)) ||
+       (signal = pyToConfig(counts, config)))
+        return signal;
+
+    if(num_data == 0 || ctx->dim == 0)
+        return BAD_INPUT;
+
+    /* Parsing the datapoints into a single contiguous matrix (or using the
+     * buffer in place), whose rows are the datapoints of the context */
+    if((signal = pyToMatrix(datapoints_py, &num_data, &ctx->dim, &points,
+                            view)))
+        return signal;
+    if((signal = spkmeans_use_points(ctx, points, NULL != view->obj)))
+        return signal;
+
+    /* Parsing the initial centroids indices array: extracting the list from
+     * python into the array */
+    return listToArray_L(initial_centroids_indices_py, ctx->K,
+                         initial_centroids_indices);
+}
+
+/* Returns the counts of the given configuration, as they're parsed */
+static py_counts_t pyCountsOf(kmeans_config_t config) {
+    py_counts_t counts;
+
+    counts.batch_size = (Py_ssize_t)config.batch_size;
+    counts.max_iter = (Py_ssize_t)config.max_iter;
+    counts.n_init = (Py_ssize_t)config.n_init;
+    counts.n_threads = (Py_ssize_t)config.n_threads;
+    return counts;
+}
+
+/* Stores the given parsed counts into <config>. Returns BAD_INPUT (with a
+ * ValueError that names the count) in case any of them is negative. */
+static int pyToConfig(py_counts_t counts, kmeans_config_t *config) {
+    int signal;
+
+    if((signal = pyToSize(counts.batch_size, "batch_size",
+                          &config->batch_size)) ||
+       (signal = pyToSize(counts.max_iter, "max_iter", &config->max_iter)) ||
+       (signal = pyToSize(counts.n_init, "n_init", &config->n_init)) ||
+       (signal = pyToSize(counts.n_threads, "n_threads", &config->n_threads)))
+        return signal;
 
     return 0;
+}
 
-error:
-    /* if any of the CPython functions fail:
-     * An error of py_parse_args doesn't trigger the free_program,
-     * since the program hasn't advanced enough, therefore we free datapoints +
-     * initial_centroids_indices here */
-    if(datapoints != NULL) {
-        for(i = 0; i < num_data; i++) {
-            free_datapoint(datapoints[i]);
-        }
-        free(datapoints_arg);
+/* Stores the given parsed count into <output>. Returns BAD_INPUT (with a
+ * ValueError that names the count, <name>) in case it's negative. */
+static int pyToSize(Py_ssize_t value, const char *name, size_t *output) {
+    if(value < 0) {
+        PyErr_Format(PyExc_ValueError, "%s must not be negative", name);
+        return BAD_INPUT;
     }
 
-    Py_XDECREF(datapoints_py);
-    Py_XDECREF(initial_centroids_indices_py);
-    return signal;
+    *output = (size_t)value;
+    return 0;
 }
 
 /* This builds a PyList out of an existing matrix.
@@ -204,18 +1032,28 @@ error:
     return PY_ERROR;
 }
 
-/* This parses a python Floats' List into a C Double's array
+/* This parses a python Integers' List into a C Long's array
  * No need to worry about reference counts, it's managed by py_parse_args(). */
-static int listToArray_D(PyObject *list, size_t length, double **output) {
+static int listToArray_L(PyObject *list, size_t length, size_t **output) {
     size_t i;
     PyObject *pypoint = NULL;
     int signal;
 
-    /* first check if the given PyObject is indeed a list */
+    *output = NULL;
+
+    /* first check if the given PyObject is indeed a list, of <length>
+     * indices at least */
     if(!PyList_Check(list)) {
         signal = PY_ERROR;
         goto error;
     }
+    if((size_t)PyList_GET_SIZE(list) < length) {
+        PyErr_Format(PyExc_ValueError,
+                     "initial_centroids_indices must have %zu indices",
+                     length);
+        signal = BAD_INPUT;
+        goto error;
+    }
 
     /* Initialize the array */
     (*output) = calloc(length, sizeof(**output));
@@ -226,13 +1064,21 @@ static int listToArray_D(PyObject *list, size_t length, double **output) {
 
     /* Insert the data into the array */
     for(i = 0; i < length; ++i) {
+        Py_ssize_t index;
+
         /* PyList_GetItem returns a borrowed reference - no need to Py_DECREF */
         pypoint = PyList_GetItem(list, (Py_ssize_t)i);
-        if(!PyFloat_Check(pypoint)) {
+        if(!PyLong_Check(pypoint)) {
             signal = PY_ERROR;
             goto error;
         }
-        (*output)[i] = (double)PyFloat_AsDouble(pypoint);
+        if(-1 == (index = PyLong_AsSsize_t(pypoint)) && PyErr_Occurred()) {
+            signal = PY_ERROR;
+            goto error;
+        }
+        if((signal = pyToSize(index, "an initial centroid index",
+                              &(*output)[i])))
+            goto error;
     }
 
     return 0;
@@ -240,69 +1086,810 @@ static int listToArray_D(PyObject *list, size_t length, double **output) {
 error:
     if(NULL != (*output))
         free(*output);
+    *output = NULL;
     return signal;
 }
 
-/* This parses a python Integers' List into a C Long's array
- * No need to worry about reference counts, it's managed by py_parse_args(). */
-static int listToArray_L(PyObject *list, size_t length, size_t **output) {
+/* This builds a PyList of dicts (seed, iterations, inertia) out of the
+ * reports of the kmeans runs. Creates an untracked reference. */
+static int reportsToList(const kmeans_report_t *reports, size_t length,
+                         PyObject **output) {
     size_t i;
-    PyObject *pypoint = NULL;
-    int signal;
+
+    if(NULL == (*output = PyList_New(length)))
+        return PY_ERROR;
+
+    for(i = 0; i < length; i++) {
+        PyObject *report = Py_BuildValue(
+            "{s:k,s:n,s:d}", "seed", reports[i].seed, "iterations",
+            (Py_ssize_t)reports[i].iterations, "inertia", reports[i].inertia);
+
+        if(NULL == report) {
+            Py_DECREF(*output);
+            return PY_ERROR;
+        }
+        PyList_SET_ITEM(*output, (Py_ssize_t)i, report);
+    }
+
+    return 0;
+}
+
+/* This parses a python List of Floats' Lists into a newly allocated matrix,
+ * whose rows are stored contiguously.
+ * No need to worry about reference counts, all of the references are
+ * borrowed. */
+static int listToMatrix(PyObject *list, size_t rows, size_t cols,
+                        matrix_t *output) {
+    size_t i, j;
+
+    output->data = NULL;
 
     /* first check if the given PyObject is indeed a list */
-    if(!PyList_Check(list)) {
-        signal = PY_ERROR;
+    if(!PyList_Check(list) || (size_t)PyList_Size(list) < rows)
         goto error;
-    }
 
-    /* Initialize the array */
-    (*output) = calloc(length, sizeof(**output));
-    if(NULL == (*output)) {
-        signal = BAD_ALLOC;
+    if(matrix_new(rows, cols, output))
         goto error;
-    }
 
-    /* Insert the data into the array */
-    for(i = 0; i < length; ++i) {
+    for(i = 0; i < rows; i++) {
         /* PyList_GetItem returns a borrowed reference - no need to Py_DECREF */
-        pypoint = PyList_GetItem(list, (Py_ssize_t)i);
-        if(!PyLong_Check(pypoint)) {
-            signal = PY_ERROR;
+        PyObject *row = PyList_GetItem(list, (Py_ssize_t)i);
+
+        if(!PyList_Check(row) || (size_t)PyList_Size(row) < cols)
             goto error;
+
+        for(j = 0; j < cols; j++) {
+            PyObject *pypoint = PyList_GetItem(row, (Py_ssize_t)j);
+            if(!PyFloat_Check(pypoint))
+                goto error;
+            matrix_set(*output, i, j, PyFloat_AsDouble(pypoint));
         }
-        (*output)[i] = (size_t)PyLong_AsLong(pypoint);
     }
 
     return 0;
 
 error:
-    if(NULL != (*output))
-        free(*output);
-    return signal;
+    matrix_free_safe(*output);
+    output->data = NULL;
+    return PY_ERROR;
+}
+
+/* This moves the given matrix into a new Matrix object (the matrix is owned
+ * by the object from now on, and <mat> holds a `data` field of NULL).
+ * Creates an untracked reference. */
+static int matrixToObject(matrix_t *mat, PyObject **output) {
+    MatrixObject *obj = PyObject_New(MatrixObject, MatrixType);
+
+    if(NULL == (*output = (PyObject *)obj))
+        return PY_ERROR;
+
+    /* The buffer of the object is C-contiguous */
+    matrix_compact(mat);
+    obj->mat = *mat;
+    obj->shape[0] = (Py_ssize_t)mat->rows;
+    obj->shape[1] = (Py_ssize_t)mat->cols;
+    obj->strides[0] = (Py_ssize_t)(mat->cols * sizeof(double));
+    obj->strides[1] = (Py_ssize_t)sizeof(double);
+    mat->data = NULL;
+
+    return 0;
+}
+
+/* This gets a matrix of doubles out of the given object: either an object
+ * supporting the buffer protocol (a C-contiguous 2-dimensional buffer of
+ * doubles, e.g. a NumPy array of float64 or a Matrix), which is used in place
+ * and held by <view>, or a List of Floats' Lists, which is copied into a newly
+ * allocated matrix (and the `obj` field of <view> is NULL).
+ * The first <rows> rows of the object are used, and each of them must have
+ * <cols> values. A <rows> or <cols> of 0 is deduced from the object (its
+ * amount of rows, the length of its first row).
+ * No need to worry about reference counts, besides releasing <view>. */
+static int pyToMatrix(PyObject *obj, size_t *rows, size_t *cols,
+                      matrix_t *output, Py_buffer *view) {
+    output->data = NULL;
+    view->obj = NULL;
+
+    if(PyList_Check(obj)) {
+        PyObject *first;
+
+        if(*rows == 0) {
+            *rows = (size_t)PyList_Size(obj);
+        }
+        if(*cols == 0 && PyList_Size(obj) > 0 &&
+           PyList_Check(first = PyList_GetItem(obj, 0)))
+        {
+            *cols = (size_t)PyList_Size(first);
+        }
+        if(*rows == 0 || *cols == 0) {
+            PyErr_SetString(PyExc_TypeError,
+                            "Expected a non-empty list of lists of floats");
+            return PY_ERROR;
+        }
+        return listToMatrix(obj, *rows, *cols, output);
+    }
+
+    if(!PyObject_CheckBuffer(obj) ||
+       PyObject_GetBuffer(obj, view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT))
+    {
+        PyErr_Clear();
+        view->obj = NULL;
+        PyErr_SetString(PyExc_TypeError,
+                        "Expected a C-contiguous buffer of float64 values, or "
+                        "a list of lists of floats");
+        return PY_ERROR;
+    }
+
+    if(view->ndim != 2 || view->itemsize != sizeof(double) ||
+       !isDoubleFormat(view->format) || view->shape[0] == 0 ||
+       view->shape[1] == 0 || (*rows != 0 && (size_t)view->shape[0] < *rows) ||
+       (*cols != 0 && (size_t)view->shape[1] != *cols))
+    {
+        PyBuffer_Release(view);
+        PyErr_SetString(PyExc_ValueError,
+                        "Expected a non-empty 2-dimensional buffer of float64 "
+                        "values, of the given shape");
+        return PY_ERROR;
+    }
+
+    if(*rows == 0) {
+        *rows = (size_t)view->shape[0];
+    }
+    *cols = (size_t)view->shape[1];
+
+    output->data = (double *)view->buf;
+    output->rows = *rows;
+    output->cols = *cols;
+    output->len = *rows * *cols;
+    output->stride = *cols;
+
+    return 0;
+}
+
+/* This checks whether the given struct-module format of a buffer describes
+ * native doubles */
+static int isDoubleFormat(const char *format) {
+    const unsigned int one = 1;
+    char native = (*(const char *)&one == 1) ? '<' : '>';
+
+    if(NULL == format) /* unsigned bytes, by the buffer protocol */
+        return false;
+    if(*format == '@' || *format == '=' || *format == native) {
+        format++;
+    }
+    return strcmp(format, "d") == 0;
+}
+
+/* This sets the Python exception matching the error signal of a goal, like
+ * raiseSignal does, while pointing at the malformed row of its input file (if
+ * there's one, and unless <infile> is NULL). Returns NULL */
+static PyObject *raiseGoalSignal(int signal, const char *infile,
+                                 loader_error_t error,
+                                 const budget_plan_t *plan) {
+    if(signal == BAD_INPUT && NULL != infile && 0 != error.line &&
+       !PyErr_Occurred())
+    {
+        return PyErr_Format(PyExc_ValueError, "%s (%s:%zu: %s)",
+                            spkmeans_strerror(signal), infile, error.line,
+                            error.reason);
+    }
+    if(signal == BAD_ALLOC && NULL != plan && budget_exceeded(plan) &&
+       !PyErr_Occurred())
+    {
+        const char *estimate_unit, *limit_unit;
+        size_t estimate = budget_scale(plan->estimate, &estimate_unit);
+        size_t limit = budget_scale(plan->limit, &limit_unit);
+
+        return PyErr_Format(PyExc_MemoryError,
+                            "%s of %zu datapoints needs about %zu %s, over "
+                            "the memory budget of %zu %s",
+                            plan->goal, plan->num_data, estimate,
+                            estimate_unit, limit, limit_unit);
+    }
+    return raiseSignal(signal);
+}
+
+/* This sets the Python exception matching the given error signal (unless
+ * one has already been set by a CPython function), and returns NULL */
+static PyObject *raiseSignal(int signal) {
+    if(PyErr_Occurred())
+        return NULL;
+
+    switch(signal) {
+    case BAD_ALLOC:
+        return PyErr_NoMemory();
+    case BAD_INPUT:
+        PyErr_SetString(PyExc_ValueError, spkmeans_strerror(signal));
+        return NULL;
+    case PY_ERROR:
+        PyErr_SetString(PyExc_TypeError, "Invalid arguments");
+        return NULL;
+    case BAD_OUTPUT:
+        PyErr_SetString(PyExc_OSError, "Failed writing the output");
+        return NULL;
+    default:
+        PyErr_SetString(PyExc_RuntimeError, spkmeans_strerror(signal));
+        return NULL;
+    }
+}
+/**************************************************************************/
+
+/**************************************************************************/
+
+/***************************** The Matrix Type
+ * ***************************/
+static void Matrix_dealloc(MatrixObject *self) {
+    PyTypeObject *type = Py_TYPE(self);
+
+    matrix_free_safe(self->mat);
+    PyObject_Free(self);
+    Py_DECREF(type); /* instances of heap types own a reference to them */
+}
+
+/* Exports the whole matrix as a C-contiguous 2-dimensional buffer of doubles
+ * (or as plain bytes, for consumers that don't ask for its shape) */
+static int Matrix_getbuffer(MatrixObject *self, Py_buffer *view, int flags) {
+    view->obj = (PyObject *)self;
+    Py_INCREF(self);
+
+    view->buf = self->mat.data;
+    view->len = self->shape[0] * self->strides[0];
+    view->readonly = 0;
+    view->itemsize = sizeof(double);
+    view->format = (flags & PyBUF_FORMAT) ? (char *)"d" : NULL;
+    view->ndim = (flags & PyBUF_ND) ? 2 : 1;
+    view->shape = (flags & PyBUF_ND) ? self->shape : NULL;
+    view->strides =
+        ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? self->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+
+    return 0;
+}
+
+static Py_ssize_t Matrix_length(MatrixObject *self) {
+    return self->shape[0];
+}
+
+/* Builds the i-th row as a list of floats */
+static PyObject *Matrix_item(MatrixObject *self, Py_ssize_t i) {
+    PyObject *row, *pyfloat;
+    Py_ssize_t j;
+
+    if(i < 0 || i >= self->shape[0]) {
+        PyErr_SetString(PyExc_IndexError, "Matrix index out of range");
+        return NULL;
+    }
+
+    if(NULL == (row = PyList_New(self->shape[1])))
+        return NULL;
+
+    for(j = 0; j < self->shape[1]; j++) {
+        if(NULL == (pyfloat = PyFloat_FromDouble(
+                        matrix_get(self->mat, (size_t)i, (size_t)j))))
+        {
+            Py_DECREF(row);
+            return NULL;
+        }
+        PyList_SET_ITEM(row, j, pyfloat);
+    }
+
+    return row;
+}
+
+static PyObject *Matrix_tolist(MatrixObject *self, PyObject *unused) {
+    PyObject *py_output;
+
+    if(matrixToList(self->mat, &py_output))
+        return NULL;
+    return py_output;
+}
+
+static PyObject *Matrix_shape(MatrixObject *self, void *closure) {
+    return Py_BuildValue("(nn)", self->shape[0], self->shape[1]);
+}
+
+static PyMethodDef matrixMethods[] = {
+    {"tolist", (PyCFunction)Matrix_tolist, METH_NOARGS,
+     PyDoc_STR("Return the matrix as a list of lists of floats")},
+    {NULL, NULL, 0, NULL}};
+
+static PyGetSetDef matrixGetSet[] = {
+    {"shape", (getter)Matrix_shape, NULL,
+     PyDoc_STR("The amount of rows and of columns of the matrix"), NULL},
+    {NULL, NULL, NULL, NULL, NULL}};
+
+static PyType_Slot matrixSlots[] = {
+    {Py_tp_doc,
+     (void *)PyDoc_STR("A matrix of doubles returned by the extension. It "
+                       "supports the buffer protocol (np.asarray(matrix) "
+                       "doesn't copy it), len(), indexing of its rows (as "
+                       "lists of floats) and tolist()")},
+    {Py_tp_dealloc, (void *)Matrix_dealloc},
+    {Py_tp_methods, (void *)matrixMethods},
+    {Py_tp_getset, (void *)matrixGetSet},
+    {Py_sq_length, (void *)Matrix_length},
+    {Py_sq_item, (void *)Matrix_item},
+    {Py_bf_getbuffer, (void *)Matrix_getbuffer},
+    {0, NULL}};
+
+static PyType_Spec matrixSpec = {"spkmeans.Matrix", sizeof(MatrixObject), 0,
+                                 Py_TPFLAGS_DEFAULT, matrixSlots};
+/**************************************************************************/
+
+/***************************** The Job Type
+ * ***************************/
+static void Job_dealloc(JobObject *self) {
+    PyTypeObject *type = Py_TYPE(self);
+
+    Py_XDECREF(self->result);
+    goalJobRelease(self->job);
+    PyObject_Free(self);
+    Py_DECREF(type);
+}
+
+static PyObject *Job_result(JobObject *self, PyObject *args, PyObject *kwargs) {
+    static char *kwlist[] = {"timeout", NULL};
+    PyObject *timeout_py = Py_None;
+    double timeout = -1;
+
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", kwlist, &timeout_py))
+        return NULL;
+
+    if(timeout_py != Py_None) {
+        timeout = PyFloat_AsDouble(timeout_py);
+        if(timeout == -1 && PyErr_Occurred())
+            return NULL;
+        timeout = (timeout < 0) ? 0 : timeout;
+    }
+
+    return jobResult(self, timeout);
+}
+
+static PyObject *Job_done(JobObject *self, PyObject *unused) {
+    return PyBool_FromLong(jobs_event_wait(&self->job->done, 0));
+}
+
+/* Waits (without holding the GIL) for the job to be done, and returns its
+ * result (or raises its error). A negative <timeout> waits for as long as it
+ * takes. */
+static PyObject *jobResult(JobObject *self, double timeout) {
+    goal_job_t *job = self->job;
+    bool done;
+
+    if(NULL != self->result) {
+        Py_INCREF(self->result);
+        return self->result;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    done = jobs_event_wait(&job->done, timeout);
+    Py_END_ALLOW_THREADS
+
+    if(!done) {
+        PyErr_SetString(PyExc_TimeoutError, "The job isn't done yet");
+        return NULL;
+    }
+
+    if(job->signal)
+        return raiseGoalSignal(job->signal, job->infile, job->ctx.error,
+                               &job->ctx.plan);
+
+    /* The result moves into its Matrix, which is kept for the next calls */
+    if(matrixToObject(&job->output, &self->result))
+        return NULL;
+
+    Py_INCREF(self->result);
+    return self->result;
+}
+
+/* The task of a submitted goal, performed by a thread of the pool */
+static void goalJobRun(void *arg) {
+    goal_job_t *job = (goal_job_t *)arg;
+
+    if(NULL != job->infile) {
+        job->signal = spkmeans_pass_goal_info_and_run(&job->ctx, job->infile,
+                                                      &job->output);
+    } else {
+        /* The context owns the datapoints from now on */
+        job->signal = spkmeans_pass_goal_points_and_run(
+            &job->ctx, job->points, false, &job->output);
+        job->points.data = NULL;
+    }
+    spkmeans_ctx_free(&job->ctx); /* its error is still described */
+
+    jobs_event_set(&job->done);
+    goalJobRelease(job);
+}
+
+static void goalJobRelease(goal_job_t *job) {
+    bool last;
+
+    pthread_mutex_lock(&job->done.lock);
+    last = (--job->refs == 0);
+    pthread_mutex_unlock(&job->done.lock);
+
+    if(!last)
+        return;
+
+    spkmeans_ctx_free(&job->ctx);
+    matrix_free_safe(job->points);
+    matrix_free_safe(job->output);
+    if(NULL != job->goal)
+        free(job->goal);
+    if(NULL != job->infile)
+        free(job->infile);
+    jobs_event_destroy(&job->done);
+    free(job);
+}
+
+static char *copyString(const char *string) {
+    char *copy = malloc(strlen(string) + 1);
+
+    if(NULL != copy) {
+        strcpy(copy, string);
+    }
+    return copy;
+}
+
+/* Performs the goals that are still queued, and stops the pool (called once
+ * the interpreter exits, hence without the Python API) */
+static void stopGoalPool(void) {
+    jobs_pool_destroy(&goalPool);
+    goalPoolStarted = false;
+}
+
+static PyMethodDef jobMethods[] = {
+    {"result", (PyCFunction)(void (*)(void))Job_result,
+     METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Wait for the job (up to <timeout> seconds, if it's given) "
+               "and return its result as a Matrix, or raise its error. "
+               "Raises TimeoutError if the job isn't done by then")},
+    {"done", (PyCFunction)Job_done, METH_NOARGS,
+     PyDoc_STR("Return whether the job is done")},
+    {NULL, NULL, 0, NULL}};
+
+static PyType_Slot jobSlots[] = {
+    {Py_tp_doc,
+     (void *)PyDoc_STR("The future of a goal submitted with spkmeans.submit, "
+                       "performed by the native thread pool of the module")},
+    {Py_tp_dealloc, (void *)Job_dealloc},
+    {Py_tp_methods, (void *)jobMethods},
+    {0, NULL}};
+
+static PyType_Spec jobSpec = {"spkmeans.Job", sizeof(JobObject), 0,
+                              Py_TPFLAGS_DEFAULT, jobSlots};
+/**************************************************************************/
+
+/***************************** The Model Type
+ * ***************************/
+static void Model_dealloc(ModelObject *self) {
+    PyTypeObject *type = Py_TYPE(self);
+
+    model_free(&self->model);
+    PyObject_Free(self);
+    Py_DECREF(type);
+}
+
+/* Assigns every given datapoint (without holding the GIL), and returns the
+ * list of their labels */
+static PyObject *Model_predict(ModelObject *self, PyObject *args) {
+    PyObject *points_py, *py_labels = NULL;
+    size_t rows = 0, cols = 0, i, *labels;
+    matrix_t points;
+    Py_buffer view;
+    int signal;
+
+    /* Fetching Arguments from Python */
+    if(!PyArg_ParseTuple(args, "O", &points_py))
+        return NULL;
+
+    if((signal = pyToMatrix(points_py, &rows, &cols, &points, &view)))
+        return raiseSignal(signal);
+
+    if(NULL == (labels = malloc(rows * sizeof(*labels)))) {
+        signal = BAD_ALLOC;
+        goto done;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    signal = model_predict(&self->model, points, labels);
+    Py_END_ALLOW_THREADS
+    if(signal)
+        goto done;
+
+    signal = PY_ERROR;
+    if(NULL == (py_labels = PyList_New(rows)))
+        goto done;
+    for(i = 0; i < rows; i++) {
+        PyObject *pylabel = PyLong_FromSize_t(labels[i]);
+        if(NULL == pylabel) {
+            Py_CLEAR(py_labels);
+            goto done;
+        }
+        PyList_SET_ITEM(py_labels, (Py_ssize_t)i, pylabel);
+    }
+    signal = 0;
+
+done:
+    if(NULL != labels)
+        free(labels);
+    if(NULL == view.obj)
+        matrix_free(points);
+    PyBuffer_Release(&view);
+
+    if(signal)
+        return raiseSignal(signal);
+    return py_labels;
+}
+
+static PyObject *Model_save(ModelObject *self, PyObject *args) {
+    const char *filename;
+    int signal;
+
+    /* Fetching Arguments from Python */
+    if(!PyArg_ParseTuple(args, "s", &filename))
+        return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    signal = model_save(&self->model, filename);
+    Py_END_ALLOW_THREADS
+
+    if(signal)
+        return raiseSignal(signal);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *Model_K(ModelObject *self, void *closure) {
+    return PyLong_FromSize_t(self->model.K);
+}
+
+/* Builds a Matrix out of a copy of the centroids (the model keeps its own) */
+static PyObject *Model_centroids(ModelObject *self, void *closure) {
+    PyObject *py_centroids;
+    matrix_t centroids;
+
+    if(matrix_clone(self->model.centroids, &centroids))
+        return PyErr_NoMemory();
+    if(matrixToObject(&centroids, &py_centroids)) {
+        matrix_free(centroids);
+        return NULL;
+    }
+    return py_centroids;
+}
+
+/* This moves the given model into a new Model object (or frees it, in case
+ * the object can't be created) */
+static PyObject *modelToObject(model_t *model) {
+    ModelObject *obj = PyObject_New(ModelObject, ModelType);
+
+    if(NULL == obj) {
+        model_free(model);
+        return NULL;
+    }
+
+    obj->model = *model;
+    model_init(model);
+    return (PyObject *)obj;
 }
+
+static PyMethodDef modelMethods[] = {
+    {"predict", (PyCFunction)Model_predict, METH_VARARGS,
+     PyDoc_STR("Given datapoints (a list of lists of floats, or a "
+               "C-contiguous buffer of float64 values used without copying) "
+               "of the dimension of the model, return the list of the indices "
+               "of their clusters. Each datapoint is embedded by the Nystrom "
+               "extension of the eigen vectors of the model, and assigned to "
+               "its closest centroid")},
+    {"save", (PyCFunction)Model_save, METH_VARARGS,
+     PyDoc_STR("Save the model into the given file (see "
+               "spkmeans.load_model)")},
+    {NULL, NULL, 0, NULL}};
+
+static PyGetSetDef modelGetSet[] = {
+    {"K", (getter)Model_K, NULL, PyDoc_STR("The amount of clusters"), NULL},
+    {"centroids", (getter)Model_centroids, NULL,
+     PyDoc_STR("A copy of the final centroids, as a Matrix"), NULL},
+    {NULL, NULL, NULL, NULL, NULL}};
+
+static PyType_Slot modelSlots[] = {
+    {Py_tp_doc,
+     (void *)PyDoc_STR("A spectral clustering model fitted by spkmeans.fit (or "
+                       "loaded by spkmeans.load_model), which assigns new "
+                       "datapoints to its clusters")},
+    {Py_tp_dealloc, (void *)Model_dealloc},
+    {Py_tp_methods, (void *)modelMethods},
+    {Py_tp_getset, (void *)modelGetSet},
+    {0, NULL}};
+
+static PyType_Spec modelSpec = {"spkmeans.Model", sizeof(ModelObject), 0,
+                                Py_TPFLAGS_DEFAULT, modelSlots};
 /**************************************************************************/
 
 /**************************************************************************/
 static PyMethodDef capiMethods[] = {
     {"goal", (PyCFunction)run_goal, METH_VARARGS,
-     PyDoc_STR("Perform the wanted operations on the given datapoints, "
-               "corresponding to the determined 'goal'")},
-    {"kmeans_fit", (PyCFunction)kmeans_fit, METH_VARARGS,
-     PyDoc_STR("Given a set of datapoints, an array of the indices of the "
+     PyDoc_STR("Perform the wanted operations on the given datapoints (an "
+               "input file, a C-contiguous buffer of float64 values used "
+               "without copying, or a list of lists of floats), "
+               "corresponding to the determined 'goal', and return the result "
+               "as a Matrix (see spkmeans.Matrix). If an output file is given "
+               "(.csv/.txt for text, .bin/.npy for the raw doubles), the "
+               "result is written into it and None is returned")},
+    {"kmeans_fit", (PyCFunction)(void (*)(void))kmeans_fit,
+     METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Given a set of datapoints (a list of lists of floats, or a "
+               "C-contiguous buffer of float64 values used without copying), "
+               "an array of the indices of the "
                "initial centroids (induced from kmeans++'s first step), "
-               "perform the kmeans algorithm")},
+               "perform the kmeans algorithm and return the centroids as a "
+               "Matrix. Optional keyword arguments: "
+               "batch_size (0 for full Lloyd iterations, otherwise the size "
+               "of each mini-batch), max_iter, tol, seed (used for "
+               "sampling the mini-batches and seeding the extra runs), n_init "
+               "(amount of independently seeded runs, keeping the one with "
+               "the lowest inertia), n_threads (0 for one per CPU), "
+               "return_runs (also return a list of {seed, iterations, "
+               "inertia} for every run) and outfile (write the centroids into "
+               "it, as goal does, instead of returning them)")},
+    {"kmeanspp", (PyCFunction)kmeanspp, METH_VARARGS,
+     PyDoc_STR("Given a set of datapoints (as kmeans_fit takes them), their "
+               "amount, their dimension, the "
+               "amount of wanted centroids and a seed, pick the indices of the "
+               "initial centroids using kmeans++ (identical to the choices of "
+               "np.random.seed(seed) + np.random.choice)")},
+    {"spk", (PyCFunction)(void (*)(void))spk, METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Given K (0 for the eigengap heuristic) and the datapoints (as "
+               "goal takes them), perform the whole normalized spectral "
+               "clustering in C: T, its kmeans++ seeding (with seed, 0 by "
+               "default) and the kmeans algorithm, on the rows of T in place. "
+               "Return a tuple of the initial centroids indices and the final "
+               "centroids (a Matrix, or None if they were written into "
+               "outfile). The rest of the keyword arguments are those of "
+               "kmeans_fit")},
+    {"fit", (PyCFunction)(void (*)(void))fit, METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Given K and the datapoints (as spk takes them), perform the "
+               "same spectral clustering as spk does, and return it as a "
+               "Model, which keeps the datapoints, their degrees, the "
+               "eigen values and vectors and the centroids, so that new "
+               "datapoints can be assigned (see Model.predict). The rest of "
+               "the keyword arguments are those of kmeans_fit")},
+    {"load_model", (PyCFunction)load_model, METH_VARARGS,
+     PyDoc_STR("Given a file saved by Model.save, load the Model back")},
+    {"convert", (PyCFunction)convert, METH_VARARGS,
+     PyDoc_STR("Given an input file of datapoints (.csv, .txt, .bin or .npy) "
+               "and an output file, save the datapoints into the output file "
+               "in the binary dataset format (.bin) or as a NumPy array "
+               "(.npy), according to its extension")},
+    {"print_matrix", (PyCFunction)print_matrix, METH_VARARGS,
+     PyDoc_STR("Given a matrix (a list of lists of floats, or a buffer of "
+               "float64 values such as a Matrix) and optionally a "
+               "file descriptor (stdout by default), write its rows as lines "
+               "of comma separated values, formatted exactly as '{:.4f}'")},
+    {"submit", (PyCFunction)submit, METH_VARARGS,
+     PyDoc_STR("Given the same arguments as goal (K, goal and an input "
+               "file or datapoints, which are copied), queue the goal on the native thread pool of the "
+               "module (one thread per CPU) and return its Job at once")},
+    {"wait", (PyCFunction)wait_jobs, METH_VARARGS,
+     PyDoc_STR("Given a list of Jobs, wait for all of them (without holding "
+               "the GIL) and return the list of their results, or raise the "
+               "error of the first one that failed")},
+    {"memory_stats", (PyCFunction)memory_stats, METH_VARARGS,
+     PyDoc_STR("Return the accounts of the scratch arena of the calling "
+               "thread, in bytes: current, peak, reserved (the blocks it "
+               "keeps for reuse) and stages ({name: {current, peak}} for "
+               "every stage of the pipeline). The n x n matrices of a run "
+               "are accounted too, while the run holds them (even if they're "
+               "mapped from the scratch directory). If reset is true, the peaks "
+               "start over afterwards. Jobs are accounted to the arenas of "
+               "the threads of the pool, not to the caller's")},
+    {"backend", (PyCFunction)backend, METH_VARARGS,
+     PyDoc_STR("Return the name of the linear algebra backend that's used "
+               "(reference, unless the SPKMEANS_BACKEND environment variable "
+               "names another one). If a name is given, that backend is "
+               "used from now on (not while any job is running), or a "
+               "ValueError is raised if it isn't built in (blas and lapack "
+               "are built in by SPKMEANS_BLAS=1)")},
+    {"isa", (PyCFunction)isa, METH_NOARGS,
+     PyDoc_STR("Return the instruction set of the vectorized kernels, as a "
+               "dict: level (the one that's used), detected (the newest one "
+               "the CPU supports) and forced (whether the SPKMEANS_ISA "
+               "environment variable named the level). Every level computes "
+               "bit-identical results")},
+    {"memory_plan", (PyCFunction)memory_plan, METH_VARARGS,
+     PyDoc_STR("Given a goal (wam, ddg, lnorm, jacobi, spk or fit), an amount "
+               "of datapoints and their dimension, plan the goal within the "
+               "memory budget (the SPKMEANS_MEMORY_BUDGET environment "
+               "variable: an amount of bytes, optionally followed by K, M, G "
+               "or T, or auto for the available memory of the host) and "
+               "return a dict: estimate (the peak, in bytes), budget (None "
+               "if there's none), fits, eigen (the eigen solver that's "
+               "used: the backend's, or jacobi if only it fits) and "
+               "out_of_core (whether the n x n matrices are mapped from files "
+               "of the SPKMEANS_SCRATCH_DIR directory, which they are if "
+               "nothing else fits, or if there's no budget). Goals that "
+               "don't fit raise a MemoryError with their estimate")},
+    {"last_profile", (PyCFunction)last_profile, METH_NOARGS,
+     PyDoc_STR("Return the profile of the last run (a goal, spk, kmeans or "
+               "a model fit) that ended on any thread, as a dict: phases "
+               "({name: {seconds, bytes}}, where bytes were allocated while "
+               "the phase was active), seconds (the whole run), jacobi "
+               "({rotations, off_norm}) and kmeans ({iterations, "
+               "reassigned}, the datapoints reassigned per iteration). "
+               "Returns None if no run was profiled, which needs the "
+               "SPKMEANS_PROFILE environment variable set before the "
+               "import (1 or stderr, or the name of a JSON file)")},
     {NULL, NULL, 0, NULL}};
 
 static struct PyModuleDef moduledef = {PyModuleDef_HEAD_INIT, "spkmeans", NULL,
                                        -1, capiMethods};
 
+/* Creates a type out of the given spec, and adds it to the module under
+ * <name>. Returns NULL on failure. */
+static PyTypeObject *addType(PyObject *m, PyType_Spec *spec, const char *name) {
+    PyTypeObject *type = (PyTypeObject *)PyType_FromSpec(spec);
+
+    if(NULL == type)
+        return NULL;
+
+    /* PyModule_AddObject steals a reference on success only */
+    Py_INCREF(type);
+    if(PyModule_AddObject(m, name, (PyObject *)type)) {
+        Py_DECREF(type);
+        Py_DECREF(type);
+        return NULL;
+    }
+    return type;
+}
+
 PyMODINIT_FUNC PyInit_spkmeans(void) {
     PyObject *m;
     m = PyModule_Create(&moduledef);
     if(!m) {
         return NULL;
     }
+
+    if(NULL == (MatrixType = addType(m, &matrixSpec, "Matrix")) ||
+       NULL == (JobType = addType(m, &jobSpec, "Job")) ||
+       NULL == (ModelType = addType(m, &modelSpec, "Model")))
+    {
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    /* The linear algebra backend is named by the environment */
+    if(backend_init()) {
+        PyErr_Format(PyExc_ImportError, "Unknown backend (%s): '%s'",
+                     BACKEND_ENV, getenv(BACKEND_ENV));
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    /* So is the instruction set of the kernels, unless it's detected */
+    if(isa_init()) {
+        PyErr_Format(PyExc_ImportError,
+                     "Unsupported instruction set (%s): '%s' (up to %s)",
+                     ISA_ENV, getenv(ISA_ENV), isa_name(isa_detect()));
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    /* And so are the profiling of the runs, the memory budget and the
+     * scratch directory */
+    profile_init();
+    if(budget_init()) {
+        PyErr_Format(PyExc_ImportError, "Malformed memory budget (%s): '%s'",
+                     BUDGET_ENV, getenv(BUDGET_ENV));
+        Py_DECREF(m);
+        return NULL;
+    }
+    if(disk_init()) {
+        PyErr_Format(PyExc_ImportError,
+                     "Not a writable scratch directory (%s): '%s'", DISK_ENV,
+                     getenv(DISK_ENV));
+        Py_DECREF(m);
+        return NULL;
+    }
     return m;
 }
 /**************************************************************************/
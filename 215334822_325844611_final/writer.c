@@ -0,0 +1,195 @@
+#define _POSIX_C_SOURCE 200112L
+#include "writer.h"
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/********************************************* STATIC FUNCTION DECLARATIONS
+ * (WRITER)
+ * **************************************************************/
+/* The values whose magnitude is below this bound are formatted directly: their
+ * integral part fits in an unsigned long (even a 32-bit one), and the product
+ * of the value by 10^4 is far from the 2^53 limit of exact integers in
+ * doubles. Any other value is formatted by sprintf. */
+#define WRITER_FAST_BOUND 1e9
+
+/* Veltkamp's constant for splitting a double into two halves of 26 bits */
+#define WRITER_SPLITTER 134217729.0 /* 2^27 + 1 */
+
+/* Writes the whole buffer of the writer to its file descriptor */
+static void writer_flush(writer_t *writer);
+/******************************************************************************/
+
+/********************************************* GLOBAL FUNCTIONS OF THE WRITER
+ * **************************************************************/
+int writer_open(writer_t *writer, int fd) {
+    writer->fd = fd;
+    writer->len = 0;
+    writer->cap = WRITER_BUFFER_SIZE;
+    writer->signal = 0;
+
+    if(NULL == (writer->buf = malloc(writer->cap)))
+        return BAD_ALLOC;
+
+    return 0;
+}
+
+void writer_put(writer_t *writer, const char *bytes, size_t len) {
+    while(len > 0 && 0 == writer->signal) {
+        size_t amount = writer->cap - writer->len;
+        amount = (amount > len) ? len : amount;
+
+        memcpy(writer->buf + writer->len, bytes, amount);
+        writer->len += amount;
+        bytes += amount;
+        len -= amount;
+
+        if(writer->len == writer->cap) {
+            writer_flush(writer);
+        }
+    }
+}
+
+void writer_put_fixed4(writer_t *writer, double value) {
+    /* Format in place when the buffer has enough room */
+    if(writer->cap - writer->len >= WRITER_VALUE_MAX) {
+        writer->len += writer_format_fixed4(value, writer->buf + writer->len);
+    } else {
+        char text[WRITER_VALUE_MAX];
+        writer_put(writer, text, writer_format_fixed4(value, text));
+    }
+}
+
+int writer_close(writer_t *writer) {
+    writer_flush(writer);
+
+    free(writer->buf);
+    writer->buf = NULL;
+
+    return writer->signal;
+}
+
+size_t writer_format_fixed4(double value, char *output) {
+    double magnitude, hi, lo, high, low, floor_hi, frac, rounded, integral;
+    unsigned long whole, fraction;
+    char digits[16];
+    size_t len = 0, n = 0;
+    int cmp, i;
+
+    /* NaNs, infinities and huge values are left to sprintf */
+    if(!(value > -WRITER_FAST_BOUND && value < WRITER_FAST_BOUND)) {
+        char text[WRITER_VALUE_MAX + 32];
+        sprintf(text, "%.4f", value);
+        len = strlen(text);
+        memcpy(output, text, (len > WRITER_VALUE_MAX) ? WRITER_VALUE_MAX : len);
+        return (len > WRITER_VALUE_MAX) ? WRITER_VALUE_MAX : len;
+    }
+
+    /* The sign is printed even if the value rounds to zero (or is -0.0) */
+    if(value < 0.0 || (value == 0.0 && 1.0 / value < 0.0)) {
+        output[len++] = '-';
+    }
+    magnitude = fabs(value);
+
+    /* The exact product magnitude * 10^4 = hi + lo (Dekker's product: the
+     * magnitude is split into two halves whose products by 10^4 are exact) */
+    hi = magnitude * 10000.0;
+    high = WRITER_SPLITTER * magnitude;
+    high = high - (high - magnitude);
+    low = magnitude - high;
+    lo = (high * 10000.0 - hi) + low * 10000.0;
+
+    /* Round hi + lo to the nearest integer, ties to even. frac = hi - floor(hi)
+     * is exact, and so is frac - 0.5 when frac >= 0.25 (otherwise, frac + lo
+     * is clearly below a half, since |lo| <= ulp(hi) / 2 <= 1/4 here) */
+    floor_hi = floor(hi);
+    frac = hi - floor_hi;
+    if(frac >= 0.25) {
+        double diff = frac - 0.5;
+        cmp = (diff > -lo) ? 1 : ((diff < -lo) ? -1 : 0);
+    } else {
+        cmp = -1;
+    }
+    rounded = floor_hi;
+    if(cmp > 0 || (cmp == 0 && fmod(floor_hi, 2.0) != 0.0)) {
+        rounded += 1.0;
+    }
+
+    /* Split the rounded integer into the integral part and 4 decimal digits
+     * (exact, as it's far below 2^53) */
+    integral = floor(rounded / 10000.0);
+    whole = (unsigned long)integral;
+    fraction = (unsigned long)(rounded - integral * 10000.0);
+
+    do {
+        digits[n++] = (char)('0' + whole % 10);
+        whole /= 10;
+    } while(whole > 0);
+    while(n > 0) {
+        output[len++] = digits[--n];
+    }
+
+    output[len++] = '.';
+    for(i = 3; i >= 0; i--) {
+        output[len + i] = (char)('0' + fraction % 10);
+        fraction /= 10;
+    }
+
+    return len + 4;
+}
+
+int writer_write_all(int fd, const void *bytes, size_t len) {
+    const char *p = (const char *)bytes;
+
+    while(len > 0) {
+        ssize_t result = write(fd, p, len);
+
+        /* Nothing written out of a nonempty buffer would be retried
+         * forever */
+        if(0 == result || (result < 0 && errno != EINTR))
+            return BAD_OUTPUT;
+        if(result > 0) {
+            p += result;
+            len -= (size_t)result;
+        }
+    }
+
+    return 0;
+}
+
+int writer_matrix_rows(matrix_t mat, int fd) {
+    writer_t writer;
+    size_t row, col;
+
+    if(writer_open(&writer, fd))
+        return BAD_ALLOC;
+
+    for(row = 0; row < mat.rows; row++) {
+        const double *values = matrix_row(mat, row);
+
+        for(col = 0; col < mat.cols; col++) {
+            writer_put_fixed4(&writer, values[col]);
+            if(col < mat.cols - 1) {
+                writer_put(&writer, ",", 1);
+            }
+        }
+        writer_put(&writer, "\n", 1);
+    }
+
+    return writer_close(&writer);
+}
+/******************************************************************************/
+
+/********************************************* STATIC FUNCTION DEFINITIONS
+ * (RELATED TO THE WRITER)
+ * **************************************************************/
+static void writer_flush(writer_t *writer) {
+    if(0 == writer->signal) {
+        writer->signal = writer_write_all(writer->fd, writer->buf, writer->len);
+    }
+
+    writer->len = 0;
+}
+/******************************************************************************/
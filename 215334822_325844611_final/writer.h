@@ -0,0 +1,60 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include "matrix.h"
+#include <stdlib.h>
+
+/* The size of the buffer of a writer: the output is written to its file
+ * descriptor once the buffer is full (or when the writer is closed) */
+#define WRITER_BUFFER_SIZE (1 << 20)
+
+/* The longest text of a single value formatted as "%.4f" (the integral digits
+ * of DBL_MAX, a sign, a point and 4 decimal digits) */
+#define WRITER_VALUE_MAX 320
+
+/* Define a structure that will hold a buffered writer of a file descriptor.
+ * The first error met while writing is kept in <signal>, and anything written
+ * afterwards is dropped. */
+typedef struct writer_t {
+    int fd;
+    char *buf;
+    size_t len;
+    size_t cap;
+    int signal;
+} writer_t;
+
+/* Initializes a writer of the given file descriptor (e.g. 1 for stdout).
+ * Returns BAD_ALLOC in case its buffer can't be allocated. */
+int writer_open(writer_t *writer, int fd);
+
+/* Appends <len> bytes to the output of the writer */
+void writer_put(writer_t *writer, const char *bytes, size_t len);
+
+/* Appends the given value to the output of the writer, formatted exactly as
+ * printf("%.4f") formats it */
+void writer_put_fixed4(writer_t *writer, double value);
+
+/* Writes whatever is left in the buffer and frees it. Returns the first error
+ * met by the writer (BAD_OUTPUT in case the file descriptor couldn't be
+ * written), or 0. */
+int writer_close(writer_t *writer);
+
+/* Formats the given value exactly as printf("%.4f") does (rounding the exact
+ * binary value half to even, and keeping the sign of negative values that
+ * round to zero, e.g. "-0.0000") into <output>, which must hold
+ * WRITER_VALUE_MAX bytes. Returns the length of the text (no '\0' is
+ * written). */
+size_t writer_format_fixed4(double value, char *output);
+
+/* Writes all of the given <len> bytes into the file descriptor <fd> (as a
+ * single write, unless the file descriptor only accepts a part of them).
+ * Returns 0 on success and BAD_OUTPUT otherwise (including a write that
+ * accepts none of them). */
+int writer_write_all(int fd, const void *bytes, size_t len);
+
+/* Writes the rows of the given matrix into the file descriptor <fd>, as lines
+ * of comma separated "%.4f" values. Returns 0 on success, BAD_ALLOC or
+ * BAD_OUTPUT otherwise. */
+int writer_matrix_rows(matrix_t mat, int fd);
+
+#endif /* WRITER_H */
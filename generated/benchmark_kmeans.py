@@ -0,0 +1,51 @@
+import sys
+import time
+import numpy as np
+
+# The extension is built in-place inside the project's directory
+sys.path.insert(0, "../215334822_325844611_final")
+import spkmeans  # noqa: E402
+
+
+def make_blobs(n_samples, dim, centers, seed):
+    rng = np.random.RandomState(seed)
+    means = rng.uniform(-10, 10, size=(centers, dim))
+    labels = rng.randint(0, centers, size=n_samples)
+    return means[labels] + rng.normal(size=(n_samples, dim))
+
+
+def inertia(X, centroids):
+    dists = ((X[:, None, :] - centroids[None, :, :]) ** 2).sum(axis=2)
+    return dists.min(axis=1).sum()
+
+
+def run(X, K, indices, **config):
+    points = X.tolist()
+    start = time.perf_counter()
+    centroids = spkmeans.kmeans_fit(points, len(points), len(points[0]),
+                                    indices, K, **config)
+    elapsed = time.perf_counter() - start
+    return elapsed, inertia(X, np.array(centroids))
+
+
+if __name__ == "__main__":
+    args = sys.argv
+    if len(args) < 3:
+        print("Help: python3 benchmark_kmeans.py <n_samples> <K> [dim] [batch_size]\n")
+        print("Compares full Lloyd iterations against mini-batch kmeans, both")
+        print("seeded with the same kmeans++ indices, and prints the time and")
+        print("the inertia (sum of squared distances) of each of them.")
+
+    else:
+        n_samples, K = int(args[1]), int(args[2])
+        dim = int(args[3]) if len(args) > 3 else K
+        batch_size = int(args[4]) if len(args) > 4 else 1024
+
+        X = make_blobs(n_samples, dim, K, 0)
+        indices = spkmeans.kmeanspp(X.tolist(), n_samples, dim, K, 0)
+
+        print("mode,batch_size,seconds,inertia")
+        t, i = run(X, K, indices)
+        print(f"lloyd,0,{t:.4f},{i:.4f}")
+        t, i = run(X, K, indices, batch_size=batch_size, max_iter=300)
+        print(f"minibatch,{batch_size},{t:.4f},{i:.4f}")
@@ -0,0 +1,122 @@
+/* Throughput benchmark of the CSV loader (loader.c) against the original
+ * fscanf-based parser of spkmeans.c, on a generated file.
+ *
+ * Build (from ../215334822_325844611_final, with the flags of comp.sh):
+ *     bash comp.sh parsing
+ *
+ * Usage: ./benchmark_parsing <rows> <cols> [max_threads] [digits]
+ * Writes <rows> x <cols> random values (printed with <digits> significant
+ * digits, 17 by default, like Python's str) into a temporary file, and prints
+ * the throughput (MB/s) of the fscanf parser and of the loader on 1 to
+ * <max_threads> threads. */
+#define _POSIX_C_SOURCE 200112L
+#include "loader.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* The parser that spkmeans.c used before the loader: a pass of fgetc to find
+ * the dimensions, then one fscanf per value */
+static double *parse_fscanf(const char *filename, size_t *rows, size_t *cols) {
+    FILE *file = fopen(filename, "r");
+    double *data;
+    size_t i;
+    int c;
+
+    *rows = 0;
+    *cols = 1;
+    while(EOF != (c = fgetc(file))) {
+        if(c == '\n') {
+            (*rows)++;
+        } else if(c == ',' && *rows == 0) {
+            (*cols)++;
+        }
+    }
+    rewind(file);
+
+    data = calloc(*rows * *cols, sizeof(double));
+    for(i = 0; i < *rows * *cols; i++) {
+        if(1 != fscanf(file, "%lf,", &data[i]))
+            break;
+    }
+
+    fclose(file);
+    return data;
+}
+
+int main(int argc, char **argv) {
+    char filename[64];
+    size_t rows, cols, max_threads, digits, i, j, n_threads, bytes;
+    matrix_t mat;
+    double start, seconds, *reference;
+    char *text;
+    FILE *file;
+
+    if(argc < 3) {
+        printf("Help: ./benchmark_parsing <rows> <cols> [max_threads] "
+               "[digits]\n");
+        return 1;
+    }
+    rows = strtoul(argv[1], NULL, 10);
+    cols = strtoul(argv[2], NULL, 10);
+    max_threads = (argc > 3) ? strtoul(argv[3], NULL, 10)
+                             : (size_t)sysconf(_SC_NPROCESSORS_ONLN);
+    digits = (argc > 4) ? strtoul(argv[4], NULL, 10) : 17;
+
+    sprintf(filename, "/tmp/benchmark_parsing_%ld.csv", (long)getpid());
+
+    srand(0);
+    if(NULL == (file = fopen(filename, "w")))
+        return 1;
+    for(i = 0; i < rows; i++) {
+        for(j = 0; j < cols; j++) {
+            double value = (rand() / (double)RAND_MAX - 0.5) * 40.0;
+            fprintf(file, (j + 1 < cols) ? "%.*g," : "%.*g\n", (int)digits,
+                    value);
+        }
+    }
+    bytes = (size_t)ftell(file);
+    fclose(file);
+
+    printf("parser,threads,seconds,MB/s\n");
+
+    start = now();
+    reference = parse_fscanf(filename, &rows, &cols);
+    seconds = now() - start;
+    printf("fscanf,1,%.4f,%.1f\n", seconds, bytes / seconds / 1e6);
+
+    /* The text is parsed from memory, to time the parsing itself (the file
+     * is in the page cache anyway) */
+    text = malloc(bytes);
+    file = fopen(filename, "rb");
+    if(NULL == text || bytes != fread(text, 1, bytes, file))
+        return 1;
+    fclose(file);
+
+    for(n_threads = 1; n_threads <= max_threads; n_threads++) {
+        start = now();
+        if(loader_parse_csv(text, bytes, n_threads, &mat, NULL))
+            return 1;
+        seconds = now() - start;
+        printf("loader,%lu,%.4f,%.1f\n", (unsigned long)n_threads, seconds,
+               bytes / seconds / 1e6);
+
+        if(mat.len != rows * cols ||
+           0 != memcmp(mat.data, reference, mat.len * sizeof(double)))
+            printf("loader,%lu: the values differ from fscanf's\n",
+                   (unsigned long)n_threads);
+        matrix_free(mat);
+    }
+
+    free(text);
+    free(reference);
+    remove(filename);
+    return 0;
+}
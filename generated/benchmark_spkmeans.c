@@ -0,0 +1,690 @@
+/* Benchmark of every stage of the spectral clustering pipeline, on synthetic
+ * datasets (the blobs, moons and circles of generate_datasets.py, at any
+ * amount of datapoints and dimension).
+ *
+ * Build (from ../215334822_325844611_final, with the flags of comp.sh):
+ *     bash comp.sh benchmark
+ *
+ * Usage: ./benchmark_spkmeans [options]
+ *     --datasets <kinds>  comma separated kinds: blobs,moons,circles (all)
+ *     --n <sizes>         comma separated amounts of datapoints (500,1000)
+ *     --dim <dims>        comma separated dimensions (2)
+ *     --K <K>             the amount of clusters, 0 for the eigengap
+ *                         heuristic (3)
+ *     --warmup <count>    untimed runs of every stage (1)
+ *     --reps <count>      timed runs of every stage (5)
+ *     --seed <seed>       the seed of the datasets and of kmeans++ (0)
+ *     --format <format>   csv or json (csv)
+ *     --output <file>     where the results are written (stdout)
+ *     --baseline <file>   a csv of an earlier run to compare against (not the
+ *                         json one)
+ *     --threshold <pct>   the growth of a median that's a regression (10)
+ *
+ * Every dataset of the sweep (every kind, amount and dimension) is timed
+ * through the stages: parse (the CSV text of the dataset), wam, ddg, lnorm,
+ * jacobi (of the normalized laplacian), T (the whole spectral embedding),
+ * seeding (kmeans++ on T) and kmeans (on T). Only the stage itself is timed,
+ * not the freeing of its output. The results are the minimum, the 10th
+ * percentile, the median, the 90th percentile and the maximum of the timed
+ * runs, in seconds.
+ *
+ * With a baseline, the medians are compared against the ones of the baseline
+ * instead (a csv of: dataset, n, dim, stage, baseline, median, change and
+ * verdict), and the exit status is 1 if any of them regressed. */
+#define _POSIX_C_SOURCE 199309L
+#include "spkmeans.h"
+#include "arena.h"
+#include "backend.h"
+#include "isa.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* The most values of a comma separated option */
+#define BENCH_MAX_LIST 16
+
+/* Medians that changed by less than this (in seconds) are never regressions,
+ * as they're within the noise of the timer */
+#define BENCH_NOISE_FLOOR 1e-3
+
+/* The noise (its standard deviation) of the moons and circles, and the factor
+ * of the inner circle, as generate_datasets.py's defaults */
+#define BENCH_NOISE 0.05
+#define BENCH_CIRCLES_FACTOR 0.3
+
+#define BENCH_PI 3.14159265358979323846
+
+/* Define a structure that will hold the options of the benchmark */
+typedef struct bench_options_t {
+    const char *datasets[BENCH_MAX_LIST];
+    size_t num_datasets;
+    size_t n[BENCH_MAX_LIST];
+    size_t num_n;
+    size_t dim[BENCH_MAX_LIST];
+    size_t num_dim;
+    size_t K;
+    size_t warmup;
+    size_t reps;
+    unsigned long seed;
+    const char *format;
+    const char *output;
+    const char *baseline;
+    double threshold;
+} bench_options_t;
+
+/* Define a structure that will hold the state of a single dataset throughout
+ * the stages: the CSV text of the dataset, the context of its datapoints, and
+ * the outputs of the stages that later stages start from (the normalized
+ * laplacian, T and the initial centroids of T) */
+typedef struct bench_data_t {
+    char *text;
+    size_t len;
+    spkmeans_ctx_t ctx;
+    matrix_t lnorm;
+    spkmeans_ctx_t T;
+    size_t *indices;
+    unsigned long seed;
+} bench_data_t;
+
+/* Define a structure that will hold a stage: it runs once, and stores the
+ * time it took (excluding the freeing of its output) in <seconds> */
+typedef struct bench_stage_t {
+    const char *name;
+    int (*run)(bench_data_t *data, double *seconds);
+} bench_stage_t;
+
+/* Define a structure that will hold the results of a single stage of a single
+ * dataset */
+typedef struct bench_result_t {
+    char dataset[32];
+    size_t n;
+    size_t dim;
+    char stage[32];
+    size_t reps;
+    double min, p10, median, p90, max;
+} bench_result_t;
+
+/*************************************************** DATASETS
+ * **************************************************************/
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* A standard normal value (Box-Muller) */
+static double bench_normal(rng_t *rng) {
+    double u = 1.0 - rng_next_double(rng), v = rng_next_double(rng);
+    return sqrt(-2.0 * log(u)) * cos(2.0 * BENCH_PI * v);
+}
+
+/* Fills the n x dim matrix <points> with a dataset of the given kind, the
+ * same way generate_datasets.py does (for 2 dimensions). The dimensions after
+ * the first two of the moons and circles are noise. Returns BAD_INPUT in case
+ * the kind is unknown, and BAD_ALLOC in case of an allocation failure. */
+static int bench_generate(const char *kind, rng_t *rng, matrix_t points) {
+    size_t i, k, n = points.rows, dim = points.cols;
+
+    if(strcmp(kind, "blobs") == 0) {
+        /* 3 centers in [-10, 10]^dim, with a standard deviation of 1 */
+        matrix_t centers;
+        size_t c;
+
+        if(matrix_new(3, dim, &centers))
+            return BAD_ALLOC;
+        for(c = 0; c < 3; c++) {
+            for(k = 0; k < dim; k++) {
+                matrix_set(centers, c, k, rng_next_double(rng) * 20.0 - 10.0);
+            }
+        }
+        for(i = 0; i < n; i++) {
+            c = rng_next_interval(rng, 2);
+            for(k = 0; k < dim; k++) {
+                matrix_set(points, i, k,
+                           matrix_get(centers, c, k) + bench_normal(rng));
+            }
+        }
+        matrix_free(centers);
+        return 0;
+    }
+
+    if(strcmp(kind, "moons") != 0 && strcmp(kind, "circles") != 0)
+        return BAD_INPUT;
+
+    for(i = 0; i < n; i++) {
+        /* The first half of the datapoints are on the outer moon (circle) */
+        bool outer = (i < n - n / 2);
+        size_t count = outer ? n - n / 2 : n / 2;
+        size_t j = outer ? i : i - (n - n / 2);
+        double t, x, y;
+
+        if(strcmp(kind, "moons") == 0) {
+            t = (count > 1) ? BENCH_PI * j / (count - 1) : 0.0;
+            x = outer ? cos(t) : 1.0 - cos(t);
+            y = outer ? sin(t) : 0.5 - sin(t);
+        } else {
+            t = 2.0 * BENCH_PI * j / count;
+            x = outer ? cos(t) : BENCH_CIRCLES_FACTOR * cos(t);
+            y = outer ? sin(t) : BENCH_CIRCLES_FACTOR * sin(t);
+        }
+
+        for(k = 0; k < dim; k++) {
+            double value = (k == 0) ? x : (k == 1) ? y : 0.0;
+            matrix_set(points, i, k, value + BENCH_NOISE * bench_normal(rng));
+        }
+    }
+    return 0;
+}
+
+/* Stores the CSV text of the given datapoints in <data> (17 significant
+ * digits, like Python's str). Returns BAD_ALLOC in case of an allocation
+ * failure. */
+static int bench_format(matrix_t points, bench_data_t *data) {
+    size_t i, k, capacity = points.rows * points.cols * 26 + 1;
+
+    if(NULL == (data->text = malloc(capacity)))
+        return BAD_ALLOC;
+    data->len = 0;
+    for(i = 0; i < points.rows; i++) {
+        for(k = 0; k < points.cols; k++) {
+            data->len += sprintf(data->text + data->len,
+                                 (k + 1 < points.cols) ? "%.17g," : "%.17g\n",
+                                 matrix_get(points, i, k));
+        }
+    }
+    return 0;
+}
+/******************************************************************************/
+
+/*************************************************** STAGES
+ * **************************************************************/
+static int stage_parse(bench_data_t *data, double *seconds) {
+    matrix_t points;
+    double start = bench_now();
+    int signal;
+
+    if((signal = loader_parse_csv(data->text, data->len, 0, &points, NULL)))
+        return signal;
+    *seconds = bench_now() - start;
+
+    /* The datapoints of the later stages are the parsed ones */
+    if(NULL == data->ctx.points.data)
+        return spkmeans_use_points(&data->ctx, points, false);
+    matrix_free(points);
+    return 0;
+}
+
+/* The stages that build a matrix out of the datapoints */
+static int stage_goal(bench_data_t *data, double *seconds,
+                      int (*goal)(const spkmeans_ctx_t *, matrix_t *)) {
+    matrix_t output;
+    double start = bench_now();
+    int signal;
+
+    if((signal = goal(&data->ctx, &output)))
+        return signal;
+    *seconds = bench_now() - start;
+
+    matrix_free(output);
+    return 0;
+}
+
+static int stage_wam(bench_data_t *data, double *seconds) {
+    return stage_goal(data, seconds, build_weighted_adjacency_matrix);
+}
+
+static int stage_ddg(bench_data_t *data, double *seconds) {
+    return stage_goal(data, seconds, build_diagonal_degree_matrix);
+}
+
+static int stage_lnorm(bench_data_t *data, double *seconds) {
+    int signal;
+
+    /* The normalized laplacian of the jacobi stage */
+    if(NULL == data->lnorm.data &&
+       (signal = build_normalized_laplacian(&data->ctx, &data->lnorm)))
+        return signal;
+    return stage_goal(data, seconds, build_normalized_laplacian);
+}
+
+static int stage_jacobi(bench_data_t *data, double *seconds) {
+    jacobi_t output;
+    matrix_t lnorm;
+    double start;
+    int signal;
+
+    /* The algorithm works in place of its input, hence on a copy of it */
+    if((signal = matrix_clone(data->lnorm, &lnorm)))
+        return signal;
+
+    start = bench_now();
+    signal = eigen_jacobi(data->ctx.plan.backend, lnorm, data->ctx.K, false,
+                          &output);
+    *seconds = bench_now() - start;
+    matrix_free(lnorm);
+    if(signal)
+        return signal;
+
+    free(output.eigen_values);
+    matrix_free(output.eigen_vectors);
+    return 0;
+}
+
+static int stage_T(bench_data_t *data, double *seconds) {
+    matrix_t T;
+    double start = bench_now();
+    int signal;
+
+    if((signal = build_T_of_spectral_kmeans(&data->ctx, data->ctx.K, &T)))
+        return signal;
+    *seconds = bench_now() - start;
+
+    /* The datapoints of the seeding and kmeans stages are the rows of T */
+    if(NULL == data->T.points.data) {
+        data->T.K = T.cols;
+        return spkmeans_use_points(&data->T, T, false);
+    }
+    matrix_free(T);
+    return 0;
+}
+
+static int stage_seeding(bench_data_t *data, double *seconds) {
+    size_t *indices = calloc(data->T.K, sizeof(*indices));
+    double start = bench_now();
+    int signal;
+
+    if(NULL == indices)
+        return BAD_ALLOC;
+    if((signal = kmeanspp_init(data->T.points, data->T.K, data->seed,
+                               indices))) {
+        free(indices);
+        return signal;
+    }
+    *seconds = bench_now() - start;
+
+    /* The initial centroids of the kmeans stage */
+    if(NULL == data->indices) {
+        data->indices = indices;
+        return 0;
+    }
+    free(indices);
+    return 0;
+}
+
+static int stage_kmeans(bench_data_t *data, double *seconds) {
+    double start = bench_now();
+    int signal;
+
+    if((signal = spkmeans_pass_kmeans_info_and_run(
+            &data->T, data->indices, kmeans_default_config(), NULL, NULL)))
+        return signal;
+    *seconds = bench_now() - start;
+    return 0;
+}
+
+/* The stages, in the order they run in (each of them may start from the
+ * outputs of the ones before it) */
+static const bench_stage_t stages[] = {
+    {"parse", stage_parse},     {"wam", stage_wam},
+    {"ddg", stage_ddg},         {"lnorm", stage_lnorm},
+    {"jacobi", stage_jacobi},   {"T", stage_T},
+    {"seeding", stage_seeding}, {"kmeans", stage_kmeans},
+};
+/******************************************************************************/
+
+/*************************************************** RESULTS
+ * **************************************************************/
+static int bench_compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* The <p>-th percentile of the sorted <samples>, interpolated linearly
+ * between the closest ranks (as numpy.percentile does) */
+static double bench_percentile(const double *samples, size_t count,
+                               double p) {
+    double rank = p / 100.0 * (count - 1);
+    size_t low = (size_t)rank;
+
+    if(low + 1 >= count)
+        return samples[count - 1];
+    return samples[low] + (rank - low) * (samples[low + 1] - samples[low]);
+}
+
+static void bench_summarize(double *samples, size_t count,
+                            bench_result_t *result) {
+    qsort(samples, count, sizeof(double), bench_compare_doubles);
+    result->reps = count;
+    result->min = samples[0];
+    result->p10 = bench_percentile(samples, count, 10);
+    result->median = bench_percentile(samples, count, 50);
+    result->p90 = bench_percentile(samples, count, 90);
+    result->max = samples[count - 1];
+}
+
+static void bench_write_csv(FILE *file, const bench_result_t *results,
+                            size_t count) {
+    size_t i;
+
+    fprintf(file, "dataset,n,dim,stage,reps,min,p10,median,p90,max\n");
+    for(i = 0; i < count; i++) {
+        const bench_result_t *r = &results[i];
+        fprintf(file, "%s,%lu,%lu,%s,%lu,%.6f,%.6f,%.6f,%.6f,%.6f\n",
+                r->dataset, (unsigned long)r->n, (unsigned long)r->dim,
+                r->stage, (unsigned long)r->reps, r->min, r->p10, r->median,
+                r->p90, r->max);
+    }
+}
+
+static void bench_write_json(FILE *file, const bench_options_t *options,
+                             const bench_result_t *results, size_t count) {
+    size_t i;
+
+    fprintf(file,
+            "{\n  \"backend\": \"%s\",\n  \"isa\": \"%s\",\n"
+            "  \"warmup\": %lu,\n  \"reps\": %lu,\n  \"results\": [",
+            backend_current()->name, isa_kernels()->name,
+            (unsigned long)options->warmup, (unsigned long)options->reps);
+    for(i = 0; i < count; i++) {
+        const bench_result_t *r = &results[i];
+        fprintf(file,
+                "%s\n    {\"dataset\": \"%s\", \"n\": %lu, \"dim\": %lu, "
+                "\"stage\": \"%s\", \"reps\": %lu, \"min\": %.6f, "
+                "\"p10\": %.6f, \"median\": %.6f, \"p90\": %.6f, "
+                "\"max\": %.6f}",
+                (i == 0) ? "" : ",", r->dataset, (unsigned long)r->n,
+                (unsigned long)r->dim, r->stage, (unsigned long)r->reps,
+                r->min, r->p10, r->median, r->p90, r->max);
+    }
+    fprintf(file, "\n  ]\n}\n");
+}
+
+/* Compares the medians of <results> against the ones of the baseline csv of
+ * the same dataset and stage (results without one are reported as "new").
+ * Stores whether any median regressed by over <threshold> percent in
+ * <regressed>. Returns BAD_INPUT in case the baseline can't be read, or has no
+ * rows of such a csv (e.g. it's the output of --format json). */
+static int bench_compare(FILE *file, const char *baseline, double threshold,
+                         const bench_result_t *results, size_t count,
+                         bool *regressed) {
+    bench_result_t *base = NULL, *grown, row;
+    size_t num_base = 0, i, j;
+    char line[256];
+    FILE *input;
+
+    if(NULL == (input = fopen(baseline, "r")))
+        return BAD_INPUT;
+    while(NULL != fgets(line, sizeof(line), input)) {
+        unsigned long n, dim, reps;
+
+        if(10 != sscanf(line, "%31[^,],%lu,%lu,%31[^,],%lu,%lf,%lf,%lf,%lf,%lf",
+                        row.dataset, &n, &dim, row.stage, &reps, &row.min,
+                        &row.p10, &row.median, &row.p90, &row.max))
+            continue; /* the header */
+        row.n = n;
+        row.dim = dim;
+        row.reps = reps;
+
+        if(NULL == (grown = realloc(base, (num_base + 1) * sizeof(row)))) {
+            free(base);
+            fclose(input);
+            return BAD_ALLOC;
+        }
+        base = grown;
+        base[num_base++] = row;
+    }
+    fclose(input);
+    if(0 == num_base)
+        return BAD_INPUT;
+
+    *regressed = false;
+    fprintf(file, "dataset,n,dim,stage,baseline,median,change,verdict\n");
+    for(i = 0; i < count; i++) {
+        const bench_result_t *r = &results[i];
+        const char *verdict = "new";
+        double change = 0.0, before = 0.0;
+
+        for(j = 0; j < num_base; j++) {
+            if(strcmp(base[j].dataset, r->dataset) == 0 &&
+               base[j].n == r->n && base[j].dim == r->dim &&
+               strcmp(base[j].stage, r->stage) == 0)
+                break;
+        }
+        if(j < num_base) {
+            before = base[j].median;
+            change = (before > 0) ? (r->median / before - 1.0) * 100.0 : 0.0;
+            verdict = "ok";
+            if(change > threshold &&
+               r->median - before >= BENCH_NOISE_FLOOR) {
+                verdict = "REGRESSION";
+                *regressed = true;
+            } else if(change < -threshold &&
+                      before - r->median >= BENCH_NOISE_FLOOR) {
+                verdict = "improvement";
+            }
+        }
+
+        fprintf(file, "%s,%lu,%lu,%s,%.6f,%.6f,%+.1f%%,%s\n", r->dataset,
+                (unsigned long)r->n, (unsigned long)r->dim, r->stage, before,
+                r->median, change, verdict);
+    }
+
+    free(base);
+    return 0;
+}
+/******************************************************************************/
+
+/*************************************************** DRIVER
+ * **************************************************************/
+/* Runs every stage of a single dataset, storing their results in <results>
+ * (an array of one element per stage) */
+static int bench_dataset(const bench_options_t *options, const char *kind,
+                         size_t n, size_t dim, bench_result_t *results) {
+    size_t num_stages = sizeof(stages) / sizeof(stages[0]), s, rep;
+    bench_data_t data;
+    matrix_t points;
+    double *samples;
+    rng_t rng;
+    int signal;
+
+    data.text = NULL;
+    data.lnorm.data = NULL;
+    data.indices = NULL;
+    data.seed = options->seed;
+    spkmeans_ctx_init(&data.ctx);
+    spkmeans_ctx_init(&data.T);
+    data.ctx.K = options->K;
+
+    if(NULL == (samples = malloc(options->reps * sizeof(double))))
+        return BAD_ALLOC;
+    if((signal = matrix_new(n, dim, &points)))
+        goto error;
+    rng_seed(&rng, options->seed);
+    signal = bench_generate(kind, &rng, points);
+    if(0 == signal)
+        signal = bench_format(points, &data);
+    matrix_free(points);
+    if(signal)
+        goto error;
+
+    for(s = 0; s < num_stages; s++) {
+        for(rep = 0; rep < options->warmup + options->reps; rep++) {
+            double seconds;
+
+            if((signal = stages[s].run(&data, &seconds))) {
+                fprintf(stderr, "%s (n=%lu, dim=%lu): %s: %s\n", kind,
+                        (unsigned long)n, (unsigned long)dim, stages[s].name,
+                        spkmeans_strerror(signal));
+                goto error;
+            }
+            if(rep >= options->warmup)
+                samples[rep - options->warmup] = seconds;
+        }
+
+        strcpy(results[s].dataset, kind);
+        results[s].n = n;
+        results[s].dim = dim;
+        strcpy(results[s].stage, stages[s].name);
+        bench_summarize(samples, options->reps, &results[s]);
+    }
+
+error:
+    free(samples);
+    free(data.text);
+    free(data.indices);
+    matrix_free_safe(data.lnorm);
+    spkmeans_ctx_free(&data.ctx);
+    spkmeans_ctx_free(&data.T);
+    return signal;
+}
+
+/* Splits the comma separated <value> into <output> (BENCH_MAX_LIST values at
+ * most). Returns the amount of values, or 0 in case one of them is empty. */
+static size_t bench_split(char *value, const char **output) {
+    size_t count = 0;
+    char *token;
+
+    for(token = strtok(value, ","); NULL != token && count < BENCH_MAX_LIST;
+        token = strtok(NULL, ",")) {
+        output[count++] = token;
+    }
+    return count;
+}
+
+/* The same as bench_split, for positive numbers */
+static size_t bench_split_sizes(char *value, size_t *output) {
+    const char *tokens[BENCH_MAX_LIST];
+    size_t count = bench_split(value, tokens), i;
+
+    for(i = 0; i < count; i++) {
+        char *end;
+        output[i] = strtoul(tokens[i], &end, 10);
+        if('\0' != *end || 0 == output[i])
+            return 0;
+    }
+    return count;
+}
+
+static int bench_parse_args(int argc, char **argv, bench_options_t *options) {
+    static char default_datasets[] = "blobs,moons,circles";
+    static char default_n[] = "500,1000";
+    int i;
+
+    options->num_datasets = bench_split(default_datasets, options->datasets);
+    options->num_n = bench_split_sizes(default_n, options->n);
+    options->dim[0] = 2;
+    options->num_dim = 1;
+    options->K = 3;
+    options->warmup = 1;
+    options->reps = 5;
+    options->seed = 0;
+    options->format = "csv";
+    options->output = NULL;
+    options->baseline = NULL;
+    options->threshold = 10.0;
+
+    for(i = 1; i + 1 < argc; i += 2) {
+        char *value = argv[i + 1];
+
+        if(strcmp(argv[i], "--datasets") == 0) {
+            options->num_datasets = bench_split(value, options->datasets);
+        } else if(strcmp(argv[i], "--n") == 0) {
+            options->num_n = bench_split_sizes(value, options->n);
+        } else if(strcmp(argv[i], "--dim") == 0) {
+            options->num_dim = bench_split_sizes(value, options->dim);
+        } else if(strcmp(argv[i], "--K") == 0) {
+            options->K = strtoul(value, NULL, 10);
+        } else if(strcmp(argv[i], "--warmup") == 0) {
+            options->warmup = strtoul(value, NULL, 10);
+        } else if(strcmp(argv[i], "--reps") == 0) {
+            options->reps = strtoul(value, NULL, 10);
+        } else if(strcmp(argv[i], "--seed") == 0) {
+            options->seed = strtoul(value, NULL, 10);
+        } else if(strcmp(argv[i], "--format") == 0) {
+            options->format = value;
+        } else if(strcmp(argv[i], "--output") == 0) {
+            options->output = value;
+        } else if(strcmp(argv[i], "--baseline") == 0) {
+            options->baseline = value;
+        } else if(strcmp(argv[i], "--threshold") == 0) {
+            options->threshold = atof(value);
+        } else {
+            return BAD_INPUT;
+        }
+    }
+
+    if(i != argc || 0 == options->num_datasets || 0 == options->num_n ||
+       0 == options->num_dim || 0 == options->reps || 1 == options->K ||
+       (strcmp(options->format, "csv") != 0 &&
+        strcmp(options->format, "json") != 0))
+        return BAD_INPUT;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    size_t num_stages = sizeof(stages) / sizeof(stages[0]), count = 0, d, i, j;
+    bench_result_t *results = NULL;
+    bench_options_t options;
+    bool regressed = false;
+    FILE *file = stdout;
+    int signal;
+
+    if((signal = bench_parse_args(argc, argv, &options))) {
+        fprintf(stderr, "Help: ./benchmark_spkmeans [--datasets <kinds>] "
+                        "[--n <sizes>] [--dim <dims>] [--K <K>] [--warmup "
+                        "<count>] [--reps <count>] [--seed <seed>] [--format "
+                        "csv/json] [--output <file>] [--baseline <file>] "
+                        "[--threshold <pct>]\n");
+        return 1;
+    }
+    if((signal = backend_init()) || (signal = isa_init()))
+        goto error;
+
+    results = malloc(options.num_datasets * options.num_n * options.num_dim *
+                     num_stages * sizeof(*results));
+    if(NULL == results) {
+        signal = BAD_ALLOC;
+        goto error;
+    }
+
+    for(d = 0; d < options.num_datasets; d++) {
+        for(i = 0; i < options.num_n; i++) {
+            for(j = 0; j < options.num_dim; j++) {
+                if((signal = bench_dataset(&options, options.datasets[d],
+                                           options.n[i], options.dim[j],
+                                           results + count)))
+                    goto error;
+                count += num_stages;
+            }
+        }
+    }
+
+    if(NULL != options.output && NULL == (file = fopen(options.output, "w"))) {
+        signal = BAD_OUTPUT;
+        goto error;
+    }
+    if(NULL != options.baseline) {
+        signal = bench_compare(file, options.baseline, options.threshold,
+                               results, count, &regressed);
+    } else if(strcmp(options.format, "json") == 0) {
+        bench_write_json(file, &options, results, count);
+    } else {
+        bench_write_csv(file, results, count);
+    }
+    if(stdout != file)
+        fclose(file);
+    if(signal)
+        goto error;
+
+    free(results);
+    arena_thread_free();
+    return regressed ? 1 : 0;
+
+error:
+    printf("%s", spkmeans_strerror(signal));
+    free(results);
+    arena_thread_free();
+    return 1;
+}
+/******************************************************************************/
@@ -0,0 +1,95 @@
+#!/bin/bash
+
+
+# This is a conformance test of the linear algebra backends (see backend.h) against the same output files that tester.sh uses.
+# Every backend is tested through the C interface (wam, ddg, lnorm, jacobi) and the CPython interface (spk), by conformance.sh.
+#
+# Usage (from within the directory of the project, just like tester.sh):
+# bash backend_test.sh <testfiles> [backends...]
+#
+# The backends default to all of them: reference, blas and lapack. Any backend other than the reference backend builds the project
+# with SPKMEANS_BLAS=1.
+#
+# The reference and blas backends must reproduce the output files exactly.
+# The lapack backend finds the exact eigen values and vectors (sorted, and with signs of its own), while the output files hold those
+# of Jacobi's algorithm, which is limited to 100 rotations. Hence its jacobi outputs are compared up to the order and the signs of the
+# eigen vectors (within JACOBI_TOLERANCE), and its spk outputs aren't compared at all: the eigengap heuristic of the exact spectrum of
+# the test files picks K=1, which is an invalid input.
+
+
+
+
+source "$(dirname "${BASH_SOURCE[0]}")/conformance.sh"
+
+# Jacobi's algorithm stops once an iteration barely changed its matrix (by epsilon), which leaves its outputs off by up to about 0.002
+JACOBI_TOLERANCE=0.005
+
+# compares two outputs of the jacobi goal up to the order of the eigen values and the signs of the eigen vectors
+function jacobi_equivalent() {
+	python3 - "$1" "$2" "$JACOBI_TOLERANCE" <<'EOF'
+import sys
+
+def canonical(filename):
+    with open(filename) as f:
+        rows = [[float(x) for x in line.split(",")] for line in f if line.strip()]
+    pairs = []
+    for j, value in enumerate(rows[0]):
+        vector = [row[j] for row in rows[1:]]
+        pivot = max(vector, key=abs)
+        pairs.append((value, [x if pivot >= 0 else -x for x in vector]))
+    return sorted(pairs, key=lambda pair: pair[0])
+
+try:
+    actual, expected = canonical(sys.argv[1]), canonical(sys.argv[2])
+except (ValueError, IndexError):
+    sys.exit(1)
+tolerance = float(sys.argv[3])
+if len(actual) != len(expected):
+    sys.exit(1)
+for (value1, vector1), (value2, vector2) in zip(actual, expected):
+    if abs(value1 - value2) > tolerance or len(vector1) != len(vector2):
+        sys.exit(1)
+    if any(abs(x - y) > tolerance for x, y in zip(vector1, vector2)):
+        sys.exit(1)
+EOF
+}
+
+
+
+# the lapack backend's jacobi outputs are compared up to the order and the signs of the eigen vectors
+function conformance_compare() {
+	if [[ $backend == "lapack" && $4 == "jacobi" ]]; then
+		jacobi_equivalent $1 $2
+	else
+		cmp -s $1 $2
+	fi
+}
+
+# the lapack backend's spk outputs aren't compared at all
+function conformance_wanted() {
+	[[ $backend != "lapack" || $1 != "py" ]]
+}
+
+
+
+
+
+# =================
+# PRELUDE
+# =================
+backends=${@:2}
+backends=${backends:-reference blas lapack}
+
+# building both interfaces (along with the BLAS backends, if any of them is tested)
+if [[ $backends != "reference" ]]; then
+	export SPKMEANS_BLAS=1
+fi
+conformance_prelude backend_test.sh "$1" "[backends...]"
+
+# run
+for backend in $backends; do
+	echo -e "\n\e[4;37mTesting the backend \e[4;33m\e[1;33m${backend}\e[0m:"
+	conformance_goals SPKMEANS_BACKEND=$backend
+done
+
+conformance_done
@@ -0,0 +1,84 @@
+#!/bin/bash
+
+
+# This is a test of the memory budget (see budget.h) against the same output files that tester.sh uses. Under an ample
+# budget, every goal must reproduce the output files exactly through the C interface (wam, ddg, lnorm, jacobi) and the
+# CPython interface (spk), by conformance.sh. Under a budget that's too small, every goal must fail before running: with
+# "An Error Has Occurred" and its estimate (C), or with a MemoryError (CPython). The n x n matrices must be accounted to
+# the stages that allocate them (see memory_stats), and no longer once the run is over.
+#
+# Usage (from within the directory of the project, just like tester.sh):
+# bash budget_test.sh <testfiles>
+
+
+
+
+source "$(dirname "${BASH_SOURCE[0]}")/conformance.sh"
+
+# global variables
+error_file="./tmp/error.txt"
+ample_budget="1G"
+small_budget="1"
+
+
+
+# once a goal reproduces its output file under the ample budget, it must fail before running under the small one
+function conformance_check() {
+	if [[ $1 == "py" ]]; then
+		SPKMEANS_MEMORY_BUDGET=$small_budget python3 -c "
+import spkmeans, sys
+try:
+    spkmeans.goal(0, sys.argv[1], sys.argv[2])
+except MemoryError as error:
+    sys.exit('memory budget' not in str(error))
+sys.exit(1)
+" $2 $testers_path/$3 &> /dev/null
+	else
+		! SPKMEANS_MEMORY_BUDGET=$small_budget ./spkmeans $2 $testers_path/$3 > $output_file 2> $error_file && \
+			grep -q "An Error Has Occurred" $output_file && grep -q "memory budget" $error_file
+	fi
+}
+
+
+
+
+
+# =================
+# PRELUDE
+# =================
+conformance_prelude budget_test.sh "$1"
+
+# run
+conformance_goals SPKMEANS_MEMORY_BUDGET=$ample_budget
+
+# the stages of spk account the n x n matrices that they allocate (the laplacian, and the eigen vectors)
+for file in $(ls $testers_path | grep "^spk_"); do
+	echo -n "PY: MEMORY_STATS: ${testers_path}/${file}: "
+	python3 -c "
+import spkmeans, sys
+points = [[float(x) for x in line.split(',')] for line in open(sys.argv[1])]
+square = len(points) * len(points) * 8
+spkmeans.memory_stats(True)
+try:
+    spkmeans.spk(0, points)
+except RuntimeError: # some of the files fail once their eigen values are found
+    pass
+stats = spkmeans.memory_stats()
+assert stats['current'] == 0 and stats['peak'] >= 2 * square
+assert stats['stages']['laplacian']['peak'] >= square and stats['stages']['jacobi']['peak'] >= square
+" $testers_path/$file &> /dev/null
+	verdict $?
+	echo
+done
+
+# a malformed budget is rejected by both interfaces
+echo -n "C: MALFORMED BUDGET: "
+! SPKMEANS_MEMORY_BUDGET=12Q ./spkmeans wam $testers_path/$(ls $testers_path | grep "^spk_" | head -1) &> /dev/null
+verdict $?
+echo
+echo -n "PY: MALFORMED BUDGET: "
+! SPKMEANS_MEMORY_BUDGET=12Q python3 -c "import spkmeans" &> /dev/null
+verdict $?
+echo
+
+conformance_done
@@ -0,0 +1,168 @@
+#!/bin/bash
+
+
+# This is the shared driver of the conformance tests (backend_test.sh, isa_test.sh, profile_test.sh, budget_test.sh,
+# disk_test.sh, convert_test.sh, output_test.sh and stream_test.sh), which is sourced by every one of them (and by
+# model_test.sh and jobs_test.sh, for its prelude and verdicts alone). Each of them runs every goal against the same
+# output files that tester.sh uses, through the C interface (wam, ddg, lnorm, jacobi) and the CPython interface (spk),
+# under a set of environment variables of its own (ENV=value arguments of conformance_goals), and adds the checks of its
+# feature by redefining the hooks below.
+#
+# Usage (from within a test, which is run from within the directory of the project, just like tester.sh):
+# source "$(dirname "${BASH_SOURCE[0]}")/conformance.sh"
+# conformance_prelude <test> <testfiles> [usage]
+# conformance_goals [ENV=value...]
+# conformance_done
+
+
+
+
+# global variables
+output_file="./tmp/output.txt"
+failures=0
+
+
+
+function verdict() {
+	# the first argument shall be 0 on success
+	if [[ $1 -eq 0 ]]; then
+		echo -ne '\033[1;32mSUCCESS\e[0m'
+	else
+		echo -ne "\e[1;31mFAILED\e[0m"
+		failures=$((failures + 1))
+	fi
+}
+
+
+
+# =================
+# HOOKS (redefined by the tests)
+# =================
+# whether the goal is run through the interface at all
+function conformance_wanted() {
+	# the first argument shall be the interface: c/py
+	# the second argument shall be the goal
+	true
+}
+
+# prepares a run of the goal through the interface
+function conformance_setup() {
+	# the first argument shall be the interface: c/py
+	# the second argument shall be the goal
+	true
+}
+
+# prints the input argument of a run of the goal through the interface, on the input file
+function conformance_input() {
+	# the first argument shall be the interface: c/py
+	# the second argument shall be the goal
+	# the third argument shall be the input file being used
+	echo $testers_path/$3
+}
+
+# prints the output file argument of a run of the goal through the interface, if it has one
+function conformance_output() {
+	# the first argument shall be the interface: c/py
+	# the second argument shall be the goal
+	true
+}
+
+# compares the output of a run against its output file
+function conformance_compare() {
+	# the first argument shall be the output of the run
+	# the second argument shall be the output file
+	# the third argument shall be the interface: c/py
+	# the fourth argument shall be the goal
+	cmp -s $1 $2
+}
+
+# the checks of the feature, once the output of a run is compared (0 on success)
+function conformance_check() {
+	# the first argument shall be the interface: c/py
+	# the second argument shall be the goal
+	# the third argument shall be the input file being used
+	true
+}
+
+
+
+# test of a single goal, a single input file, under the environment of conformance_goals
+function individual_test() {
+	# the first argument shall be the interface being tested: c/py
+	# the second argument shall be the goal being tested
+	# the third argument shall be the input file being used
+
+	echo -n "${1^^}: ${2^^}: ${testers_path}/${3}: "
+
+	# the input file is piped into the run as well, for an input argument of "-"
+	conformance_setup $1 $2
+	input=$(conformance_input $1 $2 $3)
+	outfile=$(conformance_output $1 $2)
+	if [[ $1 == "py" ]]; then
+		cat $testers_path/$3 | env "${conformance_env[@]}" python3 spkmeans.py 0 $2 $input $outfile &> $output_file
+	else
+		cat $testers_path/$3 | env "${conformance_env[@]}" ./spkmeans $2 $input $outfile &> $output_file
+	fi
+
+	conformance_compare $output_file $testers_path/outputs/$1/$2/$3 $1 $2 && conformance_check $1 $2 $3
+	verdict $?
+	echo
+}
+
+
+
+# runs every goal on every input file of it, under the given environment
+function conformance_goals() {
+	# the arguments shall be the environment of the runs (ENV=value each)
+	conformance_env=("$@")
+
+	for goal in wam ddg lnorm; do
+		conformance_wanted c $goal || continue
+		for file in $(ls $testers_path | grep "^spk_"); do
+			individual_test c $goal $file
+		done
+	done
+
+	if conformance_wanted c jacobi; then
+		for file in $(ls $testers_path | grep "^jacobi_"); do
+			individual_test c jacobi $file
+		done
+	fi
+
+	if conformance_wanted py spk; then
+		for file in $(ls $testers_path | grep "^spk_"); do
+			individual_test py spk $file
+		done
+	fi
+}
+
+
+
+# checks the usage, and builds both interfaces (with the environment of the caller, e.g. SPKMEANS_BLAS)
+function conformance_prelude() {
+	# the first argument shall be the name of the test
+	# the second argument shall be the directory of the test files
+	# the third argument shall be the rest of its usage, if any
+	testers_path=$2
+	if [[ ! -d $testers_path ]]; then
+		echo -e "\e[1;31mUsage: bash ${1} <testfiles>${3:+ $3}\e[0m"
+		exit 1
+	fi
+
+	mkdir ./tmp &> /dev/null
+	comp_output=$(bash comp.sh 2>&1)
+	build_output=$(python3 setup.py build_ext --inplace --force 2>&1 1>/dev/null)
+	if [[ ${#comp_output} -ne 0 || ${#build_output} -ne 0 ]]; then
+		echo -e "\e[1;31mFailed to build the project:\e[0m\n${comp_output}${build_output}"
+		exit 1
+	fi
+}
+
+
+
+# reports the failures, and exits accordingly
+function conformance_done() {
+	echo -e "\n\e[4;37mDONE\e[0m: ${failures} failed."
+	[[ $failures -eq 0 ]]
+	exit
+}
@@ -0,0 +1,140 @@
+#!/bin/bash
+
+
+# This is a test of the binary inputs (see loader.h) against the same output files that tester.sh uses. Every input file is
+# converted into the binary dataset format (.bin) and into a NumPy array (.npy), by the convert goal of the C interface (for
+# its runs) and by spkmeans.convert (for the runs of the CPython interface), and every goal must reproduce the output files
+# exactly out of them, by conformance.sh. So must files of the opposite byte order, while files of an invalid byte order, of
+# another type than doubles, or whose header is truncated must be rejected with the reason of it.
+#
+# Usage (from within the directory of the project, just like tester.sh):
+# bash convert_test.sh <testfiles>
+
+
+
+
+source "$(dirname "${BASH_SOURCE[0]}")/conformance.sh"
+
+# global variables
+binary_file="./tmp/input"
+
+
+
+# the format that the input files are converted into
+function conformance_setup() {
+	echo -n "${format^^}: "
+}
+
+# every run is on the input file, converted by the interface itself
+function conformance_input() {
+	# the first argument shall be the interface: c/py
+	# the second argument shall be the goal
+	# the third argument shall be the input file being used
+	rm -f $binary_file.$format
+	if [[ $1 == "py" ]]; then
+		python3 -c "import spkmeans; spkmeans.convert('$testers_path/$3', '$binary_file.$format')" &> /dev/null
+	else
+		./spkmeans convert $testers_path/$3 $binary_file.$format &> /dev/null
+	fi
+	echo $binary_file.$format
+}
+
+
+
+# test of a single input file of the opposite byte order (which is swapped back once it's loaded)
+function byte_order_test() {
+	# the first argument shall be the format: bin/npy
+	# the second argument shall be the goal being tested
+	# the third argument shall be the input file being used
+
+	echo -n "C: ${2^^}: ${testers_path}/${3}: ${1^^}: OPPOSITE BYTE ORDER: "
+	./spkmeans convert $testers_path/$3 $binary_file.$1 &> /dev/null &&
+		python3 -c "
+import sys
+import numpy as np
+
+points = np.loadtxt('$testers_path/$3', delimiter=',', ndmin=2)
+opposite = '>' if sys.byteorder == 'little' else '<'
+if '$1' == 'npy':
+    np.save('$binary_file.npy', points.astype(opposite + 'f8'))
+else:
+    with open('$binary_file.bin', 'rb') as binary_file:
+        header = bytearray(binary_file.read(64))
+    header[10:11] = b'B' if opposite == '>' else b'L'
+    header[16:32] = np.array(points.shape, dtype=opposite + 'u8').tobytes()
+    with open('$binary_file.bin', 'wb') as binary_file:
+        binary_file.write(bytes(header) + points.astype(opposite + 'f8').tobytes())
+" &> /dev/null &&
+		./spkmeans $2 $binary_file.$1 &> $output_file &&
+		cmp -s $output_file $testers_path/outputs/c/$2/$3
+	verdict $?
+	echo
+}
+
+# test of a single malformed binary input, which is rejected along with the reason
+function rejection_test() {
+	# the first argument shall be the format: bin/npy
+	# the second argument shall be the reason of the rejection
+
+	echo -n "PY: ${1^^}: ${2^^}: "
+	python3 -c "
+import sys
+import numpy as np
+import spkmeans
+
+fmt, reason = sys.argv[1], sys.argv[2]
+points = np.loadtxt('$testers_path/$(ls $testers_path | grep "^spk_" | head -1)', delimiter=',', ndmin=2)
+if fmt == 'npy':
+    np.save('$binary_file.npy', points.astype('<f4') if reason.startswith('unsupported type') else points)
+else:
+    spkmeans.convert('$testers_path/$(ls $testers_path | grep "^spk_" | head -1)', '$binary_file.bin')
+with open('$binary_file.' + fmt, 'rb') as binary_file:
+    contents = bytearray(binary_file.read())
+if reason == 'invalid byte order':
+    contents[10:11] = b'X'
+elif reason.startswith('unsupported type'):
+    contents[9:10] = b'f' if fmt == 'bin' else contents[9:10]
+else: # a header that ends before its end
+    contents = contents[:40]
+with open('$binary_file.' + fmt, 'wb') as binary_file:
+    binary_file.write(bytes(contents))
+
+try:
+    spkmeans.goal(0, 'wam', '$binary_file.' + fmt)
+    sys.exit(1)
+except ValueError as error:
+    sys.exit(reason not in str(error))
+" $1 "$2" &> /dev/null && ! ./spkmeans wam $binary_file.$1 &> /dev/null
+	verdict $?
+	echo
+}
+
+
+
+
+
+# =================
+# PRELUDE
+# =================
+conformance_prelude convert_test.sh "$1"
+
+# run
+for format in bin npy; do
+	conformance_goals
+done
+
+# a file of the opposite byte order gives the same outputs
+for format in bin npy; do
+	byte_order_test $format wam $(ls $testers_path | grep "^spk_" | head -1)
+	byte_order_test $format jacobi $(ls $testers_path | grep "^jacobi_" | head -1)
+done
+
+# malformed files are rejected by both interfaces
+rejection_test bin "invalid byte order"
+rejection_test bin "unsupported type (only doubles)"
+rejection_test bin "not a binary dataset"
+rejection_test npy "unsupported type (only doubles)"
+rejection_test npy "truncated header"
+
+rm -f $binary_file.bin $binary_file.npy
+conformance_done
@@ -0,0 +1,92 @@
+#!/bin/bash
+
+
+# This is a test of the out of core runs (see disk.h) against the same output files that tester.sh uses. With a scratch
+# directory and no memory budget, every run is out of core: every goal must reproduce the output files exactly through the
+# C interface (wam, ddg, lnorm, jacobi) and the CPython interface (spk), by conformance.sh. The graph matrices must be
+# mapped from the scratch directory (an unlinked spkmeans-* file in /proc/self/maps) for as long as they're alive, and be
+# accounted to their phase of the profile.
+#
+# Usage (from within the directory of the project, just like tester.sh):
+# bash disk_test.sh <testfiles>
+
+
+
+
+source "$(dirname "${BASH_SOURCE[0]}")/conformance.sh"
+
+# global variables
+scratch_dir="./tmp/scratch"
+
+
+
+
+
+# =================
+# PRELUDE
+# =================
+conformance_prelude disk_test.sh "$1"
+rm -rf $scratch_dir && mkdir $scratch_dir
+
+# run
+conformance_goals SPKMEANS_SCRATCH_DIR=$scratch_dir
+
+# a graph matrix is mapped from an unlinked file of the scratch directory while it's alive, and unmapped once it's freed
+for goal in wam ddg lnorm; do
+	echo -n "PY: MAPPING: ${goal^^}: "
+	SPKMEANS_SCRATCH_DIR=$scratch_dir python3 -c "
+import spkmeans
+def mappings():
+    with open('/proc/self/maps') as maps:
+        return [line for line in maps if 'spkmeans-' in line and line.rstrip().endswith('(deleted)')]
+mat = spkmeans.goal(0, '$goal', '$testers_path/$(ls $testers_path | grep "^spk_" | head -1)')
+assert len(mappings()) == 1
+del mat
+assert len(mappings()) == 0
+" &> /dev/null
+	verdict $?
+	echo
+done
+
+# the mapped laplacian (built in place of the weighted adjacency matrix) is accounted to its phase of the profile
+echo -n "C: PROFILED BYTES: "
+python3 -c "
+import random
+random.seed(0)
+print('\n'.join(','.join('%.4f' % random.uniform(-10, 10) for _ in range(5)) for _ in range(1000)))
+" > ./tmp/disk_input.txt
+SPKMEANS_SCRATCH_DIR=$scratch_dir SPKMEANS_PROFILE=./tmp/disk_profile.json ./spkmeans lnorm ./tmp/disk_input.txt &> /dev/null &&
+	python3 -c "
+import json
+with open('./tmp/disk_profile.json') as profile:
+    phases = json.load(profile)['phases']
+assert phases['lnorm']['bytes'] >= 8 * 1000 * 1000
+" &> /dev/null
+verdict $?
+echo
+rm -f ./tmp/disk_input.txt ./tmp/disk_profile.json
+
+# every goal is planned out of core, while it still fits under a budget that's too small for it in memory
+echo -n "PY: MEMORY_PLAN: "
+SPKMEANS_SCRATCH_DIR=$scratch_dir SPKMEANS_MEMORY_BUDGET=1M python3 -c "
+import spkmeans
+for goal in ['wam', 'ddg', 'lnorm', 'jacobi', 'spk', 'fit']:
+    num_data, dim = (300, 300) if goal == 'jacobi' else (1000, 5)
+    plan = spkmeans.memory_plan(goal, num_data, dim)
+    assert plan['fits'] and plan['out_of_core']
+" &> /dev/null
+verdict $?
+echo
+
+# a scratch directory that isn't a writable directory is rejected by both interfaces
+echo -n "C: BAD SCRATCH DIRECTORY: "
+! SPKMEANS_SCRATCH_DIR=$output_file ./spkmeans wam $testers_path/$(ls $testers_path | grep "^spk_" | head -1) &> /dev/null
+verdict $?
+echo
+echo -n "PY: BAD SCRATCH DIRECTORY: "
+! SPKMEANS_SCRATCH_DIR=$output_file python3 -c "import spkmeans" &> /dev/null
+verdict $?
+echo
+
+rm -rf $scratch_dir
+conformance_done
@@ -0,0 +1,44 @@
+#!/bin/bash
+
+
+# This is a conformance test of the instruction sets of the vectorized kernels (see isa.h) against the same output files that
+# tester.sh uses. Every level is forced by SPKMEANS_ISA and tested through the C interface (wam, ddg, lnorm, jacobi) and the
+# CPython interface (spk), by conformance.sh.
+#
+# Usage (from within the directory of the project, just like tester.sh):
+# bash isa_test.sh <testfiles> [levels...]
+#
+# The levels default to all of them that the CPU supports: scalar, sse2, avx2 and avx512. Every level must reproduce the output
+# files exactly (the levels compute bit-identical results).
+
+
+
+
+source "$(dirname "${BASH_SOURCE[0]}")/conformance.sh"
+
+
+
+
+
+# =================
+# PRELUDE
+# =================
+conformance_prelude isa_test.sh "$1" "[levels...]"
+
+# the levels the CPU doesn't support are skipped, unless they're named
+detected=$(python3 -c "import spkmeans; print(spkmeans.isa()['detected'])")
+levels=${@:2}
+if [[ -z $levels ]]; then
+	for level in scalar sse2 avx2 avx512; do
+		levels="$levels $level"
+		[[ $level == $detected ]] && break
+	done
+fi
+
+# run
+for level in $levels; do
+	echo -e "\n\e[4;37mTesting the instruction set \e[4;33m\e[1;33m${level}\e[0m:"
+	conformance_goals SPKMEANS_ISA=$level
+done
+
+conformance_done
@@ -0,0 +1,122 @@
+#!/bin/bash
+
+
+# This is a test of the goals that are submitted to the native thread pool of the CPython interface (see jobs.h):
+# spkmeans.submit, spkmeans.wait and Job.result. Every goal of every input file that tester.sh uses (and of its datapoints,
+# given as lists) is submitted at once: the results of spkmeans.wait, and of Job.result, must be exactly those of
+# spkmeans.goal, and so must their errors. Besides, a job that isn't done in time must raise a TimeoutError, and the error of a
+# job must be raised through spkmeans.wait.
+#
+# Usage (from within the directory of the project, just like tester.sh):
+# bash jobs_test.sh <testfiles>
+
+
+
+
+source "$(dirname "${BASH_SOURCE[0]}")/conformance.sh"
+
+# global variables
+malformed_file="./tmp/malformed.txt"
+
+
+
+# test of a single goal, submitted for every input file of it at once (as a file or as datapoints)
+function individual_test() {
+	# the first argument shall be the goal being tested
+	# the second argument shall be the way the datapoints are given: file/points
+
+	echo -n "PY: SUBMIT: ${1^^}: ${2^^}: "
+	python3 -c "
+import os, sys
+import spkmeans
+
+goal, given = sys.argv[1], sys.argv[2]
+prefix = 'jacobi_' if goal == 'jacobi' else 'spk_'
+files = sorted(os.path.join('$testers_path', name) for name in os.listdir('$testers_path') if name.startswith(prefix))
+def data_of(file):
+    if given == 'file':
+        return file
+    with open(file) as input_file:
+        return [[float(value) for value in line.split(',')] for line in input_file if line.strip()]
+inputs = [data_of(file) for file in files]
+
+def outcome(call):
+    try:
+        return call().tolist()
+    except Exception as error:
+        return (type(error), str(error))
+
+# the goal (T, for spk) of every input, submitted before any of them is waited for
+jobs = [spkmeans.submit(0, goal, data) for data in inputs]
+expected = [outcome(lambda: spkmeans.goal(0, goal, data)) for data in inputs]
+assert [outcome(job.result) for job in jobs] == expected
+
+passing = [i for i in range(len(inputs)) if isinstance(expected[i], list)]
+assert passing
+jobs = [spkmeans.submit(0, goal, inputs[i]) for i in passing]
+assert [result.tolist() for result in spkmeans.wait(jobs)] == [expected[i] for i in passing]
+assert all(job.done() for job in jobs)
+" $1 $2 &> /dev/null
+	verdict $?
+	echo
+}
+
+
+
+
+
+# =================
+# PRELUDE
+# =================
+conformance_prelude jobs_test.sh "$1"
+
+# run
+for goal in wam ddg lnorm jacobi spk; do
+	for given in file points; do
+		individual_test $goal $given
+	done
+done
+
+# a job that's still being performed raises a TimeoutError, until it's done
+echo -n "PY: RESULT: TIMEOUT: "
+python3 -c "
+import random
+import spkmeans
+
+random.seed(0)
+points = [[random.uniform(-10, 10) for _ in range(5)] for _ in range(3000)]
+job = spkmeans.submit(0, 'lnorm', points)
+try:
+    job.result(timeout=0)
+    raise AssertionError('the job was done at once')
+except TimeoutError:
+    pass
+assert job.result().tolist() == spkmeans.goal(0, 'lnorm', points).tolist()
+assert job.result(timeout=0) is job.result()
+" &> /dev/null
+verdict $?
+echo
+
+# the error of a failed job is raised through spkmeans.wait, whatever the other jobs are
+printf '1.0,2.0\n3.0,oops\n' > $malformed_file
+echo -n "PY: WAIT: ERRORS: "
+python3 -c "
+import spkmeans
+
+good = '$testers_path/$(ls $testers_path | grep "^spk_" | head -1)'
+cases = [(spkmeans.submit(0, 'wam', '$malformed_file'), ValueError, 'malformed.txt:2: invalid number'),
+         (spkmeans.submit(0, 'wam', './tmp/no_such_file.txt'), ValueError, None),
+         (spkmeans.submit(3, 'spk', [[0.0, 1.0], [1.0, 0.0]]), ValueError, None),
+         (spkmeans.submit(0, 'no_such_goal', good), ValueError, None)]
+for job, error_type, message in cases:
+    try:
+        spkmeans.wait([spkmeans.submit(0, 'wam', good), job, spkmeans.submit(0, 'ddg', good)])
+        raise AssertionError('no error was raised')
+    except error_type as error:
+        assert message is None or message in str(error)
+" &> /dev/null
+verdict $?
+echo
+
+rm -f $malformed_file
+conformance_done
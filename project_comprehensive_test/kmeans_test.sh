@@ -0,0 +1,108 @@
+#!/bin/bash
+
+
+# This is a test of the blocked distance kernel of the kmeans mechanism (see distance.h), which assigns the datapoints from
+# K = KMEANS_BLOCKED_MIN_K (32) on. A single Lloyd iteration over datapoints that sit far from the origin (where the norm
+# expansion loses its precision) must give exactly the centroids of a plain Lloyd iteration, below that K and above it.
+# Besides, negative counts (K, num_data, dim, batch_size, max_iter, n_init, n_threads) and initial centroids indices that are
+# negative or fewer than K must be rejected with a ValueError.
+#
+# Usage (from within the directory of the project, just like tester.sh):
+# bash kmeans_test.sh
+
+
+
+
+function verdict() {
+	# the first argument shall be 0 on success
+	if [[ $1 -eq 0 ]]; then
+		echo -ne '\033[1;32mSUCCESS\e[0m'
+	else
+		echo -ne "\e[1;31mFAILED\e[0m"
+		failures=$((failures + 1))
+	fi
+}
+
+
+
+# test of a single K, on datapoints offset by the given amount
+function individual_test() {
+	# the first argument shall be K
+	# the second argument shall be the offset of the datapoints
+
+	echo -n "PY: KMEANS_FIT: K=${1}, OFFSET=${2}: "
+	python3 -c "
+import random, sys
+import spkmeans
+
+K, offset, num_data, dim = int(sys.argv[1]), float(sys.argv[2]), 4000, 4
+random.seed(0)
+points = [[offset + random.gauss(0, 0.01) for _ in range(dim)] for _ in range(num_data)]
+
+# a plain Lloyd iteration (sqdist, ties to the lowest index, sums in order)
+centroids = [points[i] for i in range(K)]
+sums, counts = [[0.0] * dim for _ in range(K)], [0] * K
+for point in points:
+    dists = []
+    for centroid in centroids:
+        dist = 0.0
+        for k in range(dim):
+            dist += (centroid[k] - point[k]) * (centroid[k] - point[k])
+        dists.append(dist)
+    closest = dists.index(min(dists))
+    counts[closest] += 1
+    sums[closest] = [s + x for s, x in zip(sums[closest], point)]
+expected = [[s / counts[i] for s in sums[i]] if counts[i] else centroids[i] for i in range(K)]
+
+actual = spkmeans.kmeans_fit(points, num_data, dim, list(range(K)), K, max_iter=1).tolist()
+sys.exit(actual != expected)
+" $1 $2 &> /dev/null
+	verdict $?
+	echo
+}
+
+
+
+
+
+# =================
+# PRELUDE
+# =================
+build_output=$(python3 setup.py build_ext --inplace --force 2>&1 1>/dev/null)
+if [[ ${#build_output} -ne 0 ]]; then
+	echo -e "\e[1;31mFailed to build the project:\e[0m\n${build_output}"
+	exit 1
+fi
+
+# run
+failures=0
+for K in 31 40; do
+	for offset in 0 1e5; do
+		individual_test $K $offset
+	done
+done
+
+# negative counts (and bad initial centroids indices) are rejected by every entry point of the kmeans algorithm
+echo -n "PY: NEGATIVE COUNTS: "
+python3 -c "
+import spkmeans, sys
+points = [[float(i), float(i % 3)] for i in range(20)]
+calls = [lambda: spkmeans.spk(3, points, n_init=-1), lambda: spkmeans.fit(3, points, n_threads=-1),
+         lambda: spkmeans.kmeans_fit(points, 20, 2, [0, 1, 2], 3, max_iter=-1),
+         lambda: spkmeans.kmeans_fit(points, 20, 2, [0, 1, 2], 3, batch_size=-5),
+         lambda: spkmeans.kmeans_fit(points, -20, 2, [0, 1, 2], 3), lambda: spkmeans.kmeans_fit(points, 20, 2, [0, 1, 2], -3),
+         lambda: spkmeans.kmeans_fit(points, 20, 2, [0, 1], 3), lambda: spkmeans.kmeans_fit(points, 20, 2, [0, -1, 2], 3),
+         lambda: spkmeans.kmeanspp(points, 20, 2, -1, 0), lambda: spkmeans.kmeanspp(points, 20, -2, 3, 0),
+         lambda: spkmeans.goal(-1, 'wam', points), lambda: spkmeans.submit(-1, 'wam', points)]
+for call in calls:
+    try:
+        call()
+        sys.exit(1)
+    except ValueError:
+        pass
+" &> /dev/null
+verdict $?
+echo
+
+echo -e "\n\e[4;37mDONE\e[0m: ${failures} failed."
+[[ $failures -eq 0 ]]
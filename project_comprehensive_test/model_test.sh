@@ -0,0 +1,146 @@
+#!/bin/bash
+
+
+# This is a test of the spectral clustering models of the CPython interface (see model.h): spkmeans.fit, Model.predict,
+# Model.save and spkmeans.load_model. On well separated datapoints, a fitted model must assign its own datapoints exactly as
+# the final centroids assign the rows of T (spkmeans.goal(K, 'spk', ...)). A model saved and loaded back (of every input file
+# that tester.sh uses) must keep the same centroids and make the same predictions. Files that are truncated, that have
+# trailing data or whose matrices don't fit together must be rejected with a ValueError, and so must datapoints of another
+# dimension by Model.predict.
+#
+# Usage (from within the directory of the project, just like tester.sh):
+# bash model_test.sh <testfiles>
+
+
+
+
+source "$(dirname "${BASH_SOURCE[0]}")/conformance.sh"
+
+# global variables
+model_file="./tmp/model.bin"
+broken_file="./tmp/broken_model.bin"
+
+
+
+# test of a model saved and loaded back, on a single input file
+function round_trip_test() {
+	# the first argument shall be the input file being used
+
+	echo -n "PY: ROUND_TRIP: ${testers_path}/${1}: "
+	python3 -c "
+import sys
+import spkmeans
+
+with open('$testers_path/$1') as input_file:
+    points = [[float(value) for value in line.split(',')] for line in input_file if line.strip()]
+try:
+    model = spkmeans.fit(0, points)
+except RuntimeError:
+    sys.exit(0) # some of the files fail once their eigen values are found
+model.save('$model_file')
+loaded = spkmeans.load_model('$model_file')
+assert loaded.K == model.K
+assert loaded.centroids.tolist() == model.centroids.tolist()
+assert loaded.predict(points) == model.predict(points)
+" &> /dev/null
+	verdict $?
+	echo
+}
+
+
+
+
+
+# =================
+# PRELUDE
+# =================
+conformance_prelude model_test.sh "$1"
+
+# a model assigns its own datapoints to the clusters of their rows of T
+echo -n "PY: PREDICT: "
+python3 -c "
+import random
+import spkmeans
+
+K = 3
+random.seed(0)
+centers = [[0.0, 0.0], [20.0, 0.0], [0.0, 20.0]]
+points = [[c + random.gauss(0, 0.5) for c in centers[i % K]] for i in range(150)]
+
+model = spkmeans.fit(K, points)
+assert model.K == K
+assert model.centroids.tolist() == spkmeans.spk(K, points)[1].tolist()
+
+centroids = model.centroids.tolist()
+def closest(row):
+    dists = [sum((x - y) * (x - y) for x, y in zip(row, centroid)) for centroid in centroids]
+    return dists.index(min(dists))
+labels = model.predict(points)
+assert labels == [closest(row) for row in spkmeans.goal(K, 'spk', points).tolist()]
+assert len(set(labels)) == K
+" &> /dev/null
+verdict $?
+echo
+
+# run
+for file in $(ls $testers_path | grep "^spk_"); do
+	round_trip_test $file
+done
+
+# a file that isn't exactly the records of a model is rejected, along with the reason
+python3 -c "
+import random, spkmeans
+random.seed(0)
+spkmeans.fit(2, [[random.gauss(5 * (i % 2), 0.5) for _ in range(3)] for i in range(20)]).save('$model_file')
+" &> /dev/null
+for broken in "truncated data" "trailing data" "inconsistent model"; do
+	echo -n "PY: LOAD_MODEL: ${broken^^}: "
+	python3 -c "
+import struct, sys
+import spkmeans
+
+with open('$model_file', 'rb') as model_file:
+    contents = model_file.read()
+
+def record(rows, cols):
+    header = b'SPKMBIN\0' + struct.pack('<BccxxxxxQQ', 1, b'd', b'L', rows, cols)
+    return header.ljust(64, b'\0') + struct.pack('<%dd' % (rows * cols), *([0.5] * (rows * cols)))
+
+if sys.argv[1] == 'truncated data':
+    contents = contents[:-8]
+elif sys.argv[1] == 'trailing data':
+    contents += struct.pack('<d', 0.5)
+else: # the centroids of 3 clusters, for a model of 2
+    n, dim, K = 20, 3, 2
+    contents = record(n, dim) + record(n, 1) + record(K, 1) + record(n, K) + record(K + 1, K)
+with open('$broken_file', 'wb') as broken_file:
+    broken_file.write(contents)
+
+try:
+    spkmeans.load_model('$broken_file')
+    sys.exit(1)
+except ValueError as error:
+    sys.exit(sys.argv[1] not in str(error))
+" "$broken" &> /dev/null
+	verdict $?
+	echo
+done
+
+# datapoints of another dimension than the one of the model are rejected
+echo -n "PY: PREDICT: DIMENSION MISMATCH: "
+python3 -c "
+import sys
+import spkmeans
+
+model = spkmeans.load_model('$model_file')
+try:
+    model.predict([[0.0, 0.0]])
+    sys.exit(1)
+except RuntimeError:
+    pass
+" &> /dev/null
+verdict $?
+echo
+
+rm -f $model_file $broken_file
+conformance_done
@@ -0,0 +1,99 @@
+#!/bin/bash
+
+
+# This is a test of the output file argument of both interfaces (see writer.h) against the same output files that tester.sh
+# uses. Every goal writes its result into an output file instead of stdout, as text (.txt) and as a NumPy array (.npy), by
+# conformance.sh: the text must be exactly the output file, and the array must hold the same values (formatted as '{:.4f}',
+# after whatever is still printed, e.g. the initial centroids indices of spk). So must the arrays that spkmeans.goal writes
+# into its output file, for every goal of the CPython interface.
+#
+# Usage (from within the directory of the project, just like tester.sh):
+# bash output_test.sh <testfiles>
+
+
+
+
+source "$(dirname "${BASH_SOURCE[0]}")/conformance.sh"
+
+# global variables
+result_file="./tmp/result"
+
+
+
+# the format of the output file
+function conformance_setup() {
+	echo -n "${format^^}: "
+	rm -f $result_file.$format
+}
+
+# every run writes into the output file
+function conformance_output() {
+	echo $result_file.$format
+}
+
+# whatever is still printed, followed by the output file (which only a failed run doesn't write)
+function conformance_compare() {
+	# the first argument shall be the output of the run
+	# the second argument shall be the output file
+	if grep -qx "An Error Has Occurred\|Invalid Input!" $2; then
+		[[ ! -e $result_file.$format ]] && cmp -s $1 $2
+	elif [[ ! -e $result_file.$format ]]; then
+		false
+	elif [[ $format == "npy" ]]; then
+		cat $1 <(python3 -c "
+import numpy as np
+print('\n'.join(','.join('{:.4f}'.format(value) for value in row) for row in np.load('$result_file.npy')))
+" 2> /dev/null) | cmp -s - $2
+	else
+		cat $1 $result_file.$format | cmp -s - $2
+	fi
+}
+
+
+
+# test of a single goal of the CPython interface, whose result is written into an array by spkmeans.goal
+function goal_test() {
+	# the first argument shall be the goal being tested
+	# the second argument shall be the input file being used
+
+	echo -n "PY: GOAL: ${1^^}: ${testers_path}/${2}: NPY: "
+	rm -f $result_file.npy
+	python3 -c "
+import sys
+import numpy as np
+import spkmeans
+
+assert spkmeans.goal(0, '$1', '$testers_path/$2', '$result_file.npy') is None
+lines = [','.join('{:.4f}'.format(value) for value in row) for row in np.load('$result_file.npy')]
+with open('$testers_path/outputs/py/$1/$2') as expected:
+    sys.exit(lines != expected.read().splitlines())
+" &> /dev/null
+	verdict $?
+	echo
+}
+
+
+
+
+
+# =================
+# PRELUDE
+# =================
+conformance_prelude output_test.sh "$1"
+
+# run
+for format in txt npy; do
+	conformance_goals
+done
+
+for goal in wam ddg lnorm; do
+	for file in $(ls $testers_path | grep "^spk_"); do
+		goal_test $goal $file
+	done
+done
+for file in $(ls $testers_path | grep "^jacobi_"); do
+	goal_test jacobi $file
+done
+
+rm -f $result_file.txt $result_file.npy
+conformance_done
@@ -0,0 +1,89 @@
+#!/bin/bash
+
+
+# This is a test of the profiling of the runs (see profile.h) against the same output files that tester.sh uses. Every
+# goal is run through the C interface (wam, ddg, lnorm, jacobi) and the CPython interface (spk) with SPKMEANS_PROFILE set,
+# which must leave the outputs exactly as they are, and report a profile that has the phase of the goal (by conformance.sh).
+# The bytes of the parsed datapoints must be accounted to the parse phase.
+#
+# Usage (from within the directory of the project, just like tester.sh):
+# bash profile_test.sh <testfiles>
+
+
+
+
+source "$(dirname "${BASH_SOURCE[0]}")/conformance.sh"
+
+# global variables
+profile_file="./tmp/profile.json"
+
+
+
+# checks that the given profile is valid JSON, and that it has one of the given phases
+function check_profile() {
+	# the first argument shall be the profile file
+	# the second argument shall be the phases that it may have (comma separated)
+	python3 -c "
+import json, sys
+profile = json.load(open(sys.argv[1]))
+kmeans = profile['kmeans']
+assert set(sys.argv[2].split(',')) & set(profile['phases'])
+assert len(kmeans['reassigned']) == min(kmeans['iterations'], 1024)
+" $1 $2 &> /dev/null
+}
+
+
+
+# every run writes a profile of its own
+function conformance_setup() {
+	rm -f $profile_file
+}
+
+# every run reports a profile that has the phase of its goal. The last run of the spk goal is its kmeans clustering, unless T
+# has a single column (which is an error).
+function conformance_check() {
+	phase=$2
+	[[ $2 == "spk" ]] && phase="kmeans,T"
+
+	check_profile $profile_file $phase
+}
+
+
+
+
+
+# =================
+# PRELUDE
+# =================
+conformance_prelude profile_test.sh "$1"
+
+# run
+conformance_goals SPKMEANS_PROFILE=$profile_file
+
+# the profile of the last run is kept by the CPython interface as well
+echo -n "PY: LAST_PROFILE: "
+SPKMEANS_PROFILE=$profile_file python3 -c "
+import spkmeans, sys
+assert spkmeans.last_profile() is None
+spkmeans.goal(0, 'jacobi', sys.argv[1])
+profile = spkmeans.last_profile()
+assert 'jacobi' in profile['phases'] and profile['jacobi']['rotations'] > 0
+" $testers_path/$(ls $testers_path | grep "^jacobi_" | head -1) &> /dev/null
+verdict $?
+echo
+
+# the datapoints that are parsed are accounted to the parse phase, whether they're read from a file or from a pipe
+file=$testers_path/$(ls $testers_path | grep "^spk_" | head -1)
+for source in "$file" "-"; do
+	echo -n "C: PARSE BYTES: ${source}: "
+	rm -f $profile_file
+	SPKMEANS_PROFILE=$profile_file ./spkmeans wam $source < $file &> /dev/null
+	python3 -c "
+import json, sys
+assert json.load(open(sys.argv[1]))['phases']['parse']['bytes'] > 0
+" $profile_file &> /dev/null
+	verdict $?
+	echo
+done
+
+conformance_done
@@ -0,0 +1,63 @@
+#!/bin/bash
+
+
+# This is a test of the inputs that are streamed through stdin (an input file of "-", see loader_load_stream) against the
+# same output files that tester.sh uses. Every input file is piped into both interfaces, and every goal must reproduce the
+# output files exactly out of it, by conformance.sh. So must lines that are longer than the buffer of the stream
+# (LOADER_STREAM_BUFFER, 1 MiB), which grows for them: their outputs must be those of the same input file, given as a file.
+#
+# Usage (from within the directory of the project, just like tester.sh):
+# bash stream_test.sh <testfiles>
+
+
+
+
+source "$(dirname "${BASH_SOURCE[0]}")/conformance.sh"
+
+# global variables
+long_lines_file="./tmp/long_lines.txt"
+
+
+
+# every run is on its input file, piped into it
+function conformance_input() {
+	echo "-"
+}
+
+
+
+
+
+# =================
+# PRELUDE
+# =================
+conformance_prelude stream_test.sh "$1"
+
+# run
+conformance_goals
+
+# lines of about 2.3 MiB each (twice as long as the buffer, and then some) of datapoints that are close enough to weigh
+# something, the last of which doesn't end with a newline
+python3 -c "
+import random
+random.seed(0)
+rows = [','.join('%.5f' % random.uniform(0, 0.001) for _ in range(300000)) for _ in range(4)]
+print('\n'.join(rows), end='')
+" > $long_lines_file
+for goal in wam ddg lnorm; do
+	echo -n "C: ${goal^^}: LINES LONGER THAN THE BUFFER: "
+	./spkmeans $goal $long_lines_file > ./tmp/expected.txt 2>&1 &&
+		cat $long_lines_file | ./spkmeans $goal - &> $output_file &&
+		cmp -s $output_file ./tmp/expected.txt
+	verdict $?
+	echo
+done
+echo -n "PY: SPK: LINES LONGER THAN THE BUFFER: "
+python3 spkmeans.py 2 spk $long_lines_file > ./tmp/expected.txt 2>&1 &&
+	cat $long_lines_file | python3 spkmeans.py 2 spk - &> $output_file &&
+	cmp -s $output_file ./tmp/expected.txt
+verdict $?
+echo
+
+rm -f $long_lines_file ./tmp/expected.txt
+conformance_done